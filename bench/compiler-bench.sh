@@ -0,0 +1,109 @@
+#!/bin/bash
+# Measures how the compiler scales along each axis of gen-program.sh.
+#
+# usage: compiler-bench.sh <zion-binary> [report-file]
+#
+# Every generated program is compiled through ssa_gen with `zion ll
+# --time-trace`, and one JSON object per program is appended to the report
+# (stdout by default) with the wall time, the time spent in each phase and
+# the peak RSS at its end, and the overall peak RSS of the compiler. Set
+# BENCH_AXES and BENCH_SIZES to choose what is measured.
+
+set -e
+
+if [ $# -lt 1 ] || [ $# -gt 2 ]; then
+  echo "usage: $0 <zion-binary> [report-file]" >&2
+  exit 1
+fi
+
+zion="$1"
+report="${2:-/dev/stdout}"
+axes="${BENCH_AXES:-decls scc instances poly arms modules}"
+sizes="${BENCH_SIZES:-25 50 100 200}"
+bench_dir="$(cd "$(dirname "$0")" && pwd)"
+work_dir="$(mktemp -d "${TMPDIR:-/tmp}/zion-bench.XXXXXX")"
+trap 'rm -rf "$work_dir"' EXIT
+
+# cached interfaces would let the compiler skip the work being measured
+unset ZION_CACHE
+
+# summarize_trace <axis> <size> <wall-seconds> <trace-file>
+#
+# the compiler samples its peak RSS as each phase ends, so the first sample
+# taken after a phase ends is the peak RSS of the compilation up to and
+# including that phase
+summarize_trace() {
+  awk -v axis="$1" -v size="$2" -v wall="$3" '
+    function field(key) {
+      match($0, "\"" key "\":[0-9]+")
+      return substr($0, RSTART + length(key) + 3,
+                    RLENGTH - length(key) - 3) + 0
+    }
+    BEGIN {
+      samples = 0
+    }
+    /"ph":"X"/ {
+      match($0, /"name":"[^"]*"/)
+      name = substr($0, RSTART + 8, RLENGTH - 9)
+      micros[name] += field("dur")
+      end_micros = field("ts") + field("dur")
+      if (end_micros > phase_end[name]) {
+        phase_end[name] = end_micros
+      }
+    }
+    /"ph":"C","name":"peak rss kb"/ {
+      rss = field("peak rss kb")
+      sample_ts[samples] = field("ts")
+      sample_rss[samples] = rss
+      ++samples
+      if (rss > peak_rss) {
+        peak_rss = rss
+      }
+    }
+    END {
+      printf "{\"axis\":\"%s\",\"size\":%d,\"wall_ms\":%.1f", axis, size,
+             wall * 1000
+      split("parse_program check_decls check_instances specialize ssa_gen",
+            phases, " ")
+      for (i = 1; i <= 5; ++i) {
+        phase_rss = 0
+        for (j = 0; (phases[i] in phase_end) && j < samples; ++j) {
+          if (sample_ts[j] >= phase_end[phases[i]]) {
+            phase_rss = sample_rss[j]
+            break
+          }
+        }
+        printf ",\"%s_ms\":%.3f,\"%s_rss_kb\":%d", phases[i],
+               micros[phases[i]] / 1000, phases[i], phase_rss
+      }
+      printf ",\"peak_rss_kb\":%d}\n", peak_rss
+    }' "$4"
+}
+
+failures=0
+for axis in $axes; do
+  for size in $sizes; do
+    program_dir="$work_dir/${axis}_${size}"
+    program="$("$bench_dir/gen-program.sh" "$axis" "$size" "$program_dir")"
+    trace="$program_dir/trace.json"
+    # only the time itself may go to the captured stderr
+    log="$program_dir/zion.log"
+
+    TIMEFORMAT=%R
+    if ! wall=$( { time (cd "$program_dir" &&
+                         TMPDIR="$program_dir" \
+                         ZION_PATH="$program_dir${ZION_PATH:+:$ZION_PATH}" \
+                         "$zion" ll --time-trace="$trace" \
+                           "$(basename "$program" .zion)" \
+                           > /dev/null 2> "$log"); } \
+                   2>&1 ); then
+      echo "$0: failed to compile $axis program of size $size" >&2
+      cat "$log" >&2
+      failures=$((failures + 1))
+      continue
+    fi
+    summarize_trace "$axis" "$size" "$wall" "$trace" >> "$report"
+  done
+done
+
+[ $failures -eq 0 ]
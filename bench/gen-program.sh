@@ -0,0 +1,131 @@
+#!/bin/bash
+# Generates a synthetic Zion program that stresses one part of the compiler.
+#
+# usage: gen-program.sh <axis> <size> <output-dir>
+#
+# axes:
+#   decls      <size> top-level functions in a call chain
+#   scc        one strongly connected component of <size> functions
+#   instances  <size> instances of a single type class
+#   poly       polymorphic instantiation <size> levels deep
+#   arms       a match expression with <size> arms
+#   modules    a chain of <size> imported modules
+#
+# The entry point is written to <output-dir>/bench_<axis>.zion. It prints a
+# single number when run.
+
+set -e
+
+usage() {
+  echo "usage: $0 <decls|scc|instances|poly|arms|modules> <size> <output-dir>" >&2
+  exit 1
+}
+
+[ $# -eq 3 ] || usage
+axis="$1"
+size="$2"
+output_dir="$3"
+[ "$size" -gt 0 ] 2>/dev/null || usage
+mkdir -p "$output_dir"
+program="$output_dir/bench_${axis}.zion"
+
+gen_decls() {
+  echo "fn f_0(x Int) Int => x"
+  for ((i = 1; i < size; ++i)); do
+    echo "fn f_${i}(x Int) Int => f_$((i - 1))(x) + 1"
+  done
+  echo
+  echo "fn main() {"
+  echo "  print(f_$((size - 1))(0))"
+  echo "}"
+}
+
+gen_scc() {
+  for ((i = 0; i < size; ++i)); do
+    echo "fn g_${i}(n Int) Int => n <= 0 ? ${i} : g_$(((i + 1) % size))(n - 1)"
+  done
+  echo
+  echo "fn main() {"
+  echo "  print(g_0(${size}))"
+  echo "}"
+}
+
+gen_instances() {
+  echo "class Weigh a {"
+  echo "  fn weigh(a) Int"
+  echo "}"
+  for ((i = 0; i < size; ++i)); do
+    echo
+    echo "data T_${i} {"
+    echo "  C_${i}(Int)"
+    echo "}"
+    echo
+    echo "instance Weigh T_${i} {"
+    echo "  fn weigh(t) => match t {"
+    echo "    C_${i}(n) => n + ${i}"
+    echo "  }"
+    echo "}"
+  done
+  echo
+  echo "fn main() {"
+  echo "  var total = 0"
+  for ((i = 0; i < size; ++i)); do
+    echo "  total += weigh(C_${i}(1))"
+  done
+  echo "  print(total)"
+  echo "}"
+}
+
+gen_poly() {
+  # each level wraps its argument once more, so p_i is instantiated at a
+  # type that is i levels deep.
+  echo "fn p_0(x) => 0"
+  for ((i = 1; i < size; ++i)); do
+    echo "fn p_${i}(x) => p_$((i - 1))(Just(x)) + 1"
+  done
+  echo
+  echo "fn main() {"
+  echo "  print(p_$((size - 1))(1))"
+  echo "}"
+}
+
+gen_arms() {
+  echo "data Arm {"
+  for ((i = 0; i < size; ++i)); do
+    echo "  K_${i}(Int)"
+  done
+  echo "}"
+  echo
+  echo "fn pick(arm Arm) Int => match arm {"
+  for ((i = 0; i < size; ++i)); do
+    echo "  K_${i}(n) => n + ${i}"
+  done
+  echo "}"
+  echo
+  echo "fn main() {"
+  echo "  print(pick(K_$((size / 2))(1)))"
+  echo "}"
+}
+
+gen_modules() {
+  echo "fn m_0(x Int) Int => x" > "$output_dir/bench_module_0.zion"
+  for ((i = 1; i < size; ++i)); do
+    {
+      echo "import bench_module_$((i - 1)) {m_$((i - 1))}"
+      echo
+      echo "fn m_${i}(x Int) Int => m_$((i - 1))(x) + 1"
+    } > "$output_dir/bench_module_${i}.zion"
+  done
+  echo "import bench_module_$((size - 1)) {m_$((size - 1))}"
+  echo
+  echo "fn main() {"
+  echo "  print(m_$((size - 1))(0))"
+  echo "}"
+}
+
+case "$axis" in
+  decls|scc|instances|poly|arms|modules) "gen_${axis}" > "$program" ;;
+  *) usage ;;
+esac
+
+echo "$program"
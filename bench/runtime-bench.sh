@@ -0,0 +1,99 @@
+#!/bin/bash
+# Runs the standard library and runtime benchmarks in bench/runtime.
+#
+# usage: runtime-bench.sh <zion-binary> <report-file> [baseline-file]
+#
+# Every bench/runtime/bench_*.zion program is built and run with `zion run`,
+# and the JSON line that lib/bench.zion prints for each benchmark is written
+# to the report. When a baseline report is given, each benchmark is compared
+# against it, and the script fails if any got slower or allocates more by
+# more than BENCH_THRESHOLD percent (10 by default). Set BENCH_FILTER to a
+# regex to run only the matching programs, and ZION_BENCH_MILLIS to change
+# how long each benchmark is timed for. The programs are built with
+# -DZION_COUNT_ALLOCATIONS added to ZION_OPT_FLAGS, so that their runtime
+# counts allocations.
+
+set -e -o pipefail
+
+if [ $# -lt 2 ] || [ $# -gt 3 ]; then
+  echo "usage: $0 <zion-binary> <report-file> [baseline-file]" >&2
+  exit 1
+fi
+
+zion="$1"
+report="$2"
+baseline="$3"
+threshold="${BENCH_THRESHOLD:-10}"
+bench_dir="$(cd "$(dirname "$0")" && pwd)"
+work_dir="$(mktemp -d "${TMPDIR:-/tmp}/zion-bench.XXXXXX")"
+trap 'rm -rf "$work_dir"' EXIT
+
+: > "$report"
+failures=0
+for program in "$bench_dir"/runtime/bench_*.zion; do
+  name="$(basename "$program" .zion)"
+  if [ -n "$BENCH_FILTER" ] && ! [[ "$name" =~ $BENCH_FILTER ]]; then
+    continue
+  fi
+  echo "$0: running $name..." >&2
+  if ! (cd "$work_dir" &&
+        TMPDIR="$work_dir" \
+        ZION_OPT_FLAGS="${ZION_OPT_FLAGS:+$ZION_OPT_FLAGS }-DZION_COUNT_ALLOCATIONS" \
+        ZION_PATH="$bench_dir/runtime${ZION_PATH:+:$ZION_PATH}" \
+        "$zion" run "$name") | grep '^{"name":' >> "$report"; then
+    echo "$0: $name failed" >&2
+    failures=$((failures + 1))
+  fi
+done
+
+if [ -n "$baseline" ]; then
+  # print one row per benchmark, and count the ones that regressed
+  if ! awk -v threshold="$threshold" '
+    function field(line, key) {
+      if (!match(line, "\"" key "\":[^,}]*")) {
+        return ""
+      }
+      return substr(line, RSTART + length(key) + 3, RLENGTH - length(key) - 3)
+    }
+    function label(name) {
+      gsub(/"/, "", name)
+      return name
+    }
+    function change(before, after) {
+      return before > 0 ? (after - before) * 100 / before : 0
+    }
+    FNR == 1 && FNR == NR {
+      printf "%-32s %14s %14s %9s\n", "benchmark", "baseline ns", "ns/op", "change"
+    }
+    FNR == NR {
+      name = field($0, "name")
+      base_ns[name] = field($0, "ns_per_op")
+      base_allocs[name] = field($0, "allocs_per_op")
+      next
+    }
+    {
+      name = field($0, "name")
+      if (!(name in base_ns)) {
+        printf "%-32s %14s %14.1f %9s\n", label(name), "-", field($0, "ns_per_op"), "new"
+        next
+      }
+      ns_change = change(base_ns[name], field($0, "ns_per_op"))
+      allocs_change = change(base_allocs[name], field($0, "allocs_per_op"))
+      verdict = ""
+      if (ns_change > threshold || allocs_change > threshold) {
+        verdict = " REGRESSED"
+        ++regressions
+      }
+      printf "%-32s %14.1f %14.1f %+8.1f%% allocs %+.1f%%%s\n", label(name),
+             base_ns[name], field($0, "ns_per_op"), ns_change, allocs_change,
+             verdict
+    }
+    END {
+      exit regressions > 0
+    }' "$baseline" "$report"; then
+    echo "$0: benchmarks regressed by more than $threshold% against $baseline" >&2
+    failures=$((failures + 1))
+  fi
+fi
+
+[ $failures -eq 0 ]
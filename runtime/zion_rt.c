@@ -113,13 +113,27 @@ const char *zion_strerror(int errnum, char *buf, int64_t bufsize) {
 #endif
 }
 
+#ifdef ZION_COUNT_ALLOCATIONS
+/* the number of objects allocated through zion_malloc, for benchmarks. it is
+ * only kept by runtimes built with -DZION_COUNT_ALLOCATIONS, so that other
+ * programs do not pay for it on every allocation. once zion_malloc is inlined,
+ * this also counts the allocations that the optimizer moved onto the stack. */
+static int64_t zion_allocation_count = 0;
+#endif
+
+/* the optimizer recognizes calls to zion_malloc, and to the GC_malloc within
+ * it once it is inlined, and moves the ones that do not escape onto the
+ * stack */
 void *zion_malloc(uint64_t cb) {
+#ifdef ZION_COUNT_ALLOCATIONS
+  ++zion_allocation_count;
+#endif
   void *pb = GC_MALLOC(cb);
   // printf("allocated %" PRId64 " bytes at 0x%08" PRIx64 "\n", cb, (uint64_t)pb);
   return pb;
 }
 
-int zion_strlen(const char *sz) {
+int64_t zion_strlen(const char *sz) {
 	return strlen(sz);
 }
 
@@ -206,6 +220,52 @@ int64_t zion_epoch_millis() {
   return (int64_t)s * 1000 + ms;
 }
 
+int64_t zion_monotonic_nanos() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (int64_t)spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+/* -1 when the runtime does not count allocations */
+int64_t zion_allocations() {
+#ifdef ZION_COUNT_ALLOCATIONS
+  return zion_allocation_count;
+#else
+  return -1;
+#endif
+}
+
+int64_t zion_allocated_bytes() {
+  return (int64_t)GC_get_total_bytes();
+}
+
+int64_t zion_gc_count() {
+  return (int64_t)GC_get_gc_no();
+}
+
+void zion_start_gc_timing() {
+#if GC_VERSION_MAJOR >= 8
+  GC_start_performance_measurement();
+#endif
+}
+
+/* the time spent in full collections since zion_start_gc_timing, or zero when
+ * the collector is too old to measure it */
+int64_t zion_gc_millis() {
+#if GC_VERSION_MAJOR >= 8
+  return (int64_t)GC_get_full_gc_total_time();
+#else
+  return 0;
+#endif
+}
+
+/* return p unchanged, but out of the optimizer's sight, so that a benchmark
+ * can not have the work that it measures folded away */
+void *zion_opaque(void *p) {
+  __asm__ volatile("" : "+r"(p) : : "memory");
+  return p;
+}
+
 int64_t zion_hash_combine(uint64_t seed, uint64_t value) {
   return seed ^ (value + 0x9e3779b97f4a7c15LLU + (seed << 12) + (seed >> 4));
 }
@@ -0,0 +1,152 @@
+#include "arena.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::size_t block_size = 256 * 1024;
+constexpr std::size_t alignment = alignof(std::max_align_t);
+
+std::atomic<unsigned long> next_arena_id{1};
+std::atomic<Arena *> current_arena{nullptr};
+
+/* the block this thread is currently filling, and which arena it belongs to */
+struct Cursor {
+  unsigned long arena_id = 0;
+  char *next = nullptr;
+  char *end = nullptr;
+};
+thread_local Cursor cursor;
+
+/* memory that new has handed out for an object that is not yet constructed.
+ * the arguments of a constructor may create other objects first, so these
+ * nest. */
+struct Pending {
+  char *allocation;
+  std::size_t size;
+  Arena *arena;
+};
+thread_local std::vector<Pending> pending;
+
+/* the list that this thread adds its objects to, and which arena it belongs
+ * to */
+struct ObjectList {
+  unsigned long arena_id = 0;
+  std::vector<Arena::Object> *objects = nullptr;
+};
+thread_local ObjectList object_list;
+
+} // namespace
+
+Arena::Arena() : id(next_arena_id++) {
+}
+
+Arena::~Arena() {
+  for (auto &thread_objects : objects) {
+    for (auto iter = thread_objects->rbegin(); iter != thread_objects->rend();
+         ++iter) {
+      if (iter->object != nullptr) {
+        iter->object->~ArenaAllocated();
+      }
+    }
+  }
+}
+
+void *Arena::allocate(std::size_t size) {
+  size = (size + alignment - 1) & ~(alignment - 1);
+  bytes += size;
+
+  if (cursor.arena_id == id && size <= std::size_t(cursor.end - cursor.next)) {
+    void *p = cursor.next;
+    cursor.next += size;
+    return p;
+  }
+
+  std::size_t new_block_size = std::max(block_size, size);
+  char *block = new char[new_block_size];
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    blocks.emplace_back(block);
+  }
+
+  if (size > block_size / 4) {
+    /* big objects get a block of their own, so the current block can keep
+     * filling up */
+    return block;
+  }
+
+  cursor = Cursor{id, block + size, block + new_block_size};
+  return block;
+}
+
+std::size_t Arena::bytes_allocated() const {
+  return bytes;
+}
+
+Arena &Arena::current() {
+  if (auto arena = current_arena.load()) {
+    return *arena;
+  }
+  static Arena *process_arena = new Arena();
+  return *process_arena;
+}
+
+void Arena::adopt(ArenaAllocated *object) {
+  /* objects on the stack, and objects within other objects, were not placed
+   * by new, so they lie outside of the innermost pending allocation */
+  if (pending.empty()) {
+    return;
+  }
+  const Pending &innermost = pending.back();
+  char *address = reinterpret_cast<char *>(object);
+  if (address < innermost.allocation ||
+      address >= innermost.allocation + innermost.size) {
+    return;
+  }
+  Arena *arena = innermost.arena;
+  const Object arena_object{innermost.allocation, object};
+  pending.pop_back();
+  arena->add_object(arena_object);
+}
+
+void Arena::abandon(void *allocation) {
+  if (!pending.empty() && pending.back().allocation == allocation) {
+    pending.pop_back();
+    return;
+  }
+
+  /* the object was adopted before its constructor threw, and it was the
+   * latest one that this thread adopted */
+  if (object_list.objects != nullptr) {
+    for (auto iter = object_list.objects->rbegin();
+         iter != object_list.objects->rend(); ++iter) {
+      if (iter->allocation == allocation) {
+        iter->object = nullptr;
+        return;
+      }
+    }
+  }
+}
+
+void Arena::add_object(const Object &object) {
+  if (object_list.arena_id != id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    objects.emplace_back(new std::vector<Object>());
+    object_list = ObjectList{id, objects.back().get()};
+  }
+  object_list.objects->push_back(object);
+}
+
+void *ArenaAllocated::operator new(std::size_t size) {
+  Arena &arena = Arena::current();
+  void *allocation = arena.allocate(size);
+  pending.push_back(Pending{static_cast<char *>(allocation), size, &arena});
+  return allocation;
+}
+
+ArenaScope::ArenaScope(Arena &arena) : outer(current_arena.exchange(&arena)) {
+}
+
+ArenaScope::~ArenaScope() {
+  current_arena = outer;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct ArenaAllocated;
+
+/* a bump allocator for objects that live as long as a compilation. each
+ * thread carves objects out of its own block, so nodes that are built
+ * together sit together in memory. when the arena is destroyed, it runs the
+ * destructors of the ArenaAllocated objects that were created in it with new,
+ * so that the vectors and strings that they hold are freed too, and then it
+ * releases its blocks. */
+class Arena {
+public:
+  Arena();
+  Arena(const Arena &) = delete;
+  ~Arena();
+
+  void *allocate(std::size_t size);
+  /* how many bytes have been handed out so far */
+  std::size_t bytes_allocated() const;
+
+  /* the arena that ArenaAllocated objects are currently placed in. when no
+   * ArenaScope is open, this is an arena that lives as long as the process. */
+  static Arena &current();
+
+  /* an object created in the arena, which lives at allocation. object is null
+   * when its constructor threw. */
+  struct Object {
+    void *allocation;
+    ArenaAllocated *object;
+  };
+
+private:
+  friend struct ArenaAllocated;
+
+  /* called by the constructor of each ArenaAllocated object, to remember the
+   * ones whose memory came from an arena */
+  static void adopt(ArenaAllocated *object);
+  /* called when the constructor of the object at allocation throws */
+  static void abandon(void *allocation);
+  void add_object(const Object &object);
+
+  unsigned long const id;
+  std::mutex mutex;
+  std::vector<std::unique_ptr<char[]>> blocks;
+  /* the objects created by each thread, in the order they were created */
+  std::vector<std::unique_ptr<std::vector<Object>>> objects;
+  std::atomic<std::size_t> bytes{0};
+};
+
+/* makes an arena current for all threads until the scope ends */
+class ArenaScope {
+public:
+  explicit ArenaScope(Arena &arena);
+  ArenaScope(const ArenaScope &) = delete;
+  ~ArenaScope();
+
+private:
+  Arena *const outer;
+};
+
+/* deriving from ArenaAllocated places objects created with new in the
+ * current arena, which destroys them. such objects must never be deleted. */
+struct ArenaAllocated {
+  ArenaAllocated() {
+    Arena::adopt(this);
+  }
+  ArenaAllocated(const ArenaAllocated &) {
+    Arena::adopt(this);
+  }
+  virtual ~ArenaAllocated() {
+  }
+
+  static void *operator new(std::size_t size);
+  static void operator delete(void *allocation) noexcept {
+    /* only reached when a constructor throws. the memory goes away with its
+     * arena. */
+    Arena::abandon(allocation);
+  }
+};
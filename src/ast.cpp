@@ -1,5 +1,7 @@
 #include "ast.h"
 
+#include <atomic>
+
 #include "class_predicate.h"
 #include "parens.h"
 #include "ptr.h"
@@ -494,9 +496,12 @@ Location Instance::get_location() const {
   return class_predicate->get_location();
 }
 
-int next_fresh = 0;
+std::atomic<int> next_fresh{0};
 
 std::string fresh() {
+  if (auto scope = GensymScope::current()) {
+    return scope->next_fresh_name();
+  }
   return string_format("__v%d", next_fresh++);
 }
 
@@ -508,7 +513,7 @@ ast::Expr *unit_expr(Location location) {
 
 tarjan::Vertices get_free_vars(
     const ast::Expr *expr,
-    const std::unordered_set<std::string> &bound_vars) {
+    const std::unordered_set<Symbol> &bound_vars) {
   if (dcast<const ast::Literal *>(expr)) {
     return {};
   } else if (auto static_print = dcast<const ast::StaticPrint *>(expr)) {
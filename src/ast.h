@@ -2,6 +2,7 @@
 #include <iostream>
 #include <vector>
 
+#include "arena.h"
 #include "constraint.h"
 #include "identifier.h"
 #include "import_rules.h"
@@ -18,7 +19,7 @@ namespace ast {
 
 std::string fresh();
 
-struct Expr {
+struct Expr : public ArenaAllocated {
   virtual ~Expr() throw() {
   }
   virtual Location get_location() const = 0;
@@ -47,7 +48,7 @@ struct Var : public Expr {
   Identifier id;
 };
 
-struct PatternBlock {
+struct PatternBlock : public ArenaAllocated {
   PatternBlock(const Predicate *predicate, const Expr *result)
       : predicate(predicate), result(result) {
   }
@@ -69,7 +70,7 @@ struct Match : public Expr {
   const PatternBlocks pattern_blocks;
 };
 
-struct Predicate {
+struct Predicate : public ArenaAllocated {
   virtual ~Predicate() {
   }
   virtual std::ostream &render(std::ostream &os) const = 0;
@@ -88,14 +89,14 @@ struct Predicate {
   virtual Location get_location() const = 0;
   virtual Identifier instantiate_name_assignment() const = 0;
   virtual void get_bound_vars(
-      std::unordered_set<std::string> &bound_vars) const = 0;
+      std::unordered_set<Symbol> &bound_vars) const = 0;
   virtual const Expr *translate(
       const types::DefnId &defn_id,
       const Identifier &scrutinee_id,
       const types::Ref &scrutinee_type,
       bool do_checks,
       const DataCtorsMap &data_ctors_map,
-      const std::unordered_set<std::string> &bound_vars,
+      const std::unordered_set<Symbol> &bound_vars,
       const TrackedTypes &tracked_types,
       const types::TypeEnv &type_env,
       TrackedTypes &typing,
@@ -127,13 +128,13 @@ struct TuplePredicate : public Predicate {
       types::ClassPredicates &instance_requirements) const override;
   Identifier instantiate_name_assignment() const override;
   void get_bound_vars(
-      std::unordered_set<std::string> &bound_vars) const override;
+      std::unordered_set<Symbol> &bound_vars) const override;
   const Expr *translate(const types::DefnId &defn_id,
                         const Identifier &scrutinee_id,
                         const types::Ref &scrutinee_type,
                         bool do_checks,
                         const DataCtorsMap &data_ctors_map,
-                        const std::unordered_set<std::string> &bound_vars,
+                        const std::unordered_set<Symbol> &bound_vars,
                         const TrackedTypes &tracked_types,
                         const types::TypeEnv &type_env,
                         TrackedTypes &typing,
@@ -167,13 +168,13 @@ struct IrrefutablePredicate : public Predicate {
       types::ClassPredicates &instance_requirements) const override;
   Identifier instantiate_name_assignment() const override;
   void get_bound_vars(
-      std::unordered_set<std::string> &bound_vars) const override;
+      std::unordered_set<Symbol> &bound_vars) const override;
   const Expr *translate(const types::DefnId &defn_id,
                         const Identifier &scrutinee_id,
                         const types::Ref &scrutinee_type,
                         bool do_checks,
                         const DataCtorsMap &data_ctors_map,
-                        const std::unordered_set<std::string> &bound_vars,
+                        const std::unordered_set<Symbol> &bound_vars,
                         const TrackedTypes &tracked_types,
                         const types::TypeEnv &type_env,
                         TrackedTypes &typing,
@@ -210,13 +211,13 @@ struct CtorPredicate : public Predicate {
       types::ClassPredicates &instance_requirements) const override;
   Identifier instantiate_name_assignment() const override;
   void get_bound_vars(
-      std::unordered_set<std::string> &bound_vars) const override;
+      std::unordered_set<Symbol> &bound_vars) const override;
   const Expr *translate(const types::DefnId &defn_id,
                         const Identifier &scrutinee_id,
                         const types::Ref &scrutinee_type,
                         bool do_checks,
                         const DataCtorsMap &data_ctors_map,
-                        const std::unordered_set<std::string> &bound_vars,
+                        const std::unordered_set<Symbol> &bound_vars,
                         const TrackedTypes &tracked_types,
                         const types::TypeEnv &type_env,
                         TrackedTypes &typing,
@@ -374,13 +375,13 @@ struct Literal : public Expr, public Predicate {
   types::Ref non_tracking_infer() const;
   Identifier instantiate_name_assignment() const override;
   void get_bound_vars(
-      std::unordered_set<std::string> &bound_vars) const override;
+      std::unordered_set<Symbol> &bound_vars) const override;
   const Expr *translate(const types::DefnId &defn_id,
                         const Identifier &scrutinee_id,
                         const types::Ref &scrutinee_type,
                         bool do_checks,
                         const DataCtorsMap &data_ctors_map,
-                        const std::unordered_set<std::string> &bound_vars,
+                        const std::unordered_set<Symbol> &bound_vars,
                         const TrackedTypes &tracked_types,
                         const types::TypeEnv &type_env,
                         TrackedTypes &typing,
@@ -450,7 +451,7 @@ struct While : public Expr {
   const Expr *block;
 };
 
-struct Decl {
+struct Decl : public ArenaAllocated {
   Decl(Identifier id, const Expr *value) : id(id), value(value) {
     assert(id.name.find("0x7") == std::string::npos);
   }
@@ -462,7 +463,7 @@ struct Decl {
   const Expr *const value;
 };
 
-struct TypeDecl {
+struct TypeDecl : public ArenaAllocated {
   TypeDecl(Identifier id, const Identifiers &params) : id(id), params(params) {
   }
 
@@ -475,7 +476,7 @@ struct TypeDecl {
   }
 };
 
-struct TypeClass {
+struct TypeClass : public ArenaAllocated {
   TypeClass(Identifier id,
             const Identifiers &type_var_ids,
             const types::ClassPredicates &class_predicates,
@@ -492,7 +493,7 @@ struct TypeClass {
   std::vector<const Decl *> default_decls;
 };
 
-struct Instance {
+struct Instance : public ArenaAllocated {
   Instance(const types::ClassPredicateRef &class_predicate,
            const std::vector<const Decl *> &decls)
       : class_predicate(class_predicate), decls(decls) {
@@ -504,7 +505,7 @@ struct Instance {
   std::vector<const Decl *> const decls;
 };
 
-struct Module {
+struct Module : public ArenaAllocated {
   Module(std::string name,
          const std::vector<Identifier> &imports,
          const std::vector<const Decl *> &decls,
@@ -531,7 +532,7 @@ struct Module {
   types::TypeEnv const type_env;
 };
 
-struct Program {
+struct Program : public ArenaAllocated {
   Program(const std::vector<const Decl *> &decls,
           const std::vector<const TypeClass *> &type_classes,
           const std::vector<const Instance *> &instances,
@@ -550,7 +551,7 @@ struct Program {
 ast::Expr *unit_expr(Location location);
 tarjan::Vertices get_free_vars(
     const ast::Expr *expr,
-    const std::unordered_set<std::string> &bound_vars);
+    const std::unordered_set<Symbol> &bound_vars);
 } // namespace zion
 
 std::ostream &operator<<(std::ostream &os, zion::ast::Program *program);
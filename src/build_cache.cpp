@@ -0,0 +1,333 @@
+#include "build_cache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "dbg.h"
+#include "disk.h"
+#include "emit.h"
+#include "interface_cache.h"
+#include "logger.h"
+#include "specialize_hofs.h"
+#include "utils.h"
+
+namespace zion {
+
+namespace {
+
+/* bump this whenever what goes into a build key changes */
+const char *build_format = "zion-build-3";
+
+/* how many megabytes of executables to keep when ZION_CACHE_SIZE is not set */
+const std::uintmax_t default_cache_megabytes = 512;
+
+std::string get_zion_cache() {
+  const char *zion_cache = getenv("ZION_CACHE");
+  return zion_cache != nullptr ? zion_cache : "";
+}
+
+std::string get_executables_dir(const std::string &zion_cache) {
+  return zion_cache + "/bin";
+}
+
+/* executables are written here before they are renamed into the executables
+ * dir, so that eviction and stats never see them half written */
+std::string get_temp_dir(const std::string &zion_cache) {
+  return zion_cache + "/tmp";
+}
+
+std::uintmax_t get_max_executable_bytes() {
+  const char *cache_size = getenv("ZION_CACHE_SIZE");
+  std::uintmax_t megabytes = default_cache_megabytes;
+  if (cache_size != nullptr && cache_size[0] != '\0') {
+    megabytes = strtoull(cache_size, nullptr, 10);
+  }
+  return megabytes * 1024 * 1024;
+}
+
+/* read the number in the counter file fd. anything else counts as 0. */
+std::size_t read_count(int fd) {
+  char buffer[32];
+  auto size = pread(fd, buffer, sizeof(buffer) - 1, 0);
+  if (size <= 0) {
+    return 0;
+  }
+  buffer[size] = '\0';
+  char *end = nullptr;
+  std::size_t count = strtoull(buffer, &end, 10);
+  if (end == buffer || !isdigit(buffer[0]) ||
+      (*end != '\0' && *end != '\n')) {
+    return 0;
+  }
+  return count;
+}
+
+/* hits and misses are each a number in a file, which is locked while it is
+ * rewritten so that concurrent compilations do not lose counts */
+void count(const std::string &zion_cache, const std::string &leaf_name) {
+  if (!ensure_directory_exists(zion_cache)) {
+    return;
+  }
+  const std::string filename = zion_cache + "/" + leaf_name;
+  int fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd == -1) {
+    return;
+  }
+  if (flock(fd, LOCK_EX) == 0) {
+    const std::string text = std::to_string(read_count(fd) + 1) + "\n";
+    if (ftruncate(fd, 0) != 0 ||
+        pwrite(fd, text.data(), text.size(), 0) != ssize_t(text.size())) {
+      debug_above(1, log("unable to count in %s", filename.c_str()));
+    }
+  }
+  close(fd);
+}
+
+std::size_t get_count(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return 0;
+  }
+  flock(fd, LOCK_SH);
+  std::size_t count = read_count(fd);
+  close(fd);
+  return count;
+}
+
+bool copy_file(const std::string &source, const std::string &dest) {
+  int in = open(source.c_str(), O_RDONLY);
+  if (in == -1) {
+    return false;
+  }
+  int out = open(dest.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0755);
+  if (out == -1) {
+    close(in);
+    return false;
+  }
+
+  bool copied = true;
+  char buffer[64 * 1024];
+  while (copied) {
+    auto count = ::read(in, buffer, sizeof(buffer));
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      copied = count == 0;
+      break;
+    }
+    for (ssize_t written = 0; written < count;) {
+      auto result = ::write(out, buffer + written, count - written);
+      if (result < 0 && errno != EINTR) {
+        copied = false;
+        break;
+      }
+      written += std::max(result, ssize_t(0));
+    }
+  }
+  close(in);
+  return close(out) == 0 && copied;
+}
+
+/* copy source to dest by way of a private file, so that nobody ever runs a
+ * partial executable. the private file is written into temp_dir, which must be
+ * on the same file system as dest, or beside dest when temp_dir is empty. */
+bool replace_file(const std::string &source,
+                  const std::string &dest,
+                  const std::string &temp_dir = "") {
+  std::string temp_filename = string_format(
+      "%s.%d",
+      temp_dir.empty() ? dest.c_str()
+                       : (temp_dir + "/" + leaf_from_file_path(dest)).c_str(),
+      (int)getpid());
+  if (!copy_file(source, temp_filename) ||
+      std::rename(temp_filename.c_str(), dest.c_str()) != 0) {
+    std::remove(temp_filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+/* the number of files in dir whose names match regex, and their total size */
+std::uintmax_t get_files_size(const std::string &dir,
+                              const std::string &regex,
+                              std::size_t &file_count) {
+  std::vector<std::string> leaf_names;
+  std::uintmax_t total = 0;
+  file_count = 0;
+  if (list_files(dir, regex, leaf_names)) {
+    for (auto &leaf_name : leaf_names) {
+      struct stat st;
+      if (stat((dir + "/" + leaf_name).c_str(), &st) == 0 &&
+          S_ISREG(st.st_mode)) {
+        total += st.st_size;
+        ++file_count;
+      }
+    }
+  }
+  return total;
+}
+
+void remove_files(const std::string &dir, const std::string &regex) {
+  std::vector<std::string> leaf_names;
+  if (list_files(dir, regex, leaf_names)) {
+    for (auto &leaf_name : leaf_names) {
+      std::remove((dir + "/" + leaf_name).c_str());
+    }
+  }
+}
+
+} // namespace
+
+std::string get_build_key(const Compilation &compilation,
+                          const std::string &c_flags,
+                          const std::string &lib_flags,
+                          const std::vector<std::string> &runtime_sources) {
+  if (get_zion_cache().empty()) {
+    return "";
+  }
+
+  std::uint64_t hash = interface_hash(get_compiler_stamp(),
+                                      interface_hash(build_format));
+  hash = interface_hash(compilation.program_name, hash);
+  /* the interface keys already name every module and the hashes of their
+   * sources */
+  for (auto &pair : compilation.interface_keys) {
+    hash = interface_hash(pair.first, hash);
+    hash = interface_hash(pair.second, hash);
+  }
+  for (auto &link_in : compilation.link_ins) {
+    hash = interface_hash(std::to_string(link_in.lit), hash);
+    hash = interface_hash(link_in.name.text, hash);
+  }
+  for (auto &runtime_source : runtime_sources) {
+    MappedFile source(runtime_source);
+    hash = interface_hash(runtime_source, hash);
+    hash = interface_hash(source.good() ? source.view() : "", hash);
+    for (auto &header : get_included_headers(runtime_source, c_flags)) {
+      MappedFile header_file(header);
+      hash = interface_hash(header, hash);
+      hash = interface_hash(header_file.good() ? header_file.view() : "",
+                            hash);
+    }
+  }
+  hash = interface_hash(get_opt_flags(), hash);
+  hash = interface_hash(std::to_string(get_specialize_budget()), hash);
+  hash = interface_hash(get_clang(), hash);
+  hash = interface_hash(c_flags, hash);
+  hash = interface_hash(lib_flags, hash);
+  return string_format("%016llx", (unsigned long long)hash);
+}
+
+bool restore_build(const std::string &build_key,
+                   const std::string &executable) {
+  const std::string zion_cache = get_zion_cache();
+  const std::string cached_filename = get_executables_dir(zion_cache) + "/" +
+                                      build_key;
+  if (!file_exists(cached_filename) ||
+      !replace_file(cached_filename, executable)) {
+    count(zion_cache, "build-misses");
+    return false;
+  }
+
+  /* eviction goes by modification time, so mark this one as recently used */
+  utimes(cached_filename.c_str(), nullptr);
+  count(zion_cache, "build-hits");
+  debug_above(1, log("reusing %s for %s", cached_filename.c_str(),
+                     executable.c_str()));
+  return true;
+}
+
+void save_build(const std::string &build_key, const std::string &executable) {
+  const std::string zion_cache = get_zion_cache();
+  const std::string executables_dir = get_executables_dir(zion_cache);
+  const std::string temp_dir = get_temp_dir(zion_cache);
+  if (!ensure_directory_exists(executables_dir) ||
+      !ensure_directory_exists(temp_dir) ||
+      !replace_file(executable, executables_dir + "/" + build_key, temp_dir)) {
+    log("unable to save %s to the build cache in %s", executable.c_str(),
+        executables_dir.c_str());
+    return;
+  }
+  evict_least_recently_used(executables_dir, get_max_executable_bytes());
+}
+
+void evict_least_recently_used(const std::string &dir,
+                               std::uintmax_t max_bytes) {
+  std::vector<std::string> leaf_names;
+  if (!list_files(dir, "", leaf_names)) {
+    return;
+  }
+
+  struct CachedFile {
+    std::string filename;
+    std::time_t mtime;
+    std::uintmax_t size;
+  };
+  std::vector<CachedFile> files;
+  std::uintmax_t total = 0;
+  for (auto &leaf_name : leaf_names) {
+    std::string filename = dir + "/" + leaf_name;
+    struct stat st;
+    if (stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      files.push_back({filename, st.st_mtime, (std::uintmax_t)st.st_size});
+      total += st.st_size;
+    }
+  }
+
+  std::sort(files.begin(), files.end(),
+            [](const CachedFile &a, const CachedFile &b) {
+              return a.mtime < b.mtime;
+            });
+  for (auto &file : files) {
+    if (total <= max_bytes) {
+      break;
+    }
+    if (std::remove(file.filename.c_str()) == 0) {
+      debug_above(1, log("evicted %s from the build cache",
+                         file.filename.c_str()));
+      total -= file.size;
+    }
+  }
+}
+
+BuildCacheStats get_build_cache_stats() {
+  BuildCacheStats stats;
+  stats.cache_dir = get_zion_cache();
+  stats.max_executable_bytes = get_max_executable_bytes();
+  if (stats.cache_dir.empty()) {
+    return stats;
+  }
+
+  stats.executable_bytes = get_files_size(
+      get_executables_dir(stats.cache_dir), "", stats.executables);
+  stats.hits = get_count(stats.cache_dir + "/build-hits");
+  stats.misses = get_count(stats.cache_dir + "/build-misses");
+  stats.interface_bytes = get_files_size(stats.cache_dir, "\\.zi$",
+                                         stats.interfaces);
+  stats.bitcode_bytes = get_files_size(stats.cache_dir, "\\.bc$",
+                                       stats.bitcode_files);
+  return stats;
+}
+
+void clear_build_cache() {
+  const std::string zion_cache = get_zion_cache();
+  if (zion_cache.empty()) {
+    return;
+  }
+  remove_files(get_executables_dir(zion_cache), "");
+  remove_files(get_temp_dir(zion_cache), "");
+  remove_files(zion_cache, "\\.(zi|bc)(\\.[0-9]+)?$");
+  std::remove((zion_cache + "/build-hits").c_str());
+  std::remove((zion_cache + "/build-misses").c_str());
+}
+
+} // namespace zion
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "compiler.h"
+
+namespace zion {
+
+/* the key of the executable that linking compilation produces. it covers the
+ * sources of every module in the program, its link-ins, the compiler, the
+ * runtime sources, $ZION_OPT_FLAGS, $ZION_SPECIALIZE_BUDGET and the flags that
+ * pkg-config gave for the link-ins. returns an empty key when ZION_CACHE is not
+ * set, in which case nothing is cached. */
+std::string get_build_key(const Compilation &compilation,
+                          const std::string &c_flags,
+                          const std::string &lib_flags,
+                          const std::vector<std::string> &runtime_sources);
+
+/* copy the executable that was cached under build_key to executable. returns
+ * false if there is no such executable. */
+bool restore_build(const std::string &build_key,
+                   const std::string &executable);
+
+/* cache executable under build_key, then evict the least recently used
+ * executables until the cache fits in $ZION_CACHE_SIZE megabytes. */
+void save_build(const std::string &build_key, const std::string &executable);
+
+/* remove the least recently used files in dir until the rest add up to no more
+ * than max_bytes */
+void evict_least_recently_used(const std::string &dir,
+                               std::uintmax_t max_bytes);
+
+struct BuildCacheStats {
+  std::string cache_dir;
+  std::size_t executables = 0;
+  std::uintmax_t executable_bytes = 0;
+  std::uintmax_t max_executable_bytes = 0;
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  std::size_t interfaces = 0;
+  std::uintmax_t interface_bytes = 0;
+  std::size_t bitcode_files = 0;
+  std::uintmax_t bitcode_bytes = 0;
+};
+
+/* what is in $ZION_CACHE */
+BuildCacheStats get_build_cache_stats();
+
+/* remove the executables, interfaces and runtime bitcode in $ZION_CACHE */
+void clear_build_cache();
+
+} // namespace zion
@@ -156,6 +156,14 @@ const types::Scheme::Map &get_builtins() {
                    {type_operator(type_id(make_iid(PTR_TYPE_OPERATOR)), tv_a),
                     tv_a, type_unit(INTERNAL_LOC())}))
             ->normalize();
+    /* translate replaces this with a call to reserve when the length of the
+     * second parameter is known, otherwise it does nothing */
+    (*map)["__builtin_reserve_for"] =
+        scheme({"a", "b"}, {},
+               type_arrows(
+                   {type_operator(type_id(make_iid(VECTOR_TYPE)), tv_a), tv_b,
+                    type_unit(INTERNAL_LOC())}))
+            ->normalize();
 
     if (getenv("DUMP_BUILTINS") != nullptr &&
         atoi(getenv("DUMP_BUILTINS")) != 0) {
@@ -4,8 +4,8 @@ namespace zion {
 
 CheckedDefinition::CheckedDefinition(types::SchemeRef scheme,
                                      const ast::Decl *decl,
-                                     TrackedTypes tracked_types)
-    : scheme(scheme), decl(decl), tracked_types(tracked_types) {
+                                     TrackedTypesRef tracked_types)
+    : scheme(scheme), decl(decl), tracked_types(std::move(tracked_types)) {
 }
 
 Location CheckedDefinition::get_location() const {
@@ -21,10 +21,11 @@ namespace zion {
 struct CheckedDefinition {
   CheckedDefinition(types::SchemeRef scheme,
                     const ast::Decl *decl,
-                    TrackedTypes tracked_types);
+                    TrackedTypesRef tracked_types);
   types::SchemeRef scheme;
   const ast::Decl *decl;
-  TrackedTypes tracked_types;
+  /* shared by every decl in the same strongly connected component */
+  TrackedTypesRef tracked_types;
 
   Location get_location() const;
 };
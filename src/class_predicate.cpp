@@ -61,7 +61,7 @@ bool ClassPredicate::operator==(const ClassPredicate &rhs) const {
 }
 
 std::string ClassPredicate::repr() const {
-  if (!has_repr_) {
+  std::call_once(repr_once_, [this] {
     std::stringstream ss;
     ss << classname.name;
     for (auto &param : params) {
@@ -72,7 +72,7 @@ std::string ClassPredicate::repr() const {
       }
     }
     repr_ = ss.str();
-  }
+  });
 
   return repr_;
 }
@@ -136,12 +136,11 @@ ClassPredicate::Ref ClassPredicate::rebind(const types::Map &bindings) const {
 }
 
 const Ftvs &ClassPredicate::get_ftvs() const {
-  if (!has_ftvs_) {
+  std::call_once(ftvs_once_, [this] {
     for (auto &param : params) {
       set_merge(ftvs_, param->get_ftvs());
     }
-    has_ftvs_ = true;
-  }
+  });
 
   return ftvs_;
 }
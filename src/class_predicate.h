@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -54,9 +55,9 @@ struct ClassPredicate final
   bool operator==(const ClassPredicate &rhs) const;
 
 private:
-  mutable bool has_repr_ = false;
+  mutable std::once_flag repr_once_;
   mutable std::string repr_;
-  mutable bool has_ftvs_ = false;
+  mutable std::once_flag ftvs_once_;
   mutable Ftvs ftvs_;
 };
 
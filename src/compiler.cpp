@@ -1,8 +1,10 @@
 #include "compiler.h"
 
 #include <cstdarg>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <set>
 #include <sys/stat.h>
 #include <vector>
@@ -10,11 +12,14 @@
 #include "ast.h"
 #include "disk.h"
 #include "import_rules.h"
+#include "interface_cache.h"
 #include "lexer.h"
 #include "link_ins.h"
 #include "parse_state.h"
 #include "parser.h"
 #include "prefix.h"
+#include "thread_pool.h"
+#include "time_trace.h"
 #include "tld.h"
 #include "utils.h"
 #include "zion.h"
@@ -33,11 +38,10 @@ std::string strip_zion_extension(std::string module_name) {
 }
 
 const std::vector<std::string> &get_zion_paths() {
-  static bool checked = false;
-  static std::vector<std::string> zion_paths;
-
-  if (!checked) {
-    checked = true;
+  /* modules are resolved from several threads at once, so let the runtime
+   * guard the one-time initialization */
+  static const std::vector<std::string> zion_paths = [] {
+    std::vector<std::string> zion_paths;
     if (getenv("ZION_PATH") != nullptr) {
       for (auto &path : split(getenv("ZION_PATH"), ":")) {
         if (path != "") {
@@ -57,7 +61,8 @@ const std::vector<std::string> &get_zion_paths() {
       /* fix any paths to be absolute */
       real_path(zion_path, zion_path);
     }
-  }
+    return zion_paths;
+  }();
   return zion_paths;
 }
 
@@ -137,13 +142,32 @@ std::string resolve_module_filename(Location location,
   }
 }
 
+/* everything that parsing a single module produces. modules are parsed
+ * concurrently, so each one fills in its own ParsedModule, and these are
+ * merged into the GlobalParserState in the order a depth-first walk of the
+ * imports would have parsed them. */
+struct ParsedModule {
+  bool opened = false;
+  std::uint64_t source_hash = 0;
+  const Module *module = nullptr;
+  std::string module_name;
+  std::set<Identifier> dependencies;
+  std::map<Identifier, std::string> dependency_filenames;
+  std::map<Identifier, std::exception_ptr> dependency_errors;
+  std::vector<Token> comments;
+  std::set<LinkIn> link_ins;
+  parser::SymbolExports symbol_exports;
+  parser::SymbolImports symbol_imports;
+  std::exception_ptr error;
+};
+
 struct GlobalParserState {
   GlobalParserState(const std::map<std::string, int> &builtin_arities)
       : builtin_arities(builtin_arities) {
   }
   std::vector<const Module *> modules;
-  std::map<std::string, const Module *> modules_map_by_filename;
-  std::map<std::string, const Module *> modules_map_by_name;
+  std::unordered_map<std::string, const Module *> modules_map_by_filename;
+  std::unordered_map<Symbol, const Module *> modules_map_by_name;
   parser::SymbolExports symbol_exports;
   parser::SymbolImports symbol_imports;
   std::vector<Token> comments;
@@ -162,37 +186,129 @@ struct GlobalParserState {
       return module;
     }
 
-    /* we found an unparsed file */
-    std::ifstream ifs;
-    ifs.open(module_filename.c_str());
+    /* parse this module and everything it transitively imports */
+    ThreadPool pool(get_worker_count());
+    claim(pool, module_filename);
+    pool.wait();
 
-    if (ifs.good()) {
-      debug_above(11, log(log_info, "parsing module " c_id("%s"),
-                          module_filename.c_str()));
-      Lexer lexer({module_filename}, ifs);
+    merge_module_statefully(module_id, module_filename);
+    parsed_modules.clear();
+    return modules_map_by_filename.at(module_filename);
+  }
 
-      parser::ParseState ps(module_filename, "", lexer, comments, link_ins,
-                            symbol_exports, symbol_imports, builtin_arities);
+  /* the interface cache keys of every module parsed so far. every module
+   * other than std implicitly depends on std. */
+  std::map<std::string, std::string> get_interface_keys() const {
+    std::map<std::string, std::set<std::string>> imports;
+    for (auto &pair : module_dependencies) {
+      auto &module_imports = imports[pair.first];
+      for (auto &dependency : pair.second) {
+        if (in(dependency, module_filenames)) {
+          module_imports.insert(module_filenames.at(dependency));
+        }
+      }
+      if (in(std::string("std"), module_filenames)) {
+        module_imports.insert(module_filenames.at("std"));
+      }
+    }
+    return zion::get_interface_keys(source_hashes, imports);
+  }
 
-      std::set<Identifier> dependencies;
-      const Module *module = parse_module(ps, {modules_map_by_name["std"]},
-                                          dependencies);
+private:
+  std::mutex mutex;
+  std::unordered_map<std::string, ParsedModule> parsed_modules;
+  /* what the interface cache keys are computed from, by module filename */
+  std::map<std::string, std::uint64_t> source_hashes;
+  std::map<std::string, std::set<std::string>> module_dependencies;
+  std::map<std::string, std::string> module_filenames;
+  /* every module other than std itself auto-imports the exports of std */
+  const Module *std_module = nullptr;
+  std::map<Identifier, Identifier> std_exports;
+
+  void claim(ThreadPool &pool, const std::string &module_filename) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (in(module_filename, modules_map_by_filename) ||
+          !parsed_modules.insert({module_filename, ParsedModule{}}).second) {
+        return;
+      }
+    }
+    pool.enqueue([this, &pool, module_filename] {
+      parse_file(pool, module_filename);
+    });
+  }
 
-      modules.push_back(module);
+  void parse_file(ThreadPool &pool, const std::string &module_filename) {
+    ParsedModule *parsed;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      parsed = &parsed_modules.at(module_filename);
+    }
+
+    try {
+      /* we found an unparsed file */
+      MappedFile source(module_filename);
+      if (!source.good()) {
+        return;
+      }
+      parsed->opened = true;
+      parsed->source_hash = interface_hash(source.view());
+      /* lexing is driven by the parser, so it is timed along with it */
+      TimeTraceScope trace("parse", module_filename);
 
-      /* break any circular dependencies. inject this module into the graph */
-      modules_map_by_name[ps.module_name] = module;
-      modules_map_by_filename[ps.filename] = module;
+      debug_above(11, log(log_info, "parsing module " c_id("%s"),
+                          module_filename.c_str()));
+      parsed->module_name = strip_zion_extension(
+          leaf_from_file_path(module_filename));
+      /* the names this module generates must not depend on which other
+       * modules happen to be parsing at the same time */
+      GensymScope gensym_scope("_" + parsed->module_name);
+      Lexer lexer({module_filename}, source.view());
+
+      if (std_module != nullptr) {
+        parsed->symbol_exports[std_module->name] = std_exports;
+      }
+      parser::ParseState ps(module_filename, parsed->module_name, lexer,
+                            parsed->comments, parsed->link_ins,
+                            parsed->symbol_exports, parsed->symbol_imports,
+                            builtin_arities);
+
+      parsed->module = parse_module(ps, {std_module}, parsed->dependencies);
+      if (parsed->module_name == "std") {
+        /* publish std's exports before any of its imports are parsed */
+        std_module = parsed->module;
+        std_exports = parsed->symbol_exports[parsed->module_name];
+      }
+    } catch (...) {
+      parsed->error = std::current_exception();
+      return;
+    }
 
-      debug_above(8, log("while parsing %s got module dependencies {%s}",
-                         ps.module_name.c_str(),
-                         join(dependencies, ", ").c_str()));
-      for (auto dependency : dependencies) {
-        parse_module_statefully(dependency);
+    debug_above(8, log("while parsing %s got module dependencies {%s}",
+                       parsed->module_name.c_str(),
+                       join(parsed->dependencies, ", ").c_str()));
+    for (auto &dependency : parsed->dependencies) {
+      if (in(dependency.name, modules_map_by_name)) {
+        continue;
+      }
+      try {
+        auto dependency_filename = compiler::resolve_module_filename(
+            dependency.location, dependency.name, ".zion");
+        parsed->dependency_filenames[dependency] = dependency_filename;
+        claim(pool, dependency_filename);
+      } catch (...) {
+        parsed->dependency_errors[dependency] = std::current_exception();
       }
+    }
+  }
 
-      return module;
-    } else {
+  /* fold a parsed module and its imports into the global state, visiting them
+   * (and reporting the first error) exactly as a serial depth-first parse
+   * would have. */
+  void merge_module_statefully(Identifier module_id,
+                               const std::string &module_filename) {
+    auto &parsed = parsed_modules.at(module_filename);
+    if (!parsed.opened) {
       auto error = user_error(
           module_id.location,
           "could not open \"%s\" when trying to link module",
@@ -200,6 +316,48 @@ struct GlobalParserState {
       error.add_info(module_id.location, "imported here");
       throw error;
     }
+    if (parsed.error != nullptr) {
+      std::rethrow_exception(parsed.error);
+    }
+
+    const Module *module = parsed.module;
+    modules.push_back(module);
+
+    /* break any circular dependencies. inject this module into the graph */
+    modules_map_by_name[parsed.module_name] = module;
+    modules_map_by_filename[module_filename] = module;
+
+    source_hashes[module_filename] = parsed.source_hash;
+    module_filenames[parsed.module_name] = module_filename;
+    auto &dependencies = module_dependencies[module_filename];
+    for (auto &dependency : parsed.dependencies) {
+      dependencies.insert(dependency.name);
+    }
+
+    comments.insert(comments.end(), parsed.comments.begin(),
+                    parsed.comments.end());
+    link_ins.insert(parsed.link_ins.begin(), parsed.link_ins.end());
+    /* a module only ever records its own exports and imports */
+    auto &exports = parsed.symbol_exports[parsed.module_name];
+    symbol_exports[parsed.module_name].insert(exports.begin(), exports.end());
+    for (auto &pair : parsed.symbol_imports[parsed.module_name]) {
+      symbol_imports[parsed.module_name][pair.first].insert(
+          pair.second.begin(), pair.second.end());
+    }
+
+    for (auto &dependency : parsed.dependencies) {
+      if (in(dependency.name, modules_map_by_name)) {
+        continue;
+      }
+      if (auto error = get(parsed.dependency_errors, dependency,
+                           std::exception_ptr{})) {
+        std::rethrow_exception(error);
+      }
+      auto &dependency_filename = parsed.dependency_filenames.at(dependency);
+      if (!in(dependency_filename, modules_map_by_filename)) {
+        merge_module_statefully(dependency, dependency_filename);
+      }
+    }
   }
 };
 
@@ -245,7 +403,8 @@ std::shared_ptr<Compilation> merge_compilation(
     std::string program_name,
     std::vector<const Module *> modules,
     const std::vector<Token> &comments,
-    const std::set<LinkIn> &link_ins) {
+    const std::set<LinkIn> &link_ins,
+    const std::map<std::string, std::string> &interface_keys) {
   std::vector<const Decl *> program_decls;
   std::vector<const TypeClass *> program_type_classes;
   std::vector<const Instance *> program_instances;
@@ -260,8 +419,8 @@ std::shared_ptr<Compilation> merge_compilation(
         module->decls, module->type_decls, module->type_classes,
         module->imports);
 
-    std::set<std::string> bindings;
-    for (auto binding : maybe_not_tld_bindings) {
+    std::unordered_set<Symbol> bindings;
+    for (auto &binding : maybe_not_tld_bindings) {
       bindings.insert(binding);
       bindings.insert(tld::tld(binding));
     }
@@ -312,7 +471,8 @@ std::shared_ptr<Compilation> merge_compilation(
       new Program(program_decls, program_type_classes, program_instances,
                   new Application(new Var(make_iid("main")),
                                   {unit_expr(INTERNAL_LOC())})),
-      comments, link_ins, DataCtorsMap{data_ctors_map, ctor_id_map}, type_env);
+      comments, link_ins, DataCtorsMap{data_ctors_map, ctor_id_map}, type_env,
+      interface_keys);
 }
 
 Compilation::ref parse_program(
@@ -355,7 +515,7 @@ Compilation::ref parse_program(
     return merge_compilation(
         program_filename, program_name,
         rewrite_modules(rewriting_imports_rules, gps.modules), gps.comments,
-        gps.link_ins);
+        gps.link_ins, gps.get_interface_keys());
 
   } catch (user_error &e) {
     print_exception(e);
@@ -1,5 +1,6 @@
 #pragma once
 #include <list>
+#include <map>
 #include <vector>
 
 #include "ast_decls.h"
@@ -17,10 +18,12 @@ struct Compilation {
               std::vector<Token> comments,
               const std::set<LinkIn> &link_ins,
               const DataCtorsMap &data_ctors_map,
-              const types::TypeEnv &type_env)
+              const types::TypeEnv &type_env,
+              const std::map<std::string, std::string> &interface_keys)
       : program_filename(program_filename), program_name(program_name),
         program(program), comments(comments), link_ins(link_ins),
-        data_ctors_map(data_ctors_map), type_env(type_env) {
+        data_ctors_map(data_ctors_map), type_env(type_env),
+        interface_keys(interface_keys) {
   }
 
   std::string const program_filename;
@@ -30,6 +33,8 @@ struct Compilation {
   std::set<LinkIn> const link_ins;
   DataCtorsMap const data_ctors_map;
   types::TypeEnv const type_env;
+  /* the interface cache key of each module, by filename */
+  std::map<std::string, std::string> const interface_keys;
 };
 
 namespace compiler {
@@ -85,7 +85,7 @@ std::map<std::string, types::Ref> get_data_ctors_types(
 
 int get_ctor_id(Location location,
                 const DataCtorsMap &data_ctors_map,
-                std::string ctor_name) {
+                Symbol ctor_name) {
   auto iter = data_ctors_map.ctor_id_map.find(ctor_name);
   if (iter == data_ctors_map.ctor_id_map.end()) {
     // dbg();
@@ -128,7 +128,10 @@ types::Ref get_fresh_data_ctor_type(const DataCtorsMap &data_ctors_map,
 std::string str(const zion::DataCtorsMap &data_ctors_map) {
   std::stringstream ss;
   const char *delim = "";
-  for (auto pair : data_ctors_map.data_ctors_type_map) {
+  std::map<Symbol, types::Map> ordered_data_ctors_type_map(
+      data_ctors_map.data_ctors_type_map.begin(),
+      data_ctors_map.data_ctors_type_map.end());
+  for (auto pair : ordered_data_ctors_type_map) {
     ss << delim << pair.first << ": " << ::str(pair.second);
     delim = ", ";
   }
@@ -5,8 +5,8 @@
 
 namespace zion {
 
-typedef std::map<std::string, types::Map> ParsedDataCtorsMap;
-typedef std::unordered_map<std::string, int> ParsedCtorIdMap;
+typedef std::unordered_map<Symbol, types::Map> ParsedDataCtorsMap;
+typedef std::unordered_map<Symbol, int> ParsedCtorIdMap;
 
 struct DataCtorsMap {
   ParsedDataCtorsMap const data_ctors_type_map;
@@ -20,7 +20,7 @@ types::Ref get_data_ctor_type(const DataCtorsMap &data_ctors_map,
                               const Identifier &ctor_id);
 int get_ctor_id(Location location,
                 const DataCtorsMap &data_ctors_map,
-                std::string ctor_name);
+                Symbol ctor_name);
 
 types::Ref get_fresh_data_ctor_type(const DataCtorsMap &data_ctors_map,
                                     Identifier ctor_id);
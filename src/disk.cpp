@@ -14,7 +14,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <string>
+#include <fcntl.h>
 #include <sys/errno.h>
+#include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -217,3 +219,44 @@ std::string leaf_from_file_path(const std::string &file_path) {
 
   return file_path.substr(pos + 1);
 }
+
+MappedFile::MappedFile(const std::string &file_path) {
+  int fd = open(file_path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    size = st.st_size;
+    if (size == 0) {
+      /* mmap refuses empty mappings, but an empty file is still a file */
+      opened = true;
+    } else {
+      void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping != MAP_FAILED) {
+        data = static_cast<const char *>(mapping);
+        opened = true;
+      } else {
+        size = 0;
+      }
+    }
+  }
+
+  /* the mapping outlives the descriptor */
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data != nullptr) {
+    munmap(const_cast<char *>(data), size);
+  }
+}
+
+bool MappedFile::good() const {
+  return opened;
+}
+
+std::string_view MappedFile::view() const {
+  return std::string_view(data, size);
+}
@@ -7,6 +7,7 @@
 #pragma once
 #include <stdint.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 bool folder_exists(const std::string &path);
@@ -27,3 +28,20 @@ bool list_files(const std::string &folder,
                 const std::string &regex_match,
                 std::vector<std::string> &leaf_names);
 std::string ensure_ext(std::string name, std::string ext);
+
+/* a read-only, memory-mapped view of a file's contents. the view is valid for
+ * the lifetime of the MappedFile. */
+struct MappedFile {
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  explicit MappedFile(const std::string &file_path);
+  ~MappedFile();
+
+  bool good() const;
+  std::string_view view() const;
+
+private:
+  bool opened = false;
+  const char *data = nullptr;
+  size_t size = 0;
+};
@@ -0,0 +1,758 @@
+#include "emit.h"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <llvm/Transforms/Scalar.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dbg.h"
+#include "disk.h"
+#include "interface_cache.h"
+#include "logger.h"
+#include "tarjan.h"
+#include "thread_pool.h"
+#include "time_trace.h"
+#include "user_error.h"
+#include "utils.h"
+
+namespace zion {
+
+const char *get_opt_flags() {
+  return getenv("ZION_OPT_FLAGS") != nullptr ? getenv("ZION_OPT_FLAGS") : "";
+}
+
+namespace {
+
+std::string get_cache_dir() {
+  if (getenv("ZION_CACHE") != nullptr && getenv("ZION_CACHE")[0] != '\0') {
+    return getenv("ZION_CACHE");
+  }
+  return getenv("TMPDIR") != nullptr ? getenv("TMPDIR") : ".";
+}
+
+std::unique_ptr<llvm::TargetMachine> create_target_machine() {
+  std::string triple = llvm::sys::getDefaultTargetTriple();
+  std::string error;
+  const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple,
+                                                                  error);
+  if (target == nullptr) {
+    throw user_error(INTERNAL_LOC(), "unable to find target %s: %s",
+                     triple.c_str(), error.c_str());
+  }
+
+  llvm::CodeGenOpt::Level codegen_opt_level;
+  switch (get_opt_level()) {
+  case 0:
+    codegen_opt_level = llvm::CodeGenOpt::None;
+    break;
+  case 1:
+    codegen_opt_level = llvm::CodeGenOpt::Less;
+    break;
+  case 2:
+    codegen_opt_level = llvm::CodeGenOpt::Default;
+    break;
+  default:
+    codegen_opt_level = llvm::CodeGenOpt::Aggressive;
+    break;
+  }
+
+  return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+      triple, llvm::sys::getHostCPUName(), "" /*features*/,
+      llvm::TargetOptions{}, llvm::Reloc::PIC_, llvm::None,
+      codegen_opt_level));
+}
+
+/* the target machine for the host. it is not safe to generate code with it
+ * from more than one thread at a time. */
+llvm::TargetMachine *get_target_machine() {
+  static std::once_flag once;
+  static std::unique_ptr<llvm::TargetMachine> target_machine;
+  std::call_once(once, [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    target_machine = create_target_machine();
+  });
+  return target_machine.get();
+}
+
+/* the largest allocation that is worth moving onto the stack */
+const std::uint64_t max_demoted_bytes = 256;
+
+std::atomic<std::int64_t> demoted_allocation_count{0};
+
+/* whether the object that allocation points to might outlive the function
+ * that allocated it. only loads from the object, stores into it and
+ * comparisons of its address are known not to leak it. anything else,
+ * including passing its address to another function or storing its address
+ * anywhere at all, is assumed to. */
+bool may_escape(llvm::Instruction *allocation) {
+  std::vector<llvm::Value *> pointers{allocation};
+  while (!pointers.empty()) {
+    llvm::Value *pointer = pointers.back();
+    pointers.pop_back();
+    for (llvm::User *user : pointer->users()) {
+      if (llvm::isa<llvm::LoadInst>(user) || llvm::isa<llvm::ICmpInst>(user)) {
+        continue;
+      } else if (auto store = llvm::dyn_cast<llvm::StoreInst>(user)) {
+        if (store->getValueOperand() == pointer) {
+          return true;
+        }
+      } else if (llvm::isa<llvm::BitCastInst>(user) ||
+                 llvm::isa<llvm::GetElementPtrInst>(user) ||
+                 llvm::isa<llvm::AddrSpaceCastInst>(user)) {
+        pointers.push_back(user);
+      } else {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/* whether call allocates memory from the collector. generated code allocates
+ * through zion_malloc, which becomes a call to GC_malloc once the runtime has
+ * been inlined into it. */
+bool is_allocation(llvm::CallInst *call) {
+  llvm::Function *callee = call->getCalledFunction();
+  return callee != nullptr && call->arg_size() == 1 &&
+         (callee->getName() == "zion_malloc" ||
+          callee->getName() == "GC_malloc");
+}
+
+/* replaces the fixed size objects that generated code allocates through
+ * zion_malloc with stack slots, as long as they never escape the function
+ * that allocates them. this runs after inlining, when most of the tuples,
+ * data constructor payloads and closures that only live for the length of a
+ * call have become local to its caller, and it is followed by SROA so that
+ * the stack slots become registers. */
+class DemoteAllocations : public llvm::FunctionPass {
+public:
+  static char ID;
+  DemoteAllocations() : llvm::FunctionPass(ID) {}
+
+  bool runOnFunction(llvm::Function &llvm_function) override {
+    std::vector<std::pair<llvm::CallInst *, std::uint64_t>> demotions;
+    for (llvm::BasicBlock &llvm_block : llvm_function) {
+      for (llvm::Instruction &llvm_instruction : llvm_block) {
+        auto call = llvm::dyn_cast<llvm::CallInst>(&llvm_instruction);
+        if (call == nullptr || !is_allocation(call)) {
+          continue;
+        }
+        auto size = llvm::dyn_cast<llvm::ConstantInt>(call->getArgOperand(0));
+        if (size != nullptr && size->getZExtValue() <= max_demoted_bytes &&
+            !may_escape(call)) {
+          demotions.push_back({call, size->getZExtValue()});
+        }
+      }
+    }
+
+    llvm::BasicBlock &entry_block = llvm_function.getEntryBlock();
+    for (auto &demotion : demotions) {
+      llvm::CallInst *call = demotion.first;
+      const std::uint64_t size = demotion.second;
+      llvm::IRBuilder<> builder(&entry_block,
+                                entry_block.getFirstInsertionPt());
+      llvm::AllocaInst *llvm_alloca = builder.CreateAlloca(
+          llvm::ArrayType::get(builder.getInt8Ty(), size));
+      llvm_alloca->setAlignment(llvm::Align(16));
+
+      /* the collector hands out zeroed memory, and a slot that is reused on
+       * each trip around a loop must start out zeroed every time */
+      builder.SetInsertPoint(call);
+      llvm::Value *pointer = builder.CreateBitCast(llvm_alloca,
+                                                   call->getType());
+      builder.CreateMemSet(pointer, builder.getInt8(0), size,
+                           llvm::MaybeAlign(16));
+      call->replaceAllUsesWith(pointer);
+      call->eraseFromParent();
+    }
+
+    if (!demotions.empty()) {
+      demoted_allocation_count += demotions.size();
+      time_trace_add_counter("demoted allocations", demotions.size());
+    }
+    return !demotions.empty();
+  }
+};
+
+char DemoteAllocations::ID = 0;
+
+void run_optimization_passes(llvm::Module &llvm_module,
+                             llvm::TargetMachine &target_machine) {
+  TimeTraceScope trace("optimize", llvm_module.getModuleIdentifier());
+  const int opt_level = get_opt_level();
+  llvm::PassManagerBuilder pass_manager_builder;
+  pass_manager_builder.OptLevel = opt_level;
+  if (opt_level > 1) {
+    pass_manager_builder.Inliner = llvm::createFunctionInliningPass(
+        opt_level, 0 /*size_opt_level*/,
+        false /*disable_inline_hot_call_site*/);
+  }
+  if (opt_level > 0) {
+    pass_manager_builder.addExtension(
+        llvm::PassManagerBuilder::EP_ScalarOptimizerLate,
+        [](const llvm::PassManagerBuilder &,
+           llvm::legacy::PassManagerBase &passes) {
+          passes.add(new DemoteAllocations());
+          passes.add(llvm::createSROAPass());
+        });
+  }
+  target_machine.adjustPassManager(pass_manager_builder);
+
+  llvm::legacy::FunctionPassManager function_passes(&llvm_module);
+  llvm::legacy::PassManager module_passes;
+  pass_manager_builder.populateFunctionPassManager(function_passes);
+  pass_manager_builder.populateModulePassManager(module_passes);
+
+  function_passes.doInitialization();
+  for (llvm::Function &llvm_function : llvm_module) {
+    function_passes.run(llvm_function);
+  }
+  function_passes.doFinalization();
+  module_passes.run(llvm_module);
+}
+
+void write_object_file(llvm::Module &llvm_module,
+                       llvm::TargetMachine &target_machine,
+                       const std::string &filename) {
+  TimeTraceScope trace("codegen", filename);
+  std::error_code error_code;
+  llvm::raw_fd_ostream os(filename, error_code, llvm::sys::fs::OF_None);
+  if (error_code) {
+    throw user_error(INTERNAL_LOC(), "unable to open %s: %s", filename.c_str(),
+                     error_code.message().c_str());
+  }
+  llvm::legacy::PassManager codegen_passes;
+  if (target_machine.addPassesToEmitFile(codegen_passes, os,
+                                         nullptr /*dwo_os*/,
+                                         llvm::CGFT_ObjectFile)) {
+    throw user_error(INTERNAL_LOC(),
+                     "the host target cannot emit object files");
+  }
+  codegen_passes.run(llvm_module);
+  os.flush();
+}
+
+bool is_local_constant(const llvm::GlobalValue &global) {
+  auto global_variable = llvm::dyn_cast<llvm::GlobalVariable>(&global);
+  return global_variable != nullptr && global_variable->isConstant() &&
+         global_variable->hasLocalLinkage();
+}
+
+/* split llvm_module into at most partition_count modules. functions are
+ * grouped by the strongly connected components of the call graph, and the
+ * groups are spread across the partitions by size. global variables live in
+ * the first partition, and local constants are copied into every partition
+ * that might use them. */
+std::vector<std::unique_ptr<llvm::Module>> split_module(
+    llvm::Module &llvm_module,
+    int partition_count) {
+  /* functions are assigned to partitions by name */
+  int unnamed_count = 0;
+  for (llvm::GlobalValue &global : llvm_module.global_values()) {
+    if (global.isDeclaration() || !global.hasLocalLinkage() ||
+        is_local_constant(global)) {
+      continue;
+    }
+    if (!global.hasName()) {
+      global.setName(string_format("__zion_partition_%d", unnamed_count++));
+    }
+  }
+
+  tarjan::Graph graph;
+  std::unordered_map<Symbol, std::size_t> function_sizes;
+  for (llvm::Function &llvm_function : llvm_module) {
+    if (llvm_function.isDeclaration()) {
+      continue;
+    }
+    Symbol name = llvm_function.getName().str();
+    function_sizes[name] = llvm_function.getInstructionCount();
+    auto &callees = graph[name];
+    for (llvm::BasicBlock &llvm_block : llvm_function) {
+      for (llvm::Instruction &llvm_instruction : llvm_block) {
+        for (llvm::Value *operand : llvm_instruction.operand_values()) {
+          auto callee = llvm::dyn_cast<llvm::Function>(
+              operand->stripPointerCasts());
+          if (callee != nullptr && !callee->isDeclaration()) {
+            callees.insert(callee->getName().str());
+          }
+        }
+      }
+    }
+  }
+
+  /* place the largest components first, each into the smallest partition */
+  std::vector<std::pair<std::size_t, tarjan::Vertices>> components;
+  for (auto &scc : tarjan::compute_strongly_connected_components(graph)) {
+    std::size_t size = 0;
+    for (auto &name : scc) {
+      size += function_sizes.at(name);
+    }
+    components.push_back({size, scc});
+  }
+  std::sort(components.begin(), components.end(),
+            [](const auto &a, const auto &b) {
+              if (a.first != b.first) {
+                return a.first > b.first;
+              }
+              return *a.second.begin() < *b.second.begin();
+            });
+
+  std::vector<std::size_t> partition_sizes(partition_count);
+  std::unordered_map<Symbol, int> partition_of;
+  for (auto &component : components) {
+    int partition = std::min_element(partition_sizes.begin(),
+                                     partition_sizes.end()) -
+                    partition_sizes.begin();
+    partition_sizes[partition] += component.first;
+    for (auto &name : component.second) {
+      partition_of[name] = partition;
+    }
+  }
+
+  /* the partition that defines global, or -1 for a local constant, which is
+   * copied into every partition */
+  auto get_partition = [&](const llvm::GlobalValue &global) {
+    if (is_local_constant(global)) {
+      return -1;
+    } else if (llvm::isa<llvm::Function>(global)) {
+      auto iter = partition_of.find(global.getName().str());
+      return iter != partition_of.end() ? iter->second : 0;
+    }
+    return 0;
+  };
+
+  /* whether anything outside of the partition that defines global uses it */
+  auto is_used_elsewhere = [&](const llvm::GlobalValue &global) {
+    const int partition = get_partition(global);
+    std::vector<const llvm::User *> users(global.user_begin(),
+                                          global.user_end());
+    std::set<const llvm::User *> visited;
+    while (!users.empty()) {
+      const llvm::User *user = users.back();
+      users.pop_back();
+      if (!visited.insert(user).second) {
+        continue;
+      } else if (auto instruction = llvm::dyn_cast<llvm::Instruction>(user)) {
+        if (get_partition(*instruction->getFunction()) != partition) {
+          return true;
+        }
+      } else if (auto user_global = llvm::dyn_cast<llvm::GlobalValue>(user)) {
+        if (get_partition(*user_global) != partition) {
+          return true;
+        }
+      } else {
+        /* look through constant expressions and initializers */
+        users.insert(users.end(), user->user_begin(), user->user_end());
+      }
+    }
+    return false;
+  };
+
+  /* only what another partition refers to needs a symbol. everything else
+   * stays internal, so that each partition can still drop what it does not
+   * use and rewrite the signatures of what it does. */
+  for (llvm::GlobalValue &global : llvm_module.global_values()) {
+    if (global.isDeclaration() || !global.hasLocalLinkage() ||
+        is_local_constant(global) || !is_used_elsewhere(global)) {
+      continue;
+    }
+    global.setLinkage(llvm::GlobalValue::ExternalLinkage);
+    global.setVisibility(llvm::GlobalValue::HiddenVisibility);
+  }
+
+  std::vector<std::unique_ptr<llvm::Module>> partitions;
+  for (int i = 0; i < partition_count; ++i) {
+    if (i != 0 && partition_sizes[i] == 0) {
+      continue;
+    }
+    llvm::ValueToValueMapTy value_map;
+    partitions.push_back(llvm::CloneModule(
+        llvm_module, value_map, [&](const llvm::GlobalValue *global) {
+          if (is_local_constant(*global)) {
+            return true;
+          } else if (llvm::isa<llvm::Function>(global)) {
+            auto iter = partition_of.find(global->getName().str());
+            return iter != partition_of.end() && iter->second == i;
+          }
+          return i == 0;
+        }));
+  }
+  return partitions;
+}
+
+/* the flags in flags, ignoring their order and how they are spaced */
+std::set<std::string> get_flag_set(std::string flags) {
+  std::replace(flags.begin(), flags.end(), '\n', ' ');
+  std::set<std::string> flag_set;
+  for (auto &flag : split(flags, " ")) {
+    if (!flag.empty()) {
+      flag_set.insert(flag);
+    }
+  }
+  return flag_set;
+}
+
+/* the bitcode that `make install` built next to c_filename, as long as it is
+ * newer than the source, was compiled with the flags that this compilation
+ * would use, and can be read by this version of LLVM. otherwise "". */
+std::string get_installed_bitcode(const std::string &c_filename,
+                                  const std::string &leaf_name,
+                                  const std::string &c_flags) {
+  struct stat source_stat, installed_stat;
+  const std::string installed_filename = directory_from_file_path(c_filename) +
+                                         "/" + leaf_name + ".bc";
+  if (stat(c_filename.c_str(), &source_stat) != 0 ||
+      stat(installed_filename.c_str(), &installed_stat) != 0 ||
+      installed_stat.st_mtime < source_stat.st_mtime) {
+    return "";
+  }
+
+  /* install records the flags that it compiled with beside the bitcode */
+  MappedFile installed_flags(installed_filename + ".flags");
+  if (!installed_flags.good() ||
+      get_flag_set(std::string(installed_flags.view())) !=
+          get_flag_set(c_flags + " " + get_opt_flags())) {
+    debug_above(1, log("not using %s, which was built with other flags",
+                       installed_filename.c_str()));
+    return "";
+  }
+
+  /* a clang from another release of LLVM may have written it */
+  llvm::LLVMContext context;
+  llvm::SMDiagnostic error;
+  if (llvm::parseIRFile(installed_filename, error, context) == nullptr) {
+    debug_above(1, log("not using %s: %s", installed_filename.c_str(),
+                       error.getMessage().str().c_str()));
+    return "";
+  }
+  return installed_filename;
+}
+
+} // namespace
+
+std::int64_t get_demoted_allocation_count() {
+  return demoted_allocation_count;
+}
+
+int get_opt_level() {
+  int opt_level = 0;
+  for (auto &flag : split(get_opt_flags(), " ")) {
+    if (flag == "-O" || flag == "-O1") {
+      opt_level = 1;
+    } else if (flag == "-O2" || flag == "-Os" || flag == "-Oz") {
+      opt_level = 2;
+    } else if (flag == "-O3" || flag == "-Ofast") {
+      opt_level = 3;
+    } else if (flag == "-O0") {
+      opt_level = 0;
+    }
+  }
+  return opt_level;
+}
+
+std::string get_clang() {
+#ifdef __APPLE__
+  return "\"$(brew --prefix)/opt/llvm/bin/clang\" "
+         "-I \"$(xcrun --sdk macosx --show-sdk-path)/usr/include\"";
+#else
+  /* bitcode from a clang of another LLVM release may not load */
+  const std::string llvm_clang = std::string(ZION_LLVM_TOOLS_DIR) + "/clang";
+  return file_exists(llvm_clang) ? "\"" + llvm_clang + "\"" : "clang";
+#endif
+}
+
+void optimize_module(llvm::Module &llvm_module) {
+  run_optimization_passes(llvm_module, *get_target_machine());
+}
+
+void emit_object_file(llvm::Module &llvm_module, const std::string &filename) {
+  llvm::TargetMachine *target_machine = get_target_machine();
+  llvm_module.setTargetTriple(target_machine->getTargetTriple().str());
+  llvm_module.setDataLayout(target_machine->createDataLayout());
+  run_optimization_passes(llvm_module, *target_machine);
+  write_object_file(llvm_module, *target_machine, filename);
+}
+
+std::vector<std::string> emit_object_files(llvm::Module &llvm_module,
+                                           const std::string &filename_prefix,
+                                           int partition_count) {
+  if (partition_count <= 1) {
+    const std::string filename = filename_prefix + ".o";
+    emit_object_file(llvm_module, filename);
+    return {filename};
+  }
+
+  llvm::TargetMachine *target_machine = get_target_machine();
+  llvm_module.setTargetTriple(target_machine->getTargetTriple().str());
+  llvm_module.setDataLayout(target_machine->createDataLayout());
+
+  /* each partition travels to its worker as bitcode, so that it can be loaded
+   * into a context of its own */
+  std::vector<std::string> bitcodes;
+  for (auto &partition : split_module(llvm_module, partition_count)) {
+    std::string bitcode;
+    llvm::raw_string_ostream os(bitcode);
+    llvm::WriteBitcodeToFile(*partition, os);
+    os.flush();
+    bitcodes.push_back(std::move(bitcode));
+  }
+
+  std::vector<std::string> filenames;
+  for (std::size_t i = 0; i < bitcodes.size(); ++i) {
+    filenames.push_back(
+        string_format("%s.%d.o", filename_prefix.c_str(), int(i)));
+  }
+
+  std::mutex failure_mutex;
+  std::exception_ptr failure;
+  ThreadPool pool(get_worker_count());
+  for (std::size_t i = 0; i < bitcodes.size(); ++i) {
+    pool.enqueue([&, i] {
+      try {
+        llvm::LLVMContext context;
+        auto partition = llvm::parseBitcodeFile(
+            llvm::MemoryBufferRef(bitcodes[i], filenames[i]), context);
+        if (!partition) {
+          throw user_error(INTERNAL_LOC(), "unable to load %s: %s",
+                           filenames[i].c_str(),
+                           llvm::toString(partition.takeError()).c_str());
+        }
+        auto partition_target_machine = create_target_machine();
+        run_optimization_passes(**partition, *partition_target_machine);
+        write_object_file(**partition, *partition_target_machine,
+                          filenames[i]);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(failure_mutex);
+        if (!failure) {
+          failure = std::current_exception();
+        }
+      }
+    });
+  }
+  pool.wait();
+
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  return filenames;
+}
+
+namespace {
+
+std::vector<std::string> get_include_dirs(const std::string &c_flags) {
+  std::vector<std::string> include_dirs;
+  auto flags = split(c_flags, " ");
+  for (std::size_t i = 0; i < flags.size(); ++i) {
+    std::string include_dir;
+    if (flags[i] == "-I" && i + 1 < flags.size()) {
+      include_dir = flags[++i];
+    } else if (starts_with(flags[i], "-I")) {
+      include_dir = flags[i].substr(2);
+    }
+    if (include_dir.size() >= 2 && include_dir.front() == '"' &&
+        include_dir.back() == '"') {
+      include_dir = include_dir.substr(1, include_dir.size() - 2);
+    }
+    if (!include_dir.empty()) {
+      include_dirs.push_back(include_dir);
+    }
+  }
+  return include_dirs;
+}
+
+/* the name in an #include line, and whether it was quoted rather than in
+ * angle brackets. returns false for any other line. */
+bool get_include(std::string_view line, std::string &name, bool &quoted) {
+  auto skip_spaces = [&line]() {
+    while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) {
+      line.remove_prefix(1);
+    }
+  };
+  skip_spaces();
+  if (line.empty() || line.front() != '#') {
+    return false;
+  }
+  line.remove_prefix(1);
+  skip_spaces();
+  if (line.compare(0, 7, "include") != 0) {
+    return false;
+  }
+  line.remove_prefix(7);
+  skip_spaces();
+  if (line.empty() || (line.front() != '"' && line.front() != '<')) {
+    return false;
+  }
+  quoted = line.front() == '"';
+  auto end = line.find(quoted ? '"' : '>', 1);
+  if (end == std::string_view::npos) {
+    return false;
+  }
+  name = std::string(line.substr(1, end - 1));
+  return true;
+}
+
+void add_included_headers(const std::string &filename,
+                          const std::vector<std::string> &include_dirs,
+                          std::set<std::string> &visited,
+                          std::vector<std::string> &headers) {
+  MappedFile file(filename);
+  if (!file.good()) {
+    return;
+  }
+  std::string_view text = file.view();
+  while (!text.empty()) {
+    auto newline = text.find('\n');
+    std::string_view line = text.substr(0, newline);
+    text.remove_prefix(newline == std::string_view::npos ? text.size()
+                                                         : newline + 1);
+    std::string name;
+    bool quoted = false;
+    if (!get_include(line, name, quoted)) {
+      continue;
+    }
+
+    std::vector<std::string> search_dirs;
+    if (quoted) {
+      search_dirs.push_back(directory_from_file_path(filename));
+    }
+    search_dirs.insert(search_dirs.end(), include_dirs.begin(),
+                       include_dirs.end());
+    for (auto &search_dir : search_dirs) {
+      const std::string header = search_dir + "/" + name;
+      if (file_exists(header)) {
+        if (visited.insert(header).second) {
+          headers.push_back(header);
+          add_included_headers(header, include_dirs, visited, headers);
+        }
+        break;
+      }
+    }
+  }
+}
+
+} // namespace
+
+std::vector<std::string> get_included_headers(const std::string &c_filename,
+                                              const std::string &c_flags) {
+  std::set<std::string> visited;
+  std::vector<std::string> headers;
+  add_included_headers(c_filename, get_include_dirs(c_flags), visited,
+                       headers);
+  return headers;
+}
+
+std::string get_runtime_bitcode(const std::string &c_filename,
+                                const std::string &c_flags) {
+  std::string leaf_name = leaf_from_file_path(c_filename);
+  if (ends_with(leaf_name, ".c")) {
+    leaf_name = leaf_name.substr(0, leaf_name.size() - 2);
+  }
+
+  /* prefer the bitcode that was built when the runtime was installed */
+  const std::string installed_filename = get_installed_bitcode(
+      c_filename, leaf_name, c_flags);
+  if (!installed_filename.empty()) {
+    return installed_filename;
+  }
+
+  MappedFile source(c_filename);
+  if (!source.good()) {
+    throw user_error(INTERNAL_LOC(), "unable to read runtime source %s",
+                     c_filename.c_str());
+  }
+
+  /* name the bitcode after everything that goes into compiling it */
+  const std::string command_prefix = string_format(
+      "%s -c -emit-llvm %s %s -Wno-nullability-completeness",
+      get_clang().c_str(), c_flags.c_str(), get_opt_flags());
+  std::uint64_t hash = interface_hash(source.view(),
+                                      interface_hash(command_prefix));
+  for (auto &header : get_included_headers(c_filename, c_flags)) {
+    MappedFile header_file(header);
+    hash = interface_hash(header, hash);
+    hash = interface_hash(header_file.good() ? header_file.view() : "", hash);
+  }
+  const std::string cache_dir = get_cache_dir();
+  const std::string bitcode_filename = string_format(
+      "%s/%s-%016llx.bc", cache_dir.c_str(), leaf_name.c_str(),
+      (unsigned long long)hash);
+  if (file_exists(bitcode_filename)) {
+    return bitcode_filename;
+  }
+
+  /* compile to a private file and then rename it into place, so that a
+   * concurrent build never links partial bitcode */
+  ensure_directory_exists(cache_dir);
+  const std::string temp_filename = string_format(
+      "%s.%d", bitcode_filename.c_str(), (int)getpid());
+  const std::string command_line = string_format(
+      "%s \"%s\" -o \"%s\"", command_prefix.c_str(), c_filename.c_str(),
+      temp_filename.c_str());
+  if (getenv("SHOW_CC") != nullptr) {
+    log("running %s", command_line.c_str());
+  }
+  TimeTraceScope trace("clang", command_line);
+  if (std::system(command_line.c_str()) != 0 ||
+      std::rename(temp_filename.c_str(), bitcode_filename.c_str()) != 0) {
+    std::remove(temp_filename.c_str());
+    throw user_error(INTERNAL_LOC(), "failed to compile runtime source %s",
+                     c_filename.c_str());
+  }
+  return bitcode_filename;
+}
+
+void link_runtime(llvm::Module &llvm_module,
+                  const std::vector<std::string> &bitcode_filenames) {
+  /* agree with the runtime about the target before linking it in */
+  llvm::TargetMachine *target_machine = get_target_machine();
+  llvm_module.setTargetTriple(target_machine->getTargetTriple().str());
+  llvm_module.setDataLayout(target_machine->createDataLayout());
+
+  TimeTraceScope trace("link_runtime");
+  llvm::Linker linker(llvm_module);
+  for (auto &bitcode_filename : bitcode_filenames) {
+    llvm::SMDiagnostic error;
+    std::unique_ptr<llvm::Module> runtime_module = llvm::parseIRFile(
+        bitcode_filename, error, llvm_module.getContext());
+    if (runtime_module == nullptr) {
+      throw user_error(INTERNAL_LOC(), "unable to load runtime bitcode %s: %s",
+                       bitcode_filename.c_str(),
+                       error.getMessage().str().c_str());
+    }
+    runtime_module->setTargetTriple(llvm_module.getTargetTriple());
+    runtime_module->setDataLayout(llvm_module.getDataLayout());
+
+    /* generated code carries no target attributes, and the inliner refuses
+     * to mix functions whose attributes differ */
+    for (llvm::Function &llvm_function : *runtime_module) {
+      llvm_function.removeFnAttr("target-cpu");
+      llvm_function.removeFnAttr("target-features");
+      llvm_function.removeFnAttr("tune-cpu");
+    }
+
+    if (linker.linkInModule(
+            std::move(runtime_module), llvm::Linker::Flags::LinkOnlyNeeded,
+            [](llvm::Module &llvm_module, const llvm::StringSet<> &linked) {
+              /* nothing outside of the program refers to the runtime */
+              llvm::internalizeModule(
+                  llvm_module, [&linked](const llvm::GlobalValue &global) {
+                    return !global.hasName() ||
+                           linked.count(global.getName()) == 0;
+                  });
+            })) {
+      throw user_error(INTERNAL_LOC(), "unable to link runtime bitcode %s",
+                       bitcode_filename.c_str());
+    }
+  }
+}
+
+} // namespace zion
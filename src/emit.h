@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm_zion.h"
+
+namespace zion {
+
+/* the flags in $ZION_OPT_FLAGS, which apply both to compiling the runtime and
+ * to linking programs */
+const char *get_opt_flags();
+
+/* the optimization level requested by an -O flag in $ZION_OPT_FLAGS, which
+ * defaults to 0 just as it does for clang. */
+int get_opt_level();
+
+/* how many allocations optimization has moved from the heap onto the stack
+ * because they could not outlive the functions that made them */
+std::int64_t get_demoted_allocation_count();
+
+/* the clang driver that compiles the runtime and links programs */
+std::string get_clang();
+
+/* run the optimization pipeline that $ZION_OPT_FLAGS asks for over
+ * llvm_module, tuned for the host target. */
+void optimize_module(llvm::Module &llvm_module);
+
+/* optimize llvm_module for the host target, and write it out as a native
+ * object file. */
+void emit_object_file(llvm::Module &llvm_module, const std::string &filename);
+
+/* like emit_object_file, but llvm_module is first split into as many as
+ * partition_count modules, which are optimized and lowered in parallel. calls
+ * between partitions are not inlined. returns the object files written, which
+ * are named after filename_prefix. */
+std::vector<std::string> emit_object_files(llvm::Module &llvm_module,
+                                           const std::string &filename_prefix,
+                                           int partition_count);
+
+/* the headers that c_filename includes, and that they include in turn, that
+ * are found beside the file that includes them or in one of the -I
+ * directories in c_flags. the system's own headers are left out. */
+std::vector<std::string> get_included_headers(const std::string &c_filename,
+                                              const std::string &c_flags);
+
+/* the LLVM bitcode for a runtime C source compiled with c_flags. bitcode
+ * installed next to the source by `make install` is used as long as it is up
+ * to date, was built with the same flags, and is readable by this LLVM.
+ * otherwise the bitcode is kept in the build cache and only rebuilt when the
+ * source, the headers it includes or the flags change. */
+std::string get_runtime_bitcode(const std::string &c_filename,
+                                const std::string &c_flags);
+
+/* link the runtime bitcode files into llvm_module ahead of optimization. only
+ * the runtime functions that the program needs are linked in, and they become
+ * internal to the module so that they can be inlined into generated code. */
+void link_runtime(llvm::Module &llvm_module,
+                  const std::vector<std::string> &bitcode_filenames);
+
+} // namespace zion
@@ -0,0 +1,377 @@
+#include "for_loops.h"
+
+#include "ast.h"
+#include "builtins.h"
+#include "dbg.h"
+#include "patterns.h"
+#include "ptr.h"
+#include "time_trace.h"
+#include "tld.h"
+#include "translate.h"
+
+namespace zion {
+
+using namespace ast;
+
+namespace {
+
+/* the parts of a loop that parse_for_block desugared */
+struct ForLoop {
+  const Expr *iterable = nullptr;
+  const Match *match = nullptr;
+  /* what the loop does with the contents of each Just */
+  PatternBlocks item_blocks;
+};
+
+/* parse_for_block names the iterator with fresh(), calls it only as the match
+ * scrutinee, and loops while True. anything else was written by hand, and may
+ * rely on its condition or on the iterator, so it is not fused. */
+bool is_for_loop_iterator(const Let *let, const While *while_) {
+  auto condition = dcast<const Var *>(while_->condition);
+  return condition != nullptr &&
+         condition->id.name == tld::mktld("std", "True") &&
+         starts_with(let->var.name, "__v");
+}
+
+bool get_for_loop(const Let *let, ForLoop &for_loop) {
+  auto iter = dcast<const Application *>(let->value);
+  auto while_ = dcast<const While *>(let->body);
+  if (iter == nullptr || while_ == nullptr || iter->params.size() != 1 ||
+      !is_for_loop_iterator(let, while_)) {
+    return false;
+  }
+  auto iter_var = dcast<const Var *>(iter->a);
+  auto match = dcast<const Match *>(while_->block);
+  if (iter_var == nullptr || iter_var->id.name != tld::mktld("std", "iter") ||
+      match == nullptr) {
+    return false;
+  }
+  auto next = dcast<const Application *>(match->scrutinee);
+  auto iterator = next != nullptr ? dcast<const Var *>(next->a) : nullptr;
+  if (iterator == nullptr || iterator->id.name != let->var.name ||
+      next->params.size() != 1 ||
+      !get_free_vars(next->params[0], {}).empty()) {
+    return false;
+  }
+
+  std::vector<const CtorPredicate *> justs;
+  std::vector<const Expr *> just_results;
+  for (auto pattern_block : match->pattern_blocks) {
+    auto ctor_predicate = dcast<const CtorPredicate *>(
+        pattern_block->predicate);
+    if (ctor_predicate == nullptr || ctor_predicate->name_assignment.valid ||
+        in(let->var.name, get_free_vars(pattern_block->result, {}))) {
+      return false;
+    }
+    const std::string &ctor_name = ctor_predicate->ctor_name.name;
+    if (ctor_name == tld::mktld("maybe", "Just") &&
+        ctor_predicate->params.size() == 1) {
+      justs.push_back(ctor_predicate);
+      just_results.push_back(pattern_block->result);
+    } else if (ctor_name != tld::mktld("maybe", "Nothing") ||
+               !ctor_predicate->params.empty() ||
+               dcast<const Break *>(pattern_block->result) == nullptr) {
+      return false;
+    }
+  }
+  if (justs.empty()) {
+    return false;
+  }
+
+  for_loop.iterable = iter->params[0];
+  for_loop.match = match;
+  for (size_t i = 0; i < justs.size(); ++i) {
+    for_loop.item_blocks.push_back(
+        new PatternBlock(justs[i]->params[0], just_results[i]));
+  }
+  return true;
+}
+
+/* the type of the items of iterable_type when we know how to count through
+ * it, otherwise nullptr. counts_range is set for a Range of Ints. shared by
+ * fused loops and by reserving room for comprehensions. */
+types::Ref get_counted_item_type(types::Ref iterable_type, bool &counts_range) {
+  counts_range = false;
+  if (iterable_type->ftv_count() != 0) {
+    return nullptr;
+  } else if (auto type_operator = dyncast<const types::TypeOperator>(
+                 iterable_type)) {
+    if (types::is_type_id(type_operator->oper, VECTOR_TYPE)) {
+      return type_operator->operand;
+    } else if (types::is_type_id(type_operator->oper,
+                                 tld::mktld("std", "Range")) &&
+               types::is_type_id(type_operator->operand, INT_TYPE)) {
+      counts_range = true;
+      return type_operator->operand;
+    }
+  } else if (types::is_type_id(iterable_type, STRING_TYPE)) {
+    return type_id(make_iid(CHAR_TYPE));
+  }
+  return nullptr;
+}
+
+/* makes the nodes of a fused loop, which are already translated, and so must
+ * be typed as they are made */
+struct LoopBuilder {
+  const types::DefnId &for_defn_id;
+  Location location;
+  TrackedTypes &typing;
+  types::NeededDefns &needed_defns;
+
+  const Expr *typed(const Expr *expr, types::Ref type) {
+    typing[expr] = type;
+    return expr;
+  }
+
+  const Expr *local(const Identifier &id, types::Ref type) {
+    return typed(new Var(id), type);
+  }
+
+  const Expr *integer(int value) {
+    return typed(
+        new Literal(Token{location, tk_integer, std::to_string(value)}),
+        type_int(location));
+  }
+
+  /* call the overload of the function called name that takes params */
+  const Expr *call(const std::string &name,
+                   const std::vector<const Expr *> &params,
+                   types::Ref result_type) {
+    auto var = new Var(Identifier{name, location});
+    auto function_type = get_function_type(params, result_type);
+    typing[var] = function_type;
+    insert_needed_defn(needed_defns, types::DefnId{var->id, function_type},
+                       location, for_defn_id);
+    return typed(new Application(var, params), result_type);
+  }
+
+  const Expr *builtin(const std::string &name,
+                      const std::vector<const Expr *> &params,
+                      types::Ref result_type) {
+    auto var = new Var(Identifier{name, location});
+    typing[var] = get_function_type(params, result_type);
+    return typed(new Builtin(var, params), result_type);
+  }
+
+  const Expr *let(const Identifier &id, const Expr *value, const Expr *body) {
+    return typed(new Let(id, value, body), typing.at(body));
+  }
+
+  types::Ref get_function_type(const std::vector<const Expr *> &params,
+                               types::Ref result_type) const {
+    types::Refs param_types;
+    for (auto param : params) {
+      param_types.push_back(typing.at(param));
+    }
+    return type_arrow(type_params(param_types), result_type);
+  }
+};
+
+} // namespace
+
+const Expr *translate_for_loop(const types::DefnId &for_defn_id,
+                               const Let *let,
+                               const DataCtorsMap &data_ctors_map,
+                               const std::unordered_set<Symbol> &bound_vars,
+                               const TrackedTypes &tracked_types,
+                               types::Ref type,
+                               const types::TypeEnv &type_env,
+                               TrackedTypes &typing,
+                               types::NeededDefns &needed_defns,
+                               bool &returns) {
+  ForLoop for_loop;
+  if (!get_for_loop(let, for_loop)) {
+    return nullptr;
+  }
+
+  types::Ref iterable_type = get_tracked_type(tracked_types,
+                                              for_loop.iterable);
+  bool counts_range = false;
+  types::Ref item_type = get_counted_item_type(iterable_type, counts_range);
+  if (item_type == nullptr) {
+    return nullptr;
+  }
+  /* the checker leaves it to the Iterable instance to relate the items to the
+   * iterable. when they disagree, leave the loop alone so that resolving iter
+   * reports it. */
+  auto maybe_item = dyncast<const types::TypeOperator>(
+      get_tracked_type(tracked_types, for_loop.match->scrutinee));
+  if (maybe_item == nullptr ||
+      maybe_item->operand->get_signature() != item_type->get_signature()) {
+    return nullptr;
+  }
+
+  const Location location = let->var.location;
+  debug_above(3, log_location(location, "fusing a for loop over %s",
+                              iterable_type->str().c_str()));
+  time_trace_add_counter("fused loops", 1);
+
+  LoopBuilder builder{for_defn_id, location, typing, needed_defns};
+  const types::Ref Int = type_int(location);
+  const types::Ref Bool = type_bool(location);
+  const types::Ref Unit = type_unit(location);
+  const types::Ref RefInt = type_operator(
+      type_id(Identifier{REF_TYPE_OPERATOR, location}), Int);
+  const types::Ref while_type = get_tracked_type(tracked_types, let->body);
+  const Identifier iterable_id{fresh(), location};
+  const Identifier index_id{fresh(), location};
+  const Identifier item_id{fresh(), location};
+
+  auto iterable = texpr(for_defn_id, for_loop.iterable, data_ctors_map,
+                        bound_vars, tracked_types, iterable_type, type_env,
+                        typing, needed_defns, returns);
+
+  auto load_index = [&]() {
+    return builder.call(tld::mktld("std", "load_value"),
+                        {builder.local(index_id, RefInt)}, Int);
+  };
+  auto store_index = [&](const Expr *value) {
+    return builder.builtin("__builtin_store_ref",
+                           {builder.local(index_id, RefInt), value}, Unit);
+  };
+  /* match each item against the patterns that the loop had for each Just.
+   * the index has already moved on, so that `continue` goes to the next
+   * item. */
+  auto translate_item = [&](const std::unordered_set<Symbol> &bound_vars_,
+                            const Expr *next_index) {
+    check_patterns(location, gensym_name(), data_ctors_map,
+                   for_loop.item_blocks, item_type);
+    auto bound_vars = bound_vars_;
+    bound_vars.insert(index_id.name);
+    bound_vars.insert(item_id.name);
+    bool block_returns = false;
+    auto match = build_patterns(
+        for_defn_id, for_loop.item_blocks, 0, data_ctors_map, bound_vars,
+        tracked_types, type_env, typing, needed_defns, block_returns, item_id,
+        item_type, get_tracked_type(tracked_types, for_loop.match));
+    return builder.typed(new Block({store_index(next_index), match}), Unit);
+  };
+
+  auto new_bound_vars = bound_vars;
+  new_bound_vars.insert(iterable_id.name);
+  const Expr *counted_loop = nullptr;
+  if (!counts_range) {
+    /* var index = 0
+     * while index < len(iterable) {
+     *   let item = iterable[index]
+     *   index = index + 1
+     *   match item {...}
+     * } */
+    auto loop = new While(
+        builder.builtin(
+            "__builtin_int_lt",
+            {load_index(),
+             builder.call(tld::mktld("std", "len"),
+                          {builder.local(iterable_id, iterable_type)}, Int)},
+            Bool),
+        builder.let(
+            item_id,
+            builder.call(tld::mktld("std", "get_indexed_item"),
+                         {builder.local(iterable_id, iterable_type),
+                          load_index()},
+                         item_type),
+            translate_item(new_bound_vars,
+                           builder.builtin("__builtin_add_int",
+                                           {load_index(), builder.integer(1)},
+                                           Int))));
+    counted_loop = builder.let(
+        index_id,
+        builder.call(REF_TYPE_OPERATOR, {builder.integer(0)}, RefInt),
+        builder.typed(loop, while_type));
+  } else {
+    /* let Range(range_min, step, range_max) = iterable
+     * var index = range_min
+     * while (step > 0 and index <= range_max) or
+     *       (step <= 0 and index >= range_max) {
+     *   let item = index
+     *   index = item + step
+     *   match item {...}
+     * } */
+    const Identifier range_min_id{fresh(), location};
+    const Identifier step_id{fresh(), location};
+    const Identifier range_max_id{fresh(), location};
+    auto range_predicate = new CtorPredicate(
+        location,
+        {new IrrefutablePredicate(location, maybe<Identifier>(range_min_id)),
+         new IrrefutablePredicate(location, maybe<Identifier>(step_id)),
+         new IrrefutablePredicate(location, maybe<Identifier>(range_max_id))},
+        Identifier{tld::mktld("std", "Range"), location},
+        maybe<Identifier>());
+
+    auto matched = [&](const DataCtorsMap &,
+                       const std::unordered_set<Symbol> &range_bound_vars,
+                       const TrackedTypes &, const types::TypeEnv &,
+                       TrackedTypes &, types::NeededDefns &,
+                       bool &) -> const Expr * {
+      auto condition = builder.typed(
+          new Conditional(
+              builder.builtin("__builtin_int_gt",
+                              {builder.local(step_id, Int), builder.integer(0)},
+                              Bool),
+              builder.builtin("__builtin_int_lte",
+                              {load_index(), builder.local(range_max_id, Int)},
+                              Bool),
+              builder.builtin("__builtin_int_gte",
+                              {load_index(), builder.local(range_max_id, Int)},
+                              Bool)),
+          Bool);
+      auto loop = new While(
+          condition,
+          builder.let(item_id, load_index(),
+                      translate_item(range_bound_vars,
+                                     builder.builtin(
+                                         "__builtin_add_int",
+                                         {builder.local(item_id, Int),
+                                          builder.local(step_id, Int)},
+                                         Int))));
+      return builder.let(index_id,
+                         builder.call(REF_TYPE_OPERATOR,
+                                      {builder.local(range_min_id, Int)},
+                                      RefInt),
+                         builder.typed(loop, while_type));
+    };
+    auto failed = [](const DataCtorsMap &, const std::unordered_set<Symbol> &,
+                     const TrackedTypes &, const types::TypeEnv &,
+                     TrackedTypes &, types::NeededDefns &,
+                     bool &) -> const Expr * {
+      assert(false);
+      return nullptr;
+    };
+    bool range_returns = false;
+    counted_loop = range_predicate->translate(
+        for_defn_id, iterable_id, iterable_type, false /*do_checks*/,
+        data_ctors_map, new_bound_vars, tracked_types, type_env, typing,
+        needed_defns, range_returns, matched, failed);
+  }
+
+  auto fused_loop = new Let(iterable_id, iterable, counted_loop);
+  typing[fused_loop] = type;
+  return fused_loop;
+}
+
+const Expr *translate_reserve_for(const types::DefnId &for_defn_id,
+                                  Location location,
+                                  const std::vector<const Expr *> &exprs,
+                                  TrackedTypes &typing,
+                                  types::NeededDefns &needed_defns) {
+  assert(exprs.size() == 2);
+  const types::Ref Unit = type_unit(location);
+  LoopBuilder builder{for_defn_id, location, typing, needed_defns};
+  bool counts_range = false;
+  if (get_counted_item_type(typing.at(exprs[1]), counts_range) == nullptr) {
+    /* the length of the source is not known up front, so the collection just
+     * grows as items are added */
+    auto unit = unit_expr(location);
+    typing[unit] = Unit;
+    return builder.typed(new Block({exprs[0], exprs[1], unit}), Unit);
+  }
+
+  time_trace_add_counter("reserved comprehensions", 1);
+  return builder.call(
+      tld::mktld("vector", "reserve"),
+      {exprs[0], builder.call(tld::mktld("std", "len"), {exprs[1]},
+                              type_int(location))},
+      Unit);
+}
+
+} // namespace zion
@@ -0,0 +1,45 @@
+#pragma once
+#include <unordered_set>
+#include <vector>
+
+#include "ast_decls.h"
+#include "data_ctors_map.h"
+#include "defn_id.h"
+#include "tracked_types.h"
+#include "types.h"
+
+namespace zion {
+
+/* once types are known, the for loops that the parser desugared, and the
+ * comprehensions that it builds out of them, are lowered here. both need to
+ * know which iterables can be counted through. */
+
+/* parse_for_block desugars `for x in xs` into a loop that calls the closure
+ * returned by iter(xs) and matches on the Maybe it returns. once a function is
+ * monomorphized we know when xs is a Vector, a String or a Range of Ints, and
+ * so we can count through it directly instead, without the closure or a Just
+ * per item. if let is such a loop, return its fused translation, otherwise
+ * return nullptr. */
+const ast::Expr *translate_for_loop(
+    const types::DefnId &for_defn_id,
+    const ast::Let *let,
+    const DataCtorsMap &data_ctors_map,
+    const std::unordered_set<Symbol> &bound_vars,
+    const TrackedTypes &tracked_types,
+    types::Ref type,
+    const types::TypeEnv &type_env,
+    TrackedTypes &typing,
+    types::NeededDefns &needed_defns,
+    bool &returns);
+
+/* comprehensions call __builtin_reserve_for(collection, iterable) before they
+ * fill a Vector. given its translated parameters, make the vector reserve room
+ * for every item when the iterable is one that we know the length of. */
+const ast::Expr *translate_reserve_for(
+    const types::DefnId &for_defn_id,
+    Location location,
+    const std::vector<const ast::Expr *> &exprs,
+    TrackedTypes &typing,
+    types::NeededDefns &needed_defns);
+
+} // namespace zion
@@ -4,6 +4,7 @@
 #include "builtins.h"
 #include "logger.h"
 #include "ptr.h"
+#include "time_trace.h"
 #include "typed_id.h"
 #include "types.h"
 #include "user_error.h"
@@ -754,6 +755,36 @@ llvm::Value *gen_builtin(llvm::IRBuilder<> &builder,
   return nullptr;
 }
 
+/* generate the body of lambda into llvm_function, whose entry block is the
+ * builder's insertion point. gen_env_locals holds the params and captures. */
+void gen_lambda_body(std::string name,
+                     llvm::IRBuilder<> &builder,
+                     llvm::Module *llvm_module,
+                     const ast::Lambda *lambda,
+                     llvm::Function *llvm_function,
+                     const TrackedTypes &typing,
+                     const types::TypeEnv &type_env,
+                     const GenEnv &gen_env_globals,
+                     const GenLocalEnv &gen_env_locals,
+                     const std::unordered_set<std::string> &globals) {
+  DeferGuard defer_guard(nullptr, dt_function);
+  debug_above(3, log("generating body for %s = %s", name.c_str(),
+                     lambda->body->str().c_str()));
+  /* now build the body of the function */
+  gen("", builder, llvm_module, &defer_guard, nullptr /*break_to_block*/,
+      nullptr /*continue_to_block*/, lambda->body, typing, type_env,
+      gen_env_globals, gen_env_locals, globals, nullptr /*publishable*/);
+
+  defer_guard.call_deferred(builder, dt_function);
+
+  if (builder.GetInsertBlock()->getTerminator() == nullptr) {
+    /* ensure that we have a terminator */
+    builder.CreateRet(
+        llvm::Constant::getNullValue(builder.getInt8Ty()->getPointerTo()));
+  }
+  llvm_verify_function(INTERNAL_LOC(), llvm_function);
+}
+
 void gen_lambda(std::string name,
                 llvm::IRBuilder<> &builder,
                 llvm::Module *llvm_module,
@@ -772,6 +803,7 @@ void gen_lambda(std::string name,
 
   INDENT(2, string_format("gen_lambda(%s, ..., %s, %s, ...)", name.c_str(),
                           lambda->str().c_str(), type->str().c_str()));
+  TimeTraceScope trace("gen", name);
 
   /* see if we need to lift any free variables into a closure */
   FreeVars free_vars;
@@ -785,8 +817,11 @@ void gen_lambda(std::string name,
   debug_above(4, log("created function type %s",
                      llvm_print(llvm_function_type).c_str()));
 
+  /* only main is called from outside of the program, so the optimizer is
+   * free to drop unused params, such as the env of a function that captures
+   * nothing, once all of its calls are direct */
   llvm::Function *llvm_function = llvm::Function::Create(
-      llvm_function_type, llvm::Function::ExternalLinkage, name,
+      llvm_function_type, llvm::Function::InternalLinkage, name,
       llvm_module != nullptr ? llvm_module : llvm_get_module(builder));
   llvm_function->setDoesNotThrow();
 
@@ -807,6 +842,8 @@ void gen_lambda(std::string name,
                      llvm_function->getName().str().c_str(), name.c_str(),
                      free_vars.str().c_str()));
 
+  std::vector<TypedId> captured_ids;
+  GenLocalEnv constant_env_locals;
   for (auto typed_id : free_vars.typed_ids) {
     /* add a copy of each captured variable. If get_env_var fails here, then
      * it means that get_free_vars is talking about a variable that just
@@ -819,6 +856,13 @@ void gen_lambda(std::string name,
                        "unable to find a definition for " c_id("%s"),
                        typed_id.id.name.c_str());
     }
+    if (llvm::isa<llvm::Constant>(value)) {
+      /* constants, such as the closures of known functions, can be used
+       * from any function, so they need not be captured */
+      set_env_var(constant_env_locals, typed_id.id.name, typed_id.type, value);
+      continue;
+    }
+    captured_ids.push_back(typed_id);
     llvm_dims.push_back(value);
     dim_types.push_back(typed_id.type);
   }
@@ -887,7 +931,7 @@ void gen_lambda(std::string name,
     builder.SetInsertPoint(block);
 
     /* put the param in scope */
-    GenLocalEnv new_env_locals;
+    GenLocalEnv new_env_locals = constant_env_locals;
     if (name != "") {
       /* inject the closure itself so that it can self refer */
       // set_env_var(new_env, name, type, opaque_closure);
@@ -901,21 +945,21 @@ void gen_lambda(std::string name,
     }
 
     if (closure != nullptr) {
-      assert(free_vars.typed_ids.size() != 0);
+      assert(captured_ids.size() != 0);
       llvm::Value *closure_env = builder.CreateBitCast(
           llvm_function->arg_end() - 1, closure->getType(), "closure_env");
       debug_above(5, log("closure_env in gen_lambda is %s",
                          llvm_print(closure_env).c_str()));
 
       int arg_index = 1;
-      for (auto typed_id : free_vars.typed_ids) {
+      for (auto typed_id : captured_ids) {
         // inject the closed over vars into the new environment within the
         // closure
         llvm::Value *gep_path[] = {builder.getInt32(0),
                                    builder.getInt32(arg_index)};
         llvm::Value *llvm_captured_value_in_lambda_scope = builder.CreateLoad(
             builder.CreateInBoundsGEP(closure_env, gep_path));
-        llvm_captured_value_in_lambda_scope->setName(typed_id.id.name);
+        llvm_captured_value_in_lambda_scope->setName(typed_id.id.name.str());
 
         debug_above(5,
                     log("adding closed over var %s to new_env as %s :: %s",
@@ -928,26 +972,184 @@ void gen_lambda(std::string name,
         ++arg_index;
       }
     } else {
-      assert(free_vars.typed_ids.size() == 0);
+      assert(captured_ids.size() == 0);
     }
 
-    DeferGuard defer_guard(nullptr, dt_function);
-    debug_above(3, log("generating body for %s = %s", name.c_str(),
-                       lambda->body->str().c_str()));
-    /* now build the body of the function */
-    gen("", builder, llvm_module, &defer_guard, nullptr /*break_to_block*/,
-        nullptr /*continue_to_block*/, lambda->body, typing, type_env,
-        gen_env_globals, new_env_locals, globals, nullptr /*publishable*/);
+    gen_lambda_body(name, builder, llvm_module, lambda, llvm_function, typing,
+                    type_env, gen_env_globals, new_env_locals, globals);
+  }
+}
 
-    defer_guard.call_deferred(builder, dt_function);
+/* whether every use of name within expr calls it. a lambda bound to such a
+ * name never has to exist as a closure. uses within other lambdas would have
+ * to capture it, so they do not count as calls. */
+bool is_only_called(const ast::Expr *expr,
+                    const std::string &name,
+                    bool in_lambda) {
+  auto only_called = [&](const ast::Expr *expr) {
+    return is_only_called(expr, name, in_lambda);
+  };
+  auto all_only_called = [&](const std::vector<const ast::Expr *> &exprs) {
+    for (auto expr : exprs) {
+      if (!only_called(expr)) {
+        return false;
+      }
+    }
+    return true;
+  };
 
-    if (builder.GetInsertBlock()->getTerminator() == nullptr) {
-      /* ensure that we have a terminator */
-      builder.CreateRet(
-          llvm::Constant::getNullValue(builder.getInt8Ty()->getPointerTo()));
+  if (dcast<const ast::Literal *>(expr) || dcast<const ast::Break *>(expr) ||
+      dcast<const ast::Continue *>(expr) || dcast<const ast::Sizeof *>(expr)) {
+    return true;
+  } else if (auto var = dcast<const ast::Var *>(expr)) {
+    return var->id.name != name;
+  } else if (auto lambda = dcast<const ast::Lambda *>(expr)) {
+    for (auto &var : lambda->vars) {
+      if (var.name == name) {
+        return true;
+      }
     }
-    llvm_verify_function(INTERNAL_LOC(), llvm_function);
+    return is_only_called(lambda->body, name, true /*in_lambda*/);
+  } else if (auto application = dcast<const ast::Application *>(expr)) {
+    auto var = dcast<const ast::Var *>(application->a);
+    if (var == nullptr || var->id.name != name) {
+      return only_called(application->a) &&
+             all_only_called(application->params);
+    }
+    return !in_lambda && all_only_called(application->params);
+  } else if (auto let = dcast<const ast::Let *>(expr)) {
+    return only_called(let->value) &&
+           (let->var.name == name || only_called(let->body));
+  } else if (auto condition = dcast<const ast::Conditional *>(expr)) {
+    return only_called(condition->cond) && only_called(condition->truthy) &&
+           only_called(condition->falsey);
+  } else if (auto while_ = dcast<const ast::While *>(expr)) {
+    return only_called(while_->condition) && only_called(while_->block);
+  } else if (auto block = dcast<const ast::Block *>(expr)) {
+    return all_only_called(block->statements);
+  } else if (auto return_ = dcast<const ast::ReturnStatement *>(expr)) {
+    return only_called(return_->value);
+  } else if (auto tuple = dcast<const ast::Tuple *>(expr)) {
+    return all_only_called(tuple->dims);
+  } else if (auto tuple_deref = dcast<const ast::TupleDeref *>(expr)) {
+    return only_called(tuple_deref->expr);
+  } else if (auto as = dcast<const ast::As *>(expr)) {
+    return only_called(as->expr);
+  } else if (auto ffi = dcast<const ast::FFI *>(expr)) {
+    return all_only_called(ffi->exprs);
+  } else if (auto builtin = dcast<const ast::Builtin *>(expr)) {
+    return all_only_called(builtin->exprs);
+  } else if (auto defer = dcast<const ast::Defer *>(expr)) {
+    /* deferred calls hold on to the closure until the function returns */
+    return only_called(defer->application->a) &&
+           all_only_called(defer->application->params);
   }
+  return false;
+}
+
+std::string get_lifted_capture_name(const std::string &name, int index) {
+  return string_format("%s capture %d", name.c_str(), index);
+}
+
+/* generate a lambda that is only ever called directly as a plain function.
+ * rather than being put into a closure, its captures become extra params,
+ * and it takes no env. the function is bound to name in gen_env_locals, along
+ * with the values that it captures, which callers pass after their args. */
+void gen_lifted_lambda(std::string name,
+                       llvm::IRBuilder<> &builder,
+                       llvm::Module *llvm_module,
+                       const ast::Lambda *lambda,
+                       types::Ref type,
+                       const TrackedTypes &typing,
+                       const types::TypeEnv &type_env,
+                       const GenEnv &gen_env_globals,
+                       GenLocalEnv &gen_env_locals,
+                       const std::unordered_set<std::string> &globals) {
+  INDENT(2, string_format("gen_lifted_lambda(%s, ..., %s, %s, ...)",
+                          name.c_str(), lambda->str().c_str(),
+                          type->str().c_str()));
+  TimeTraceScope trace("gen", name);
+  time_trace_add_counter("lifted lambdas", 1);
+
+  FreeVars free_vars;
+  get_free_vars(lambda, typing, globals, {}, free_vars);
+
+  types::Refs type_terms = unfold_arrows(type);
+  llvm::FunctionType *llvm_closure_function_type =
+      get_llvm_arrow_function_type(builder, type_env, type_terms);
+
+  /* the params, without the env, followed by the captures */
+  std::vector<llvm::Type *> llvm_param_types(
+      llvm_closure_function_type->param_begin(),
+      llvm_closure_function_type->param_end() - 1);
+  std::vector<TypedId> captured_ids;
+  std::vector<llvm::Value *> llvm_captures;
+  types::Refs capture_types;
+  GenLocalEnv new_env_locals;
+  for (auto typed_id : free_vars.typed_ids) {
+    auto value = get(gen_env_locals, typed_id.id.name,
+                     static_cast<llvm::Value *>(nullptr));
+    if (value == nullptr) {
+      throw user_error(lambda->get_location(),
+                       "unable to find a definition for " c_id("%s"),
+                       typed_id.id.name.c_str());
+    }
+    if (llvm::isa<llvm::Constant>(value)) {
+      set_env_var(new_env_locals, typed_id.id.name, typed_id.type, value);
+      continue;
+    }
+    captured_ids.push_back(typed_id);
+    llvm_param_types.push_back(value->getType());
+    llvm_captures.push_back(value);
+    capture_types.push_back(typed_id.type);
+  }
+
+  llvm::Function *llvm_function = llvm::Function::Create(
+      llvm::FunctionType::get(llvm_closure_function_type->getReturnType(),
+                              llvm_param_types, false /*isVarArg*/),
+      llvm::Function::InternalLinkage, name,
+      llvm_module != nullptr ? llvm_module : llvm_get_module(builder));
+  llvm_function->setDoesNotThrow();
+
+  {
+    llvm::IRBuilderBase::InsertPointGuard ipg(builder);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(builder.getContext(),
+                                                    "entry", llvm_function));
+
+    assert(type_terms.size() - 1 == lambda->vars.size());
+    auto args_iter = llvm_function->args().begin();
+    for (size_t i = 0; i < lambda->vars.size(); ++i) {
+      set_env_var(new_env_locals, lambda->vars[i].name, type_terms[i],
+                  &*args_iter++);
+    }
+    int capture_index = 0;
+    for (auto typed_id : captured_ids) {
+      args_iter->setName(typed_id.id.name.str());
+      set_env_var(new_env_locals, typed_id.id.name,
+                  capture_types[capture_index++], &*args_iter++);
+    }
+
+    gen_lambda_body(name, builder, llvm_module, lambda, llvm_function, typing,
+                    type_env, gen_env_globals, new_env_locals, globals);
+  }
+
+  set_env_var(gen_env_locals, name, type, llvm_function);
+  for (size_t i = 0; i < llvm_captures.size(); ++i) {
+    gen_env_locals[get_lifted_capture_name(name, i)] = llvm_captures[i];
+  }
+}
+
+/* call the lambda that gen_lifted_lambda bound to name */
+llvm::Value *gen_lifted_call(llvm::IRBuilder<> &builder,
+                             const std::string &name,
+                             llvm::Function *llvm_function,
+                             const GenLocalEnv &gen_env_locals,
+                             std::vector<llvm::Value *> args) {
+  const int capture_count = llvm_function->arg_size() - args.size();
+  for (int i = 0; i < capture_count; ++i) {
+    args.push_back(gen_env_locals.at(get_lifted_capture_name(name, i)));
+  }
+  return builder.CreateCall(llvm_function, args);
 }
 
 ResolutionStatus gen_literal(std::string name,
@@ -1105,10 +1307,32 @@ ResolutionStatus gen(std::string name,
                          typing.at(application->a)->str().c_str(),
                          join_str(application->params, ", ").c_str()));
 
-      llvm::Value *closure = gen(builder, llvm_module, defer_guard,
-                                 break_to_block, continue_to_block,
-                                 application->a, typing, type_env,
-                                 gen_env_globals, gen_env_locals, globals);
+      /* a lambda that is applied right where it is written, or a local that
+       * gen_lifted_lambda bound, is called as a plain function */
+      std::string lifted_name;
+      const GenLocalEnv *lifted_env_locals = &gen_env_locals;
+      GenLocalEnv lambda_env_locals;
+      if (auto lambda = dcast<const ast::Lambda *>(application->a)) {
+        lifted_name = string_format("__anonymous{%s}",
+                                    lambda->get_location().repr().c_str());
+        lambda_env_locals = gen_env_locals;
+        gen_lifted_lambda(lifted_name, builder, llvm_module, lambda,
+                          typing.at(lambda), typing, type_env, gen_env_globals,
+                          lambda_env_locals, globals);
+        lifted_env_locals = &lambda_env_locals;
+      } else if (auto var = dcast<const ast::Var *>(application->a)) {
+        lifted_name = var->id.name;
+      }
+      auto lifted_function = llvm::dyn_cast_or_null<llvm::Function>(
+          get(*lifted_env_locals, lifted_name,
+              static_cast<llvm::Value *>(nullptr)));
+
+      llvm::Value *closure = nullptr;
+      if (lifted_function == nullptr) {
+        closure = gen(builder, llvm_module, defer_guard, break_to_block,
+                      continue_to_block, application->a, typing, type_env,
+                      gen_env_globals, gen_env_locals, globals);
+      }
 
       std::vector<llvm::Value *> args;
       for (auto &param : application->params) {
@@ -1117,10 +1341,28 @@ ResolutionStatus gen(std::string name,
                            gen_env_globals, gen_env_locals, globals));
       }
 
-      publish(llvm_create_closure_callsite(application->get_location(), builder,
-                                           closure, args));
+      if (lifted_function != nullptr) {
+        publish(gen_lifted_call(builder, lifted_name, lifted_function,
+                                *lifted_env_locals, args));
+      } else {
+        publish(llvm_create_closure_callsite(application->get_location(),
+                                             builder, closure, args));
+      }
       return rs_cache_resolution;
     } else if (auto let = dcast<const ast::Let *>(expr)) {
+      auto lambda = dcast<const ast::Lambda *>(let->value);
+      if (lambda != nullptr &&
+          is_only_called(let->body, let->var.name, false /*in_lambda*/)) {
+        auto new_env_locals = gen_env_locals;
+        gen_lifted_lambda(let->var.name, builder, llvm_module, lambda,
+                          typing.at(lambda), typing, type_env, gen_env_globals,
+                          new_env_locals, globals);
+        publish(gen(builder, llvm_module, defer_guard, break_to_block,
+                    continue_to_block, let->body, typing, type_env,
+                    gen_env_globals, new_env_locals, globals));
+        return rs_cache_resolution;
+      }
+
       llvm::Value *let_value = nullptr;
       Publishable publishable(name, &let_value);
       gen(let->var.name, builder, llvm_module, defer_guard, break_to_block,
@@ -8,9 +8,9 @@
 namespace zion {
 namespace graph {
 void dfs(FILE *fp,
-         std::string node,
+         Symbol node,
          const tarjan::Graph &graph,
-         std::unordered_set<std::string> &visited,
+         std::unordered_set<Symbol> &visited,
          const std::map<std::string, int> &ranks,
          std::set<int> &ranks_seen) {
   if (visited.count(node)) {
@@ -57,7 +57,7 @@ void emit_graphviz_dot(const tarjan::Graph &graph,
   std::set<int> ranks_seen;
 
   rank_sccs(sccs, ranks, rank_nodes);
-  std::unordered_set<std::string> visited;
+  std::unordered_set<Symbol> visited;
   dfs(fp, entry_point, graph, visited, ranks, ranks_seen);
 
   for (auto rank : ranks_seen) {
@@ -6,14 +6,14 @@
 #include "user_error.h"
 #include "zion.h"
 
-Identifier::Identifier(const std::string &name, Location location)
+Identifier::Identifier(Symbol name, Location location)
     : name(name), location(location) {
 #ifdef ZION_DEBUG
   assert(name.size() != 0);
-  for (auto ch : name) {
+  for (auto ch : name.str()) {
     assert(!iscntrl(ch));
   }
-  assert(name.find("0x7") == std::string::npos);
+  assert(name.str().find("0x7") == std::string::npos);
 #endif
 }
 
@@ -58,7 +58,7 @@ std::ostream &operator<<(std::ostream &os, const Identifier &rhs) {
   return os << rhs.str();
 }
 
-bool in(std::string needle, const Identifiers &haystack) {
+bool in(Symbol needle, const Identifiers &haystack) {
   for (auto &id : haystack) {
     if (needle == id.name) {
       return true;
@@ -5,15 +5,16 @@
 
 #include "colors.h"
 #include "location.h"
+#include "symbol.h"
 #include "token.h"
 #include "utils.h"
 
 struct Identifier {
   Identifier() = default;
   Identifier(const Identifier &) = default;
-  explicit Identifier(const std::string &name, Location location);
+  explicit Identifier(Symbol name, Location location);
 
-  std::string name;
+  Symbol name;
   Location location;
 
   static Identifier from_token(zion::Token token);
@@ -36,9 +37,9 @@ std::string str(Identifiers ids);
 
 namespace std {
 template <> struct hash<Identifier> {
-  int operator()(const Identifier &s) const {
+  std::size_t operator()(const Identifier &s) const {
     /* location is not a disambiguator for identifiers */
-    return std::hash<std::string>()(s.name);
+    return s.name.hash();
   }
 };
 } // namespace std
@@ -48,4 +49,4 @@ std::set<std::string> to_atom_set(const Identifiers &refs);
 
 std::ostream &operator<<(std::ostream &os, const Identifier &rhs);
 
-bool in(std::string needle, const Identifiers &haystack);
+bool in(Symbol needle, const Identifiers &haystack);
@@ -0,0 +1,276 @@
+#include "instance_index.h"
+
+#include "dbg.h"
+#include "logger.h"
+#include "ptr.h"
+#include "unification.h"
+#include "utils.h"
+
+namespace types {
+
+namespace {
+
+/* the heads of each of params */
+std::vector<std::string> get_head_names(const Refs &params) {
+  std::vector<std::string> heads;
+  for (auto &param : params) {
+    heads.push_back(get_head_name(param));
+  }
+  return heads;
+}
+
+/* rename the type variables that bindings took from an instance, so that
+ * every resolution hands out type variables that nothing else has seen. the
+ * variables of the predicate that was resolved keep their names. */
+Map freshen(const Map &bindings, const Ftvs &predicate_ftvs) {
+  std::map<std::string, std::string> remapping;
+  for (auto &pair : bindings) {
+    for (auto &ftv : pair.second->get_ftvs()) {
+      if (!in(ftv, predicate_ftvs) && !in(ftv, remapping)) {
+        remapping[ftv] = gensym_name();
+      }
+    }
+  }
+  if (remapping.empty()) {
+    return bindings;
+  }
+
+  Map fresh_bindings;
+  for (auto &pair : bindings) {
+    fresh_bindings[pair.first] = pair.second->remap_vars(remapping);
+  }
+  return fresh_bindings;
+}
+
+/* append the type variables in type that are not yet in ftvs, in the order
+ * that they appear */
+void collect_ftvs_in_order(const Ref &type, std::vector<std::string> &ftvs) {
+  if (auto type_variable = dyncast<const TypeVariable>(type)) {
+    if (!in_vector(type_variable->id.name, ftvs)) {
+      ftvs.push_back(type_variable->id.name);
+    }
+  } else if (auto type_operator = dyncast<const TypeOperator>(type)) {
+    collect_ftvs_in_order(type_operator->oper, ftvs);
+    collect_ftvs_in_order(type_operator->operand, ftvs);
+  } else if (auto type_tuple = dyncast<const TypeTuple>(type)) {
+    for (auto &dimension : type_tuple->dimensions) {
+      collect_ftvs_in_order(dimension, ftvs);
+    }
+  } else if (auto type_params = dyncast<const TypeParams>(type)) {
+    for (auto &dimension : type_params->dimensions) {
+      collect_ftvs_in_order(dimension, ftvs);
+    }
+  } else if (auto type_lambda = dyncast<const TypeLambda>(type)) {
+    std::vector<std::string> body_ftvs;
+    collect_ftvs_in_order(type_lambda->body, body_ftvs);
+    for (auto &ftv : body_ftvs) {
+      if (ftv != type_lambda->binding.name && !in_vector(ftv, ftvs)) {
+        ftvs.push_back(ftv);
+      }
+    }
+  }
+}
+
+/* give the bindings of a canonical predicate back the names of the type
+ * variables of the predicate that it was made from */
+Map from_canonical(const Map &bindings,
+                   const std::map<std::string, std::string> &remapping) {
+  if (remapping.empty()) {
+    return bindings;
+  }
+  Map renamed_bindings;
+  for (auto &pair : bindings) {
+    auto iter = remapping.find(pair.first);
+    renamed_bindings[iter != remapping.end() ? iter->second : pair.first] =
+        pair.second->remap_vars(remapping);
+  }
+  return renamed_bindings;
+}
+
+} // namespace
+
+std::string get_head_name(const Ref &type) {
+  Ref head = type;
+  while (auto type_operator = dyncast<const TypeOperator>(head)) {
+    head = type_operator->oper;
+  }
+  if (auto type_id = dyncast<const TypeId>(head)) {
+    return type_id->id.name;
+  } else if (auto type_tuple = dyncast<const TypeTuple>(head)) {
+    return string_format("(%d)", (int)type_tuple->dimensions.size());
+  } else if (auto type_params = dyncast<const TypeParams>(head)) {
+    return string_format("[%d]", (int)type_params->dimensions.size());
+  }
+  return "";
+}
+
+bool could_unify(const Ref &a, const Ref &b) {
+  if (a == b || dyncast<const TypeVariable>(a) != nullptr ||
+      dyncast<const TypeVariable>(b) != nullptr) {
+    return true;
+  }
+  if (auto id_a = dyncast<const TypeId>(a)) {
+    auto id_b = dyncast<const TypeId>(b);
+    return id_b != nullptr && id_a->id.name == id_b->id.name;
+  } else if (auto operator_a = dyncast<const TypeOperator>(a)) {
+    auto operator_b = dyncast<const TypeOperator>(b);
+    return operator_b != nullptr &&
+           could_unify(operator_a->oper, operator_b->oper) &&
+           could_unify(operator_a->operand, operator_b->operand);
+  }
+
+  const Refs *dimensions_a = nullptr;
+  const Refs *dimensions_b = nullptr;
+  if (auto tuple_a = dyncast<const TypeTuple>(a)) {
+    auto tuple_b = dyncast<const TypeTuple>(b);
+    if (tuple_b == nullptr) {
+      return false;
+    }
+    dimensions_a = &tuple_a->dimensions;
+    dimensions_b = &tuple_b->dimensions;
+  } else if (auto params_a = dyncast<const TypeParams>(a)) {
+    auto params_b = dyncast<const TypeParams>(b);
+    if (params_b == nullptr) {
+      return false;
+    }
+    dimensions_a = &params_a->dimensions;
+    dimensions_b = &params_b->dimensions;
+  } else {
+    /* type lambdas are left to unify */
+    return true;
+  }
+  if (dimensions_a->size() != dimensions_b->size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < dimensions_a->size(); ++i) {
+    if (!could_unify((*dimensions_a)[i], (*dimensions_b)[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+InstanceIndex::InstanceIndex(const ClassPredicates &instance_predicates)
+    : instance_predicates(instance_predicates) {
+  for (auto &instance : instance_predicates) {
+    auto heads = get_head_names(instance->params);
+    const std::string first_head = heads.empty() ? "" : heads[0];
+    index[instance->classname.name][first_head].push_back(
+        Candidate{instance, heads});
+  }
+}
+
+std::vector<ClassPredicateRef> InstanceIndex::get_candidates(
+    const ClassPredicate &predicate) const {
+  std::vector<ClassPredicateRef> candidates;
+  auto by_head = index.find(predicate.classname.name);
+  if (by_head == index.end()) {
+    return candidates;
+  }
+
+  auto heads = get_head_names(predicate.params);
+  auto add_candidates = [&](const std::vector<Candidate> &bucket) {
+    for (auto &candidate : bucket) {
+      if (candidate.heads.size() != heads.size()) {
+        continue;
+      }
+      bool plausible = true;
+      for (std::size_t i = 1; i < heads.size() && plausible; ++i) {
+        plausible = heads[i].empty() || candidate.heads[i].empty() ||
+                    heads[i] == candidate.heads[i];
+      }
+      if (plausible) {
+        candidates.push_back(candidate.instance);
+      }
+    }
+  };
+
+  if (heads.empty() || heads[0].empty()) {
+    for (auto &pair : by_head->second) {
+      add_candidates(pair.second);
+    }
+  } else {
+    auto bucket = by_head->second.find(heads[0]);
+    if (bucket != by_head->second.end()) {
+      add_candidates(bucket->second);
+    }
+    /* instances whose first parameter is a type variable match any head */
+    bucket = by_head->second.find("");
+    if (bucket != by_head->second.end()) {
+      add_candidates(bucket->second);
+    }
+  }
+  return candidates;
+}
+
+bool InstanceIndex::resolve(const ClassPredicate &predicate_,
+                            Map &bindings) const {
+  /* resolutions are remembered for the predicate with its type variables
+   * renamed in the order that they appear, so that predicates that only
+   * differ by the names of their type variables share one */
+  std::vector<std::string> ftvs;
+  for (auto &param : predicate_.params) {
+    collect_ftvs_in_order(param, ftvs);
+  }
+  std::map<std::string, std::string> to_canonical;
+  std::map<std::string, std::string> remapping;
+  for (std::size_t i = 0; i < ftvs.size(); ++i) {
+    const std::string canonical_name = string_format("__canonical_%d",
+                                                     (int)i);
+    to_canonical[ftvs[i]] = canonical_name;
+    remapping[canonical_name] = ftvs[i];
+  }
+  ClassPredicateRef canonical_predicate = predicate_.remap_vars(to_canonical);
+  const ClassPredicate &predicate = *canonical_predicate;
+
+  const std::string key = predicate.repr();
+  {
+    std::lock_guard<std::mutex> lock(resolutions_mutex);
+    auto resolution = resolutions.find(key);
+    if (resolution != resolutions.end()) {
+      if (resolution->second.unique) {
+        bindings = freshen(from_canonical(resolution->second.bindings,
+                                          remapping),
+                           predicate_.get_ftvs());
+      }
+      return resolution->second.unique;
+    }
+  }
+
+  Resolution resolution{false, {}};
+  int found_instances = 0;
+  for (auto &instance_ : get_candidates(predicate)) {
+    /* let's freshen the instance predicate */
+    std::map<std::string, std::string> new_ftvs;
+    for (auto &ftv : instance_->get_ftvs()) {
+      new_ftvs[ftv] = gensym_name();
+    }
+    auto instance = instance_->remap_vars(new_ftvs);
+
+    /* unify the instance parameters in an attempt to resolve any functional
+     * dependencies between the associated types. */
+    debug_above(3, log("Attempting to unify %s with %s",
+                       instance->str().c_str(), predicate.str().c_str()));
+    Unification unification = unify_many(instance->params, predicate.params);
+    if (unification.result) {
+      debug_above(3, log("%s unified with %s with bindings %s",
+                         instance->str().c_str(), predicate.str().c_str(),
+                         ::str(unification.bindings).c_str()));
+      ++found_instances;
+      std::swap(resolution.bindings, unification.bindings);
+    }
+  }
+  resolution.unique = found_instances == 1;
+  if (!resolution.unique) {
+    resolution.bindings.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(resolutions_mutex);
+  if (resolution.unique) {
+    bindings = from_canonical(resolution.bindings, remapping);
+  }
+  resolutions.emplace(key, std::move(resolution));
+  return found_instances == 1;
+}
+
+} // namespace types
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "class_predicate.h"
+#include "types.h"
+
+namespace types {
+
+/* the name of the type constructor at the head of type, or an empty string
+ * when type could be anything at all (a type variable, or an application of
+ * one). two types can only unify when one of them has no head or both have the
+ * same head. */
+std::string get_head_name(const Ref &type);
+
+/* a quick check that returns false only when a and b certainly do not unify.
+ * it does not allocate, so it is cheap enough to run ahead of unify against
+ * every overload of a name. */
+bool could_unify(const Ref &a, const Ref &b);
+
+/* every type class instance in the program, indexed by class name and then by
+ * the head type constructor of the instance's first parameter, so that finding
+ * the instances that satisfy a predicate only unifies against plausible
+ * candidates. */
+class InstanceIndex {
+public:
+  explicit InstanceIndex(const ClassPredicates &instance_predicates);
+  InstanceIndex(const InstanceIndex &) = delete;
+
+  const ClassPredicates &get_instance_predicates() const {
+    return instance_predicates;
+  }
+
+  /* the instances of predicate's type class whose parameters have heads that
+   * do not rule out unifying with predicate's */
+  std::vector<ClassPredicateRef> get_candidates(
+      const ClassPredicate &predicate) const;
+
+  /* if exactly one instance unifies with predicate, return true and set
+   * bindings to the unifier. results are remembered by predicate, up to the
+   * names of its type variables, so this is only worth calling once type
+   * checking has finished. safe to call from several threads at once. */
+  bool resolve(const ClassPredicate &predicate, Map &bindings) const;
+
+private:
+  struct Candidate {
+    ClassPredicateRef instance;
+    std::vector<std::string> heads;
+  };
+  struct Resolution {
+    bool unique;
+    Map bindings;
+  };
+
+  const ClassPredicates instance_predicates;
+  /* class name -> first parameter's head -> instances */
+  std::unordered_map<std::string,
+                     std::map<std::string, std::vector<Candidate>>>
+      index;
+
+  mutable std::mutex resolutions_mutex;
+  mutable std::unordered_map<std::string, Resolution> resolutions;
+};
+
+} // namespace types
@@ -0,0 +1,447 @@
+#include "interface_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+
+#include "dbg.h"
+#include "disk.h"
+#include "ptr.h"
+#include "types.h"
+#include "utils.h"
+
+namespace zion {
+
+namespace {
+
+/* bump this whenever the format of a .zi file changes */
+const char *interface_format = "zion-interface-1";
+
+/* the most interfaces that a server keeps in memory. keys change along with
+ * the sources, so the least recently used are forgotten first. */
+const std::size_t max_remembered_interfaces = 1024;
+
+struct RememberedInterface {
+  /* name -> serialized scheme */
+  std::map<std::string, std::string> schemes;
+  std::uint64_t last_used = 0;
+};
+
+/* interfaces that a server's compilations checked, by interface key */
+std::map<std::string, RememberedInterface> remembered_interfaces;
+std::uint64_t remembered_clock = 0;
+
+/* where save() reports the interfaces it checked, or -1 */
+int interface_sink = -1;
+
+/* types are written in prefix form, one whitespace-separated token per node
+ * or name. */
+void write_type(std::ostream &os, const types::Ref &type) {
+  if (auto type_variable = dyncast<const types::TypeVariable>(type)) {
+    os << " v " << type_variable->id.name;
+  } else if (auto type_id = dyncast<const types::TypeId>(type)) {
+    os << " i " << type_id->id.name;
+  } else if (auto type_operator = dyncast<const types::TypeOperator>(type)) {
+    os << " o";
+    write_type(os, type_operator->oper);
+    write_type(os, type_operator->operand);
+  } else if (auto type_tuple = dyncast<const types::TypeTuple>(type)) {
+    os << " t " << type_tuple->dimensions.size();
+    for (auto &dimension : type_tuple->dimensions) {
+      write_type(os, dimension);
+    }
+  } else if (auto type_params = dyncast<const types::TypeParams>(type)) {
+    os << " p " << type_params->dimensions.size();
+    for (auto &dimension : type_params->dimensions) {
+      write_type(os, dimension);
+    }
+  } else if (auto type_lambda = dyncast<const types::TypeLambda>(type)) {
+    os << " l " << type_lambda->binding.name;
+    write_type(os, type_lambda->body);
+  } else {
+    assert(false);
+  }
+}
+
+std::string write_scheme(const types::SchemeRef &scheme) {
+  std::stringstream ss;
+  ss << scheme->vars.size();
+  for (auto &var : scheme->vars) {
+    ss << " " << var;
+  }
+  ss << " " << scheme->predicates.size();
+  for (auto &predicate : scheme->predicates) {
+    ss << " " << predicate->classname.name << " " << predicate->params.size();
+    for (auto &param : predicate->params) {
+      write_type(ss, param);
+    }
+  }
+  write_type(ss, scheme->type);
+  return ss.str();
+}
+
+/* the types read back from an interface are all attributed to the location of
+ * the decl that is being looked up. returns nullptr on malformed input. */
+types::Ref read_type(std::istream &is, Location location) {
+  std::string kind;
+  if (!(is >> kind)) {
+    return nullptr;
+  }
+
+  if (kind == "v" || kind == "i" || kind == "l") {
+    std::string name;
+    if (!(is >> name)) {
+      return nullptr;
+    }
+    Identifier id{name, location};
+    if (kind == "v") {
+      return type_variable(id);
+    } else if (kind == "i") {
+      return type_id(id);
+    }
+    auto body = read_type(is, location);
+    return body != nullptr ? type_lambda(id, body) : nullptr;
+  } else if (kind == "o") {
+    auto oper = read_type(is, location);
+    auto operand = oper != nullptr ? read_type(is, location) : nullptr;
+    return operand != nullptr ? type_operator(oper, operand) : nullptr;
+  } else if (kind == "t" || kind == "p") {
+    std::size_t count;
+    if (!(is >> count)) {
+      return nullptr;
+    }
+    types::Refs dimensions;
+    for (std::size_t i = 0; i < count; ++i) {
+      auto dimension = read_type(is, location);
+      if (dimension == nullptr) {
+        return nullptr;
+      }
+      dimensions.push_back(dimension);
+    }
+    if (kind == "t") {
+      return type_tuple(location, dimensions);
+    }
+    return std::make_shared<types::TypeParams>(location, dimensions);
+  }
+  return nullptr;
+}
+
+types::SchemeRef read_scheme(const std::string &text, Location location) {
+  std::istringstream is(text);
+  std::size_t var_count;
+  if (!(is >> var_count)) {
+    return nullptr;
+  }
+  std::vector<std::string> vars(var_count);
+  for (auto &var : vars) {
+    if (!(is >> var)) {
+      return nullptr;
+    }
+  }
+
+  std::size_t predicate_count;
+  if (!(is >> predicate_count)) {
+    return nullptr;
+  }
+  types::ClassPredicates predicates;
+  for (std::size_t i = 0; i < predicate_count; ++i) {
+    std::string classname;
+    std::size_t param_count;
+    if (!(is >> classname >> param_count)) {
+      return nullptr;
+    }
+    types::Refs params;
+    for (std::size_t j = 0; j < param_count; ++j) {
+      auto param = read_type(is, location);
+      if (param == nullptr) {
+        return nullptr;
+      }
+      params.push_back(param);
+    }
+    predicates.insert(std::make_shared<types::ClassPredicate>(
+        Identifier{classname, location}, params));
+  }
+
+  auto type = read_type(is, location);
+  if (type == nullptr) {
+    return nullptr;
+  }
+  return scheme(vars, predicates, type);
+}
+
+/* one line per scheme, as name<TAB>scheme */
+void write_schemes(
+    std::ostream &os,
+    const std::map<std::string, std::map<std::string, std::string>> &checked,
+    const std::string &filename) {
+  auto schemes = checked.find(filename);
+  if (schemes != checked.end()) {
+    for (auto &scheme : schemes->second) {
+      os << scheme.first << "\t" << scheme.second << "\n";
+    }
+  }
+}
+
+/* write all of text to fd. a failed write only costs a later compilation the
+ * time it takes to check these modules again. */
+void write_all(int fd, const std::string &text) {
+  std::size_t written = 0;
+  while (written < text.size()) {
+    auto count = ::write(fd, text.data() + written, text.size() - written);
+    if (count < 0 && errno != EINTR) {
+      return;
+    }
+    written += std::max(count, ssize_t(0));
+  }
+}
+
+void collect_imports(
+    const std::string &filename,
+    const std::map<std::string, std::set<std::string>> &imports,
+    std::set<std::string> &visited) {
+  if (!visited.insert(filename).second) {
+    return;
+  }
+  auto iter = imports.find(filename);
+  if (iter != imports.end()) {
+    for (auto &import : iter->second) {
+      collect_imports(import, imports, visited);
+    }
+  }
+}
+
+/* the file that the running compiler was loaded from, or "" */
+std::string get_executable_path() {
+#ifdef __APPLE__
+  uint32_t size = 0;
+  _NSGetExecutablePath(nullptr, &size);
+  std::string path(size, '\0');
+  if (_NSGetExecutablePath(&path[0], &size) != 0) {
+    return "";
+  }
+  path.resize(strlen(path.c_str()));
+  return path;
+#else
+  return "/proc/self/exe";
+#endif
+}
+
+} // namespace
+
+std::string get_compiler_stamp() {
+  static const std::string compiler_stamp = []() -> std::string {
+    struct stat st;
+    const std::string executable = get_executable_path();
+    if (!executable.empty() && stat(executable.c_str(), &st) == 0) {
+      return string_format("%s:%lld:%lld", executable.c_str(),
+                           (long long)st.st_size, (long long)st.st_mtime);
+    }
+    /* a compiler that cannot find itself cannot tell whether it has been
+     * rebuilt, so it does not reuse anything that it did not make itself */
+    return string_format("pid:%d:%lld", (int)getpid(),
+                         (long long)time(nullptr));
+  }();
+  return compiler_stamp;
+}
+
+std::uint64_t interface_hash(std::string_view bytes, std::uint64_t seed) {
+  /* FNV-1a */
+  std::uint64_t hash = seed;
+  for (unsigned char byte : bytes) {
+    hash ^= byte;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::map<std::string, std::string> get_interface_keys(
+    const std::map<std::string, std::uint64_t> &source_hashes,
+    const std::map<std::string, std::set<std::string>> &imports) {
+  const std::uint64_t compiler_hash = interface_hash(
+      get_compiler_stamp(), interface_hash(interface_format));
+
+  std::map<std::string, std::string> interface_keys;
+  for (auto &pair : source_hashes) {
+    /* name the module itself first, so that modules which import each other
+     * do not end up sharing a key */
+    std::uint64_t hash = interface_hash(pair.first, compiler_hash);
+
+    std::set<std::string> closure;
+    collect_imports(pair.first, imports, closure);
+    for (auto &filename : closure) {
+      auto source_hash = source_hashes.find(filename);
+      if (source_hash == source_hashes.end()) {
+        continue;
+      }
+      hash = interface_hash(filename, hash);
+      hash = interface_hash(
+          std::string_view{reinterpret_cast<const char *>(&source_hash->second),
+                           sizeof(source_hash->second)},
+          hash);
+    }
+    interface_keys[pair.first] = string_format("%016llx",
+                                               (unsigned long long)hash);
+  }
+  return interface_keys;
+}
+
+InterfaceCache::InterfaceCache(
+    const std::map<std::string, std::string> &interface_keys)
+    : interface_keys(interface_keys) {
+  /* a server may have checked some of these modules already */
+  for (auto &pair : interface_keys) {
+    auto remembered = remembered_interfaces.find(pair.second);
+    if (remembered != remembered_interfaces.end()) {
+      loaded[pair.first] = remembered->second.schemes;
+      debug_above(2, log("found interface of %s in memory",
+                         pair.first.c_str()));
+    }
+  }
+
+  const char *zion_cache = getenv("ZION_CACHE");
+  if (zion_cache == nullptr || zion_cache[0] == '\0') {
+    return;
+  }
+  cache_dir = zion_cache;
+
+  for (auto &pair : interface_keys) {
+    if (in(pair.first, loaded)) {
+      continue;
+    }
+    std::ifstream ifs(cache_dir + "/" + pair.second + ".zi");
+    if (!ifs.good()) {
+      continue;
+    }
+
+    std::string line;
+    if (!std::getline(ifs, line) || line != interface_format) {
+      continue;
+    }
+    auto &schemes = loaded[pair.first];
+    while (std::getline(ifs, line)) {
+      auto tab = line.find('\t');
+      if (tab != std::string::npos) {
+        schemes[line.substr(0, tab)] = line.substr(tab + 1);
+      }
+    }
+    debug_above(2, log("loaded interface of %s from %s.zi",
+                       pair.first.c_str(), pair.second.c_str()));
+  }
+}
+
+types::SchemeRef InterfaceCache::lookup(Location location,
+                                        const std::string &name) const {
+  auto module = loaded.find(location.filename());
+  if (module == loaded.end()) {
+    return nullptr;
+  }
+  auto iter = module->second.find(name);
+  if (iter == module->second.end()) {
+    return nullptr;
+  }
+  return read_scheme(iter->second, location);
+}
+
+void InterfaceCache::insert(Location location,
+                            const std::string &name,
+                            const types::SchemeRef &scheme) {
+  if ((cache_dir.empty() && interface_sink == -1) ||
+      in(location.filename(), loaded) ||
+      !in(location.filename(), interface_keys)) {
+    return;
+  }
+  checked[location.filename()][name] = write_scheme(scheme);
+}
+
+void InterfaceCache::save() const {
+  if (interface_sink != -1) {
+    std::stringstream ss;
+    for (auto &pair : interface_keys) {
+      if (!in(pair.first, loaded)) {
+        ss << "@" << pair.second << "\n";
+        write_schemes(ss, checked, pair.first);
+      } else {
+        /* only mark it as used */
+        ss << "=" << pair.second << "\n";
+      }
+    }
+    write_all(interface_sink, ss.str());
+  }
+
+  if (cache_dir.empty() || !ensure_directory_exists(cache_dir)) {
+    return;
+  }
+
+  for (auto &pair : interface_keys) {
+    if (in(pair.first, loaded)) {
+      continue;
+    }
+
+    /* write to a private file and then rename it into place, so that a
+     * concurrent compilation never reads a partial interface */
+    std::string filename = cache_dir + "/" + pair.second + ".zi";
+    std::string temp_filename = string_format("%s.%d", filename.c_str(),
+                                              (int)getpid());
+    {
+      std::ofstream ofs(temp_filename);
+      ofs << interface_format << "\n";
+      write_schemes(ofs, checked, pair.first);
+      if (!ofs.good()) {
+        std::remove(temp_filename.c_str());
+        continue;
+      }
+    }
+    if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+      std::remove(temp_filename.c_str());
+    }
+  }
+}
+
+void set_interface_sink(int fd) {
+  interface_sink = fd;
+}
+
+void remember_interfaces(std::istream &is) {
+  std::map<std::string, std::string> *schemes = nullptr;
+  std::string line;
+  while (std::getline(is, line)) {
+    if (starts_with(line, "@")) {
+      auto &remembered = remembered_interfaces[line.substr(1)];
+      remembered.last_used = ++remembered_clock;
+      schemes = &remembered.schemes;
+    } else if (starts_with(line, "=")) {
+      auto iter = remembered_interfaces.find(line.substr(1));
+      if (iter != remembered_interfaces.end()) {
+        iter->second.last_used = ++remembered_clock;
+      }
+      schemes = nullptr;
+    } else if (schemes != nullptr) {
+      auto tab = line.find('\t');
+      if (tab != std::string::npos) {
+        (*schemes)[line.substr(0, tab)] = line.substr(tab + 1);
+      }
+    }
+  }
+
+  while (remembered_interfaces.size() > max_remembered_interfaces) {
+    auto least_recent = std::min_element(
+        remembered_interfaces.begin(), remembered_interfaces.end(),
+        [](const auto &a, const auto &b) {
+          return a.second.last_used < b.second.last_used;
+        });
+    debug_above(1, log("forgetting interface %s", least_recent->first.c_str()));
+    remembered_interfaces.erase(least_recent);
+  }
+}
+
+} // namespace zion
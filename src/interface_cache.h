@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include "location.h"
+#include "scheme.h"
+
+namespace zion {
+
+/* a stable 64-bit hash of some bytes, suitable for naming files on disk */
+std::uint64_t interface_hash(std::string_view bytes,
+                             std::uint64_t seed = 14695981039346656037ull);
+
+/* identifies the running compiler. anything cached is only valid for the
+ * compiler that produced it. */
+std::string get_compiler_stamp();
+
+/* compute the cache key of every module from the hash of its own source and
+ * the sources of everything it transitively imports. both maps are keyed by
+ * module filename. */
+std::map<std::string, std::string> get_interface_keys(
+    const std::map<std::string, std::uint64_t> &source_hashes,
+    const std::map<std::string, std::set<std::string>> &imports);
+
+/* the schemes that type checking resolved for each module, persisted under
+ * $ZION_CACHE as <key>.zi so that later compilations can skip inference for
+ * modules whose sources (and imports' sources) have not changed. interfaces
+ * handed to remember_interfaces are found without looking on disk. when
+ * ZION_CACHE is not set and there is no interface sink, save() does nothing. */
+class InterfaceCache {
+public:
+  /* interface_keys maps module filenames to their cache keys */
+  explicit InterfaceCache(
+      const std::map<std::string, std::string> &interface_keys);
+  InterfaceCache(const InterfaceCache &) = delete;
+
+  /* the scheme recorded for name by the module at location's filename, or
+   * nullptr if that module's interface was not found on disk. safe to call
+   * from several threads at once. */
+  types::SchemeRef lookup(Location location, const std::string &name) const;
+
+  /* remember the scheme that checking name resolved to in the module at
+   * location's filename. insertions into modules that were loaded from disk
+   * are ignored. */
+  void insert(Location location,
+              const std::string &name,
+              const types::SchemeRef &scheme);
+
+  /* write out the interface of every module that was not loaded from disk */
+  void save() const;
+
+private:
+  std::string cache_dir;
+  std::map<std::string, std::string> interface_keys;
+  /* filename -> name -> serialized scheme */
+  std::map<std::string, std::map<std::string, std::string>> loaded;
+  std::map<std::string, std::map<std::string, std::string>> checked;
+};
+
+/* while fd is not -1, InterfaceCache::save also writes the interfaces it
+ * checked, and the keys of those it reused, to fd, in the form that
+ * remember_interfaces reads */
+void set_interface_sink(int fd);
+
+/* make the interfaces that were written to an interface sink available to
+ * every InterfaceCache that this process creates from now on. only the most
+ * recently used are kept. */
+void remember_interfaces(std::istream &is);
+
+} // namespace zion
@@ -0,0 +1,179 @@
+#include "jit.h"
+
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+
+#include <set>
+
+#include "dbg.h"
+#include "disk.h"
+#include "emit.h"
+#include "logger.h"
+#include "user_error.h"
+#include "utils.h"
+
+namespace zion {
+
+namespace {
+
+void check_llvm_error(llvm::Error error, const char *what) {
+  if (error) {
+    throw user_error(INTERNAL_LOC(), "%s: %s", what,
+                     llvm::toString(std::move(error)).c_str());
+  }
+}
+
+template <typename T> T check_llvm_error(llvm::Expected<T> expected,
+                                         const char *what) {
+  check_llvm_error(expected.takeError(), what);
+  return std::move(*expected);
+}
+
+/* load the shared libraries that the linker would have been asked for, so
+ * that their symbols can be found in this process */
+void load_libraries(const std::string &lib_flags) {
+  std::vector<std::string> search_dirs;
+  std::vector<std::string> names;
+  for (auto flag : split(lib_flags, " ")) {
+    flag.erase(std::remove(flag.begin(), flag.end(), '"'), flag.end());
+    if (starts_with(flag, "-L")) {
+      search_dirs.push_back(flag.substr(2));
+    } else if (starts_with(flag, "-l")) {
+      names.push_back(flag.substr(2));
+    }
+  }
+
+  for (auto &name : names) {
+    const std::string leaf_name = "lib" + name +
+#ifdef __APPLE__
+                                  ".dylib";
+#else
+                                  ".so";
+#endif
+    /* the C library is already part of this process, and its development
+     * .so files may be linker scripts that cannot be loaded */
+    if (in(name, std::set<std::string>{"c", "m", "dl", "pthread", "rt"})) {
+      continue;
+    }
+
+    bool loaded = false;
+    std::string error;
+    for (auto &search_dir : search_dirs) {
+      const std::string library = search_dir + "/" + leaf_name;
+      if (file_exists(library) &&
+          !llvm::sys::DynamicLibrary::LoadLibraryPermanently(library.c_str(),
+                                                             &error)) {
+        loaded = true;
+        break;
+      }
+    }
+
+    if (!loaded && llvm::sys::DynamicLibrary::LoadLibraryPermanently(
+                       leaf_name.c_str(), error.empty() ? &error : nullptr)) {
+      throw user_error(INTERNAL_LOC(), "unable to load library %s: %s",
+                       leaf_name.c_str(), error.c_str());
+    }
+  }
+}
+
+/* the writable data sections of the program, which hold the globals that
+ * main computes at runtime */
+using DataSections = std::vector<std::pair<uint8_t *, uintptr_t>>;
+
+class DataSectionMemoryManager : public llvm::SectionMemoryManager {
+public:
+  explicit DataSectionMemoryManager(std::shared_ptr<DataSections> data_sections)
+      : data_sections(data_sections) {
+  }
+
+  uint8_t *allocateDataSection(uintptr_t size,
+                               unsigned alignment,
+                               unsigned section_id,
+                               llvm::StringRef section_name,
+                               bool is_read_only) override {
+    uint8_t *section = llvm::SectionMemoryManager::allocateDataSection(
+        size, alignment, section_id, section_name, is_read_only);
+    if (section != nullptr && !is_read_only && size != 0) {
+      data_sections->push_back({section, size});
+    }
+    return section;
+  }
+
+private:
+  std::shared_ptr<DataSections> data_sections;
+};
+
+/* the collector only scans the data of the executable and of the libraries
+ * that it loaded, so the program's globals would otherwise not keep what they
+ * point to alive */
+void add_gc_roots(const DataSections &data_sections) {
+  auto gc_add_roots = reinterpret_cast<void (*)(void *, void *)>(
+      llvm::sys::DynamicLibrary::SearchForAddressOfSymbol("GC_add_roots"));
+  if (gc_add_roots == nullptr) {
+    throw user_error(INTERNAL_LOC(),
+                     "unable to find GC_add_roots to register the program's "
+                     "globals with the collector");
+  }
+  for (auto &data_section : data_sections) {
+    debug_above(2, log("adding gc roots for %d bytes of globals",
+                       int(data_section.second)));
+    gc_add_roots(data_section.first,
+                 data_section.first + data_section.second);
+  }
+}
+
+} // namespace
+
+int jit_program(std::unique_ptr<llvm::LLVMContext> context,
+                std::unique_ptr<llvm::Module> llvm_module,
+                const std::string &lib_flags,
+                const std::vector<std::string> &args) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  auto data_sections = std::make_shared<DataSections>();
+  auto jit = check_llvm_error(
+      llvm::orc::LLJITBuilder()
+          .setObjectLinkingLayerCreator(
+              [data_sections](llvm::orc::ExecutionSession &execution_session,
+                              const llvm::Triple &)
+                  -> llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>> {
+                return std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(
+                    execution_session, [data_sections]() {
+                      return std::make_unique<DataSectionMemoryManager>(
+                          data_sections);
+                    });
+              })
+          .create(),
+      "unable to create JIT");
+  llvm_module->setDataLayout(jit->getDataLayout());
+  llvm_module->setTargetTriple(jit->getTargetTriple().str());
+  optimize_module(*llvm_module);
+
+  load_libraries(lib_flags);
+  jit->getMainJITDylib().addGenerator(check_llvm_error(
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          jit->getDataLayout().getGlobalPrefix()),
+      "unable to search this process for symbols"));
+
+  check_llvm_error(jit->addIRModule(llvm::orc::ThreadSafeModule(
+                       std::move(llvm_module), std::move(context))),
+                   "unable to add program");
+
+  auto main_symbol = check_llvm_error(jit->lookup("main"),
+                                      "unable to link program");
+  auto main = reinterpret_cast<int (*)(int, char **)>(
+      main_symbol.getAddress());
+  add_gc_roots(*data_sections);
+
+  std::vector<char *> argv;
+  for (auto &arg : args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+  return main(args.size(), argv.data());
+}
+
+} // namespace zion
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm_zion.h"
+
+namespace zion {
+
+/* optimize llvm_module and compile it in process with an ORC LLJIT. the
+ * libraries named by -l in lib_flags are loaded into the process to resolve
+ * its external symbols. the program's writable data is registered with the
+ * collector as roots, and then its main is called with args. returns the
+ * result of main. */
+int jit_program(std::unique_ptr<llvm::LLVMContext> context,
+                std::unique_ptr<llvm::Module> llvm_module,
+                const std::string &lib_flags,
+                const std::vector<std::string> &args);
+
+} // namespace zion
@@ -1,9 +1,11 @@
 #include "lexer.h"
 
+#include <array>
 #include <csignal>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <iterator>
 
 #include "dbg.h"
 #include "logger_decls.h"
@@ -13,8 +15,17 @@
 
 namespace zion {
 
+Lexer::Lexer(std::string filename, std::string_view source)
+    : m_file_id(intern_filename(filename)), m_pos(source.data()),
+      m_end(source.data() + source.size()) {
+}
+
 Lexer::Lexer(std::string filename, std::istream &sock_is)
-    : m_filename(filename), m_is(sock_is) {
+    : m_file_id(intern_filename(filename)),
+      m_owned_source(std::istreambuf_iterator<char>(sock_is),
+                     std::istreambuf_iterator<char>()),
+      m_pos(m_owned_source.data()),
+      m_end(m_owned_source.data() + m_owned_source.size()) {
 }
 
 bool istchar_start(char ch) {
@@ -32,13 +43,22 @@ bool istchar(char ch) {
 }
 
 bool Lexer::eof() {
-  return m_is.eof();
+  return m_pos == m_end;
+}
+
+char Lexer::peek_char() const {
+  return m_pos != m_end ? *m_pos : EOF;
+}
+
+char Lexer::get_char() {
+  return m_pos != m_end ? *m_pos++ : EOF;
 }
 
 bool Lexer::get_token(Token &token,
                       bool &newline,
                       std::vector<Token> *comments) {
   newline = false;
+  TokenSpan span;
   do {
     for (int i = 0; i < 2 && m_token_queue.empty(); ++i) {
       if (!_get_tokens()) {
@@ -49,25 +69,40 @@ bool Lexer::get_token(Token &token,
 
     assert(!m_token_queue.empty());
 
-    token = m_token_queue.pop();
+    span = m_token_queue.pop();
 
-    if (token.tk == tk_newline) {
+    if (span.tk == tk_newline) {
       newline = true;
-    } else {
-      // log_location(token.location, "%s", token.str().c_str());
     }
 
-    if (comments != nullptr && token.tk == tk_comment) {
-      comments->push_back(token);
+    if (comments != nullptr && span.tk == tk_comment) {
+      comments->push_back(span.token());
     }
-  } while (token.tk == tk_newline || token.tk == tk_space ||
-           token.tk == tk_comment);
+  } while (span.tk == tk_newline || span.tk == tk_space ||
+           span.tk == tk_comment);
+
+  /* whitespace and comments never get this far, so only tokens that the
+   * parser actually consumes are copied out of the source buffer. */
+  token = span.token();
 
   debug_lexer(log(log_info, "lexed (%s) \"%s\"@%s", tkstr(token.tk),
                   token.text.c_str(), token.location().c_str()));
   return token.tk != tk_none;
 }
 
+/* escaped char literals decode to a char that does not appear in the source
+ * buffer, so their text points into a table of every possible char. */
+std::string_view decoded_char(char ch) {
+  static const std::array<char, 256> chars = [] {
+    std::array<char, 256> chars;
+    for (int i = 0; i < 256; ++i) {
+      chars[i] = char(i);
+    }
+    return chars;
+  }();
+  return std::string_view(&chars[(unsigned char)ch], 1);
+}
+
 #define gts_keyword_case_ex(wor, letter, _gts)                                 \
   case gts_##wor:                                                              \
     if (ch != letter) {                                                        \
@@ -158,13 +193,17 @@ bool Lexer::_get_tokens() {
 
   char ch = 0;
   size_t sequence_length = 0;
-  std::string token_text;
+  /* the text of the token is the span of the source buffer from token_start
+   * up to m_pos, unless it is a char literal, whose decoded text is kept in
+   * char_text. */
+  const char *token_start = m_pos;
+  std::string_view char_text;
   TokenKind tk = tk_none;
   int line = m_line;
   int col = m_col;
   int multiline_comment_depth = 0;
   while (gts != gts_end && gts != gts_error) {
-    ch = m_is.peek();
+    ch = peek_char();
 
     switch (gts) {
     case gts_whitespace:
@@ -260,7 +299,7 @@ bool Lexer::_get_tokens() {
     case gts_multiline_comment:
       assert(multiline_comment_depth > 0);
       if (ch == EOF) {
-        throw user_error(Location{m_filename, m_line, m_col},
+        throw user_error(Location{m_file_id, m_line, m_col},
                          "end-of-file encountered within a multiline comment");
       } else if (ch == '*') {
         gts = gts_multiline_comment_star;
@@ -426,7 +465,7 @@ bool Lexer::_get_tokens() {
       case '\t':
         tk = tk_none;
         gts = gts_error;
-        log_location(log_error, Location(m_filename, m_line, m_col),
+        log_location(log_error, Location(m_file_id, m_line, m_col),
                      "encountered a tab character (\\t) used outside of a "
                      "string literal");
         break;
@@ -492,7 +531,7 @@ bool Lexer::_get_tokens() {
       };
 
       if (gts == gts_start) {
-        if (ch == EOF || m_is.fail()) {
+        if (ch == EOF || m_pos == m_end) {
           tk = tk_none;
           gts = gts_end;
           break;
@@ -593,8 +632,10 @@ bool Lexer::_get_tokens() {
         gts = gts_expon_symbol;
       } else if (ch == '.') {
         assert(tk != tk_char);
-        m_token_queue.enqueue(Location{m_filename, line, col}, tk, token_text);
-        token_text.clear();
+        m_token_queue.enqueue(
+            Location{m_file_id, line, col}, tk,
+            std::string_view(token_start, m_pos - token_start));
+        token_start = m_pos;
         col = m_col;
         gts = gts_start;
         scan_ahead = false;
@@ -609,8 +650,10 @@ bool Lexer::_get_tokens() {
       if (ch == 'e') {
         gts = gts_expon_symbol;
       } else if (ch == '.') {
-        m_token_queue.enqueue(Location{m_filename, line, col}, tk, token_text);
-        token_text.clear();
+        m_token_queue.enqueue(
+            Location{m_file_id, line, col}, tk,
+            std::string_view(token_start, m_pos - token_start));
+        token_start = m_pos;
         col = m_col;
         gts = gts_start;
         scan_ahead = false;
@@ -642,7 +685,7 @@ bool Lexer::_get_tokens() {
     case gts_quoted:
       if (ch == EOF) {
         throw user_error(
-            Location{m_filename, m_line, m_col},
+            Location{m_file_id, m_line, m_col},
             "end-of-file encountered in the middle of a quoted string");
       } else if (sequence_length > 0) {
         --sequence_length;
@@ -661,7 +704,7 @@ bool Lexer::_get_tokens() {
     case gts_end_quoted:
       if (nested_tks.size() != 0 &&
           nested_tks.back().second == tk_string_expr_prefix &&
-          token_text[0] == '}') {
+          *token_start == '}') {
         tk = tk_string_expr_suffix;
       } else {
         tk = tk_string;
@@ -674,10 +717,10 @@ bool Lexer::_get_tokens() {
       break;
     case gts_quoted_dollar:
       if (ch == '{') {
-        if (token_text[0] == '"') {
+        if (*token_start == '"') {
           tk = tk_string_expr_prefix;
         } else {
-          assert(token_text[0] == '}');
+          assert(*token_start == '}');
           tk = tk_string_expr_continuation;
         }
         gts = gts_end;
@@ -699,54 +742,52 @@ bool Lexer::_get_tokens() {
         gts = gts_error;
       } else {
         gts = gts_single_quoted_got_char;
-        token_text.clear();
-        token_text += ch;
+        char_text = std::string_view(m_pos, 1);
         scan_ahead = false;
-        m_is.get(ch);
+        get_char();
       }
       break;
     case gts_single_quoted_escape:
       gts = gts_single_quoted_got_char;
-      token_text.clear();
       switch (ch) {
       case 'a':
-        token_text += '\a';
+        char_text = decoded_char('\a');
         break;
       case 'b':
-        token_text += '\b';
+        char_text = decoded_char('\b');
         break;
       case 'e':
-        token_text += '\e';
+        char_text = decoded_char('\e');
         break;
       case 'f':
-        token_text += '\f';
+        char_text = decoded_char('\f');
         break;
       case 'n':
-        token_text += '\n';
+        char_text = decoded_char('\n');
         break;
       case 'r':
-        token_text += '\r';
+        char_text = decoded_char('\r');
         break;
       case 't':
-        token_text += '\t';
+        char_text = decoded_char('\t');
         break;
       case 'v':
-        token_text += '\v';
+        char_text = decoded_char('\v');
         break;
       case '\\':
-        token_text += '\\';
+        char_text = decoded_char('\\');
         break;
       case '\'':
-        token_text += '\'';
+        char_text = decoded_char('\'');
         break;
       case '0':
-        token_text.append(1, '\0');
+        char_text = decoded_char('\0');
         break;
       case '"':
-        token_text += '"';
+        char_text = decoded_char('"');
         break;
       case '?':
-        token_text += '?';
+        char_text = decoded_char('?');
         break;
       case 'x':
         assert(!!"handle hex-encoded chars");
@@ -757,22 +798,22 @@ bool Lexer::_get_tokens() {
       }
       if (gts != gts_error) {
         scan_ahead = false;
-        m_is.get(ch);
+        get_char();
       }
       break;
     case gts_single_quoted_got_char:
       if (ch != '\'') {
         gts = gts_error;
       } else {
-        m_is.get(ch);
+        get_char();
         scan_ahead = false;
         tk = tk_char;
         gts = gts_end;
       }
       break;
     case gts_error:
-      log(log_warning, "token lexing error occurred, so far = (%s)",
-          token_text.c_str());
+      log(log_warning, "token lexing error occurred, so far = (%.*s)",
+          int(m_pos - token_start), token_start);
       break;
     case gts_end:
       break;
@@ -782,7 +823,7 @@ bool Lexer::_get_tokens() {
 #ifdef ZION_DEBUG
       char ch_old = ch;
 #endif
-      m_is.get(ch);
+      ch = get_char();
       if (ch == '\n') {
         ++m_line;
         m_col = 1;
@@ -790,14 +831,6 @@ bool Lexer::_get_tokens() {
         ++m_col;
       }
       assert(ch == ch_old);
-
-      token_text += ch;
-#if 0
-      if (!m_is.fail()) && !token_text.append(ch)) {
-        log(log_error, "symbol too long? [line %d: col %d]", m_line, m_col);
-        return false;
-      }
-#endif
     }
     scan_ahead = true;
   }
@@ -805,7 +838,10 @@ bool Lexer::_get_tokens() {
   handle_nests(tk);
 
   if (gts != gts_error && tk != tk_error) {
-    m_token_queue.enqueue(Location{m_filename, line, col}, tk, token_text);
+    m_token_queue.enqueue(
+        Location{m_file_id, line, col}, tk,
+        tk == tk_char ? char_text
+                      : std::string_view(token_start, m_pos - token_start));
     return true;
   }
 
@@ -818,7 +854,7 @@ bool Lexer::handle_nests(TokenKind tk) {
   switch (tk) {
   case tk_string_expr_continuation:
     if (was_empty || nested_tks.back().second != tk_string_expr_prefix) {
-      throw user_error(Location{m_filename, m_line, m_col},
+      throw user_error(Location{m_file_id, m_line, m_col},
                        "misplaced string expression continuation");
     }
     break;
@@ -826,7 +862,7 @@ bool Lexer::handle_nests(TokenKind tk) {
   case tk_lsquare:
   case tk_lparen:
   case tk_lcurly:
-    nested_tks.push_back({Location(m_filename, m_line, m_col - 1), tk});
+    nested_tks.push_back({Location(m_file_id, m_line, m_col - 1), tk});
     break;
   case tk_rsquare:
     pop_nested(tk_lsquare);
@@ -853,7 +889,7 @@ void Lexer::pop_nested(TokenKind tk) {
   } else if (back_tk != tk) {
     log_location(
         log_error,
-        nested_tks.size() == 0 ? Location{m_filename, m_line, m_col - 1}
+        nested_tks.size() == 0 ? Location{m_file_id, m_line, m_col - 1}
                                : nested_tks.back().first,
         "detected unbalanced brackets %s != %s", tkstr(back_tk), tkstr(tk));
   }
@@ -1,4 +1,7 @@
 #pragma once
+#include <string_view>
+#include <vector>
+
 #include "token.h"
 #include "token_queue.h"
 
@@ -17,6 +20,10 @@ struct token_pair {
 
 class Lexer {
 public:
+  /* lex directly out of a caller-owned buffer (typically a MappedFile). the
+   * buffer must outlive the lexer. */
+  Lexer(std::string filename, std::string_view source);
+  /* lex from a stream by first reading it into a buffer owned by the lexer */
   Lexer(std::string filename, std::istream &sock_is);
   ~Lexer();
 
@@ -24,15 +31,19 @@ public:
   bool _get_tokens();
   bool eof();
 
-  std::list<std::pair<Location, TokenKind>> nested_tks;
+  std::vector<std::pair<Location, TokenKind>> nested_tks;
 
 private:
   void reset_token();
   bool handle_nests(TokenKind tk);
   void pop_nested(TokenKind tk);
+  char peek_char() const;
+  char get_char();
 
-  std::string m_filename;
-  std::istream &m_is;
+  FileId m_file_id;
+  std::string m_owned_source;
+  const char *m_pos = nullptr;
+  const char *m_end = nullptr;
   int m_line = 1, m_col = 1;
   TokenQueue m_token_queue;
 };
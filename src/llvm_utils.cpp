@@ -775,16 +775,48 @@ void destructure_closure(llvm::IRBuilder<> &builder,
   dbg_when(llvm_print(*llvm_function).find("badref") != std::string::npos);
 }
 
+llvm::Function *llvm_get_known_function(llvm::Value *closure) {
+  auto global = llvm::dyn_cast<llvm::GlobalVariable>(
+      closure->stripPointerCasts());
+  if (global == nullptr || !global->isConstant() ||
+      !global->hasDefinitiveInitializer()) {
+    return nullptr;
+  }
+  auto initializer = llvm::dyn_cast<llvm::ConstantStruct>(
+      global->getInitializer());
+  if (initializer == nullptr || initializer->getNumOperands() != 2 ||
+      !initializer->getOperand(1)->isNullValue()) {
+    return nullptr;
+  }
+  auto llvm_function = llvm::dyn_cast<llvm::Function>(
+      initializer->getOperand(0));
+  /* the closure may have been cast to another type of closure, in which case
+   * the caller expects a function of that type */
+  auto closure_type = llvm::dyn_cast<llvm::StructType>(
+      closure->getType()->getPointerElementType());
+  if (llvm_function == nullptr || closure_type == nullptr ||
+      closure_type->getNumElements() != 2 ||
+      closure_type->getElementType(0) != llvm_function->getType()) {
+    return nullptr;
+  }
+  return llvm_function;
+}
+
 llvm::Value *llvm_create_closure_callsite(Location location,
                                           llvm::IRBuilder<> &builder,
                                           llvm::Value *closure,
                                           std::vector<llvm::Value *> args) {
   assert(builder.GetInsertBlock() != nullptr);
-  llvm::Value *llvm_function_to_call = nullptr;
-  destructure_closure(builder, closure, &llvm_function_to_call, nullptr);
-
-  args.push_back(builder.CreateBitCast(
-      closure, builder.getInt8Ty()->getPointerTo(), "closure_cast"));
+  llvm::Value *llvm_function_to_call = llvm_get_known_function(closure);
+  if (llvm_function_to_call != nullptr) {
+    /* a function that captures nothing never reads its env */
+    args.push_back(
+        llvm::Constant::getNullValue(builder.getInt8Ty()->getPointerTo()));
+  } else {
+    destructure_closure(builder, closure, &llvm_function_to_call, nullptr);
+    args.push_back(builder.CreateBitCast(
+        closure, builder.getInt8Ty()->getPointerTo(), "closure_cast"));
+  }
 
   debug_above(4, log("calling builder.CreateCall(%s, {%s, %s})",
                      llvm_print(llvm_function_to_call->getType()).c_str(),
@@ -140,6 +140,12 @@ void explain(llvm::Type *llvm_type);
 std::vector<llvm::Type *> llvm_get_types(
     const std::vector<llvm::Value *> &llvm_values);
 
+/* the function run by closure, when closure is the constant global closure
+ * of a function that captures nothing, otherwise nullptr */
+llvm::Function *llvm_get_known_function(llvm::Value *closure);
+
+/* call closure with args. known functions are called directly, otherwise the
+ * function is loaded out of the closure, which is passed as its env. */
 llvm::Value *llvm_create_closure_callsite(Location location,
                                           llvm::IRBuilder<> &builder,
                                           llvm::Value *closure,
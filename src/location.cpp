@@ -1,5 +1,7 @@
 #include "location.h"
 
+#include <deque>
+#include <mutex>
 #include <sstream>
 #include <string.h>
 #include <string>
@@ -9,11 +11,79 @@
 #include "utils.h"
 #include "zion.h"
 
-Location::Location() : Location({}, -1, -1) {
+namespace {
+
+struct FilenameTable {
+  FilenameTable() {
+    /* FileId{} is reserved for the empty filename */
+    filenames.push_back("");
+    ids_by_filename[""] = FileId{};
+  }
+
+  std::mutex mutex;
+  /* a deque never moves its elements, so references handed out by
+   * get_filename stay valid as the table grows */
+  std::deque<std::string> filenames;
+  std::unordered_map<std::string, FileId> ids_by_filename;
+  std::unordered_map<const char *, FileId> ids_by_literal;
+};
+
+FilenameTable &get_filename_table() {
+  static FilenameTable filename_table;
+  return filename_table;
+}
+
+FileId intern_filename_locked(FilenameTable &table,
+                              const std::string &filename) {
+  auto iter = table.ids_by_filename.find(filename);
+  if (iter != table.ids_by_filename.end()) {
+    return iter->second;
+  }
+  FileId file_id = FileId(table.filenames.size());
+  table.filenames.push_back(filename);
+  table.ids_by_filename.insert({filename, file_id});
+  return file_id;
+}
+
+} // namespace
+
+FileId intern_filename(const std::string &filename) {
+  auto &table = get_filename_table();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  return intern_filename_locked(table, filename);
+}
+
+FileId intern_filename_literal(const char *filename) {
+  auto &table = get_filename_table();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  auto iter = table.ids_by_literal.find(filename);
+  if (iter != table.ids_by_literal.end()) {
+    return iter->second;
+  }
+  FileId file_id = intern_filename_locked(table, filename);
+  table.ids_by_literal.insert({filename, file_id});
+  return file_id;
+}
+
+const std::string &get_filename(FileId file_id) {
+  auto &table = get_filename_table();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  return table.filenames[size_t(file_id)];
+}
+
+Location::Location() : Location(FileId{}, -1, -1) {
 }
 
 Location::Location(std::string filename, int line, int col)
-    : filename(filename), line(line), col(col) {
+    : file_id(intern_filename(filename)), line(line), col(col) {
+}
+
+Location::Location(FileId file_id, int line, int col)
+    : file_id(file_id), line(line), col(col) {
+}
+
+const std::string &Location::filename() const {
+  return get_filename(file_id);
 }
 
 std::string Location::filename_repr() const {
@@ -29,6 +99,7 @@ std::string Location::filename_repr() const {
 
   std::stringstream ss;
   if (has_file_location()) {
+    const std::string &filename = this->filename();
     if (starts_with(filename, "./")) {
       auto str = filename.c_str();
       ss << (str + 2);
@@ -66,10 +137,9 @@ std::ostream &operator<<(std::ostream &os, const Location &location) {
 }
 
 bool Location::operator<(const Location &rhs) const {
-  if (filename < rhs.filename) {
-    return true;
-  } else if (filename > rhs.filename) {
-    return false;
+  if (file_id != rhs.file_id) {
+    /* order by name, not by the order in which files were interned */
+    return filename() < rhs.filename();
   } else if (line < rhs.line) {
     return true;
   } else if (line > rhs.line) {
@@ -80,26 +150,26 @@ bool Location::operator<(const Location &rhs) const {
 }
 
 bool Location::operator==(const Location &rhs) const {
-  return filename == rhs.filename && line == rhs.line && col == rhs.col;
+  return file_id == rhs.file_id && line == rhs.line && col == rhs.col;
 }
 
 bool Location::operator!=(const Location &rhs) const {
-  return filename != rhs.filename || line != rhs.line || col != rhs.col;
+  return file_id != rhs.file_id || line != rhs.line || col != rhs.col;
 }
 
 bool Location::has_file_location() const {
-  return filename.size() != 0 && line != -1 && col != -1;
+  return file_id != FileId{} && line != -1 && col != -1;
 }
 
 Location best_location(Location a, Location b) {
   /* this function is entirely heuristic garbage. */
   // FUTURE: do better at plumbing info around so that heuristics like this are
   // less necessary
-  if (a.filename.find(".cpp") != std::string::npos) {
+  if (a.filename().find(".cpp") != std::string::npos) {
     return b;
   } else {
-    if (a.filename.find("lib/") != std::string::npos &&
-        b.filename.find("lib/") == std::string::npos) {
+    if (a.filename().find("lib/") != std::string::npos &&
+        b.filename().find("lib/") == std::string::npos) {
       return b;
     } else {
       return a;
@@ -1,26 +1,39 @@
 #pragma once
 
+#include <cstdint>
 #include <ostream>
 
 #include "utils.h"
 
 #define INTERNAL_LOC()                                                         \
   ::Location {                                                                 \
-    __FILE__, __LINE__, 1                                                      \
+    ::intern_filename_literal(__FILE__), __LINE__, 1                           \
   }
 
+/* source filenames are interned into a process-wide table, and a Location
+ * refers to its file by index. FileId{} is the empty filename. */
+enum class FileId : uint32_t {};
+
+FileId intern_filename(const std::string &filename);
+/* like intern_filename, but caches by pointer. only use this with string
+ * literals such as __FILE__. */
+FileId intern_filename_literal(const char *filename);
+const std::string &get_filename(FileId file_id);
+
 struct Location {
   template <typename T> Location(T t) = delete;
 
   Location();
   explicit Location(std::string filename, int line, int col);
+  explicit Location(FileId file_id, int line, int col);
 
   std::string str() const;
   std::string repr() const;
   std::string operator()() const;
   std::string filename_repr() const;
+  const std::string &filename() const;
 
-  std::string filename;
+  FileId file_id{};
   int line = -1;
   int col = -1;
 
@@ -1,5 +1,6 @@
 #include "logger.h"
 
+#include <atomic>
 #include <csignal>
 #include <cstdarg>
 #include <cstdio>
@@ -25,6 +26,8 @@ static int _max_log_depth = atoi(
 
 int logger_level = log_info | log_warning | log_error | log_panic;
 
+static std::atomic<int> _log_count{0};
+
 void log_enable(int log_level) {
   logger_level = log_level;
 }
@@ -353,6 +356,10 @@ void panic_(const char *filename, int line, std::string msg) {
   raise(SIGKILL);
 }
 
+int get_log_count() {
+  return _log_count;
+}
+
 void log_location(LogLevel level,
                   const Location &location,
                   const char *format,
@@ -396,6 +403,7 @@ void logv_location(LogLevel level,
     return;
   }
 
+  ++_log_count;
   _logger->logv(level, &location, format, args);
 }
 
@@ -403,6 +411,7 @@ void logv(LogLevel level, const char *format, va_list args) {
   if (mask(logger_level, level) == 0)
     return;
 
+  ++_log_count;
   _logger->logv(level, nullptr, format, args);
 }
 
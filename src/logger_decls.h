@@ -25,6 +25,8 @@ void log_location(LogLevel level,
                   const char *format,
                   ...);
 void log_location(const Location &location, const char *format, ...);
+/* how many messages have been logged so far */
+int get_log_count();
 void panic_(const char *filename, int line, std::string msg);
 void log_stack(LogLevel level);
 void log_dump();
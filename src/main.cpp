@@ -1,25 +1,38 @@
+#include <cerrno>
+#include <climits>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <sys/resource.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
 #include "ast.h"
+#include "build_cache.h"
 #include "builtins.h"
 #include "checked.h"
 #include "class_predicate.h"
 #include "compiler.h"
 #include "context.h"
 #include "disk.h"
+#include "emit.h"
 #include "gen.h"
 #include "graph.h"
 #include "host.h"
+#include "instance_index.h"
+#include "interface_cache.h"
+#include "jit.h"
 #include "lexer.h"
 #include "logger.h"
 #include "logger_decls.h"
+#include "server.h"
 #include "solver.h"
+#include "specialize_hofs.h"
 #include "tarjan.h"
 #include "tests.h"
+#include "thread_pool.h"
+#include "time_trace.h"
 #include "tld.h"
 #include "translate.h"
 #include "unification.h"
@@ -36,6 +49,11 @@ const char *LOGO = C_UNCHECKED R"(
 
 )" C_RESET;
 
+namespace {
+/* run a zion command line the way main does */
+int run_command_line(const std::vector<std::string> &argv);
+} // namespace
+
 namespace zion {
 
 using namespace ast;
@@ -50,6 +68,41 @@ bool debug_specialized_env = getenv("SHOW_ENV2") != nullptr;
 bool debug_types = getenv("SHOW_TYPES") != nullptr;
 bool debug_all_expr_types = getenv("SHOW_EXPR_TYPES") != nullptr;
 bool debug_all_translated_defns = getenv("SHOW_DEFN_TYPES") != nullptr;
+bool show_stats = false;
+
+/* for --stats, the arena bytes in use at the end of each phase */
+std::vector<std::pair<std::string, std::size_t>> phase_arena_bytes;
+
+/* note the end of a phase for --stats and --time-trace */
+void record_phase(std::string phase) {
+  if (show_stats) {
+    phase_arena_bytes.push_back({phase, Arena::current().bytes_allocated()});
+  }
+  time_trace_counter("interned symbols", Symbol::interned_count());
+  if (time_trace_enabled()) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    /* macOS reports bytes rather than kilobytes */
+    usage.ru_maxrss /= 1024;
+#endif
+    time_trace_counter("peak rss kb", usage.ru_maxrss);
+  }
+}
+
+void print_stats() {
+  std::size_t prior_bytes = 0;
+  for (auto &pair : phase_arena_bytes) {
+    std::cerr << "arena: " << pair.first << " " << pair.second - prior_bytes
+              << " bytes" << std::endl;
+    prior_bytes = pair.second;
+  }
+  std::cerr << "arena: total " << prior_bytes << " bytes" << std::endl;
+  std::cerr << "demoted allocations: " << get_demoted_allocation_count()
+            << std::endl;
+  std::cerr << "specialized higher-order functions: "
+            << get_hof_specialization_count() << std::endl;
+}
 
 int run_program(std::string executable, std::vector<std::string> args) {
   pid_t pid = fork();
@@ -107,7 +160,7 @@ types::Map resolve_free_type_after_specialization_inference(
     const ast::Expr *expr,
     types::Ref type,
     const types::ClassPredicates &instance_requirements,
-    const types::ClassPredicates &instance_predicates) {
+    const types::InstanceIndex &instance_index) {
   if (type->ftv_count() != 0) {
 #ifdef ZION_DEBUG
     INDENT(2, "--resolve_free_type_after_specialization_inference--");
@@ -133,43 +186,12 @@ types::Map resolve_free_type_after_specialization_inference(
     for (auto &referenced_predicate : referenced_predicates) {
       debug_above(2, log("we need to solve %s against {%s}",
                          referenced_predicate->str().c_str(),
-                         join_str(instance_predicates, ", ").c_str()));
+                         join_str(instance_index.get_instance_predicates(),
+                                  ", ")
+                             .c_str()));
 
       types::Map bindings;
-      types::ClassPredicates found_instances;
-      for (auto &instance_predicate_ : instance_predicates) {
-        /* let's freshen the instance_predicate */
-        std::map<std::string, std::string> new_ftvs;
-        for (auto &ftv : instance_predicate_->get_ftvs()) {
-          new_ftvs[ftv] = gensym_name();
-        }
-        auto instance_predicate = instance_predicate_->remap_vars(new_ftvs);
-
-        if (instance_predicate->classname.name ==
-            referenced_predicate->classname.name) {
-          /* we are referring to the same type class. now, let's unify the
-           * instance parameters in an attempt to resolve any functional
-           * dependencies between the associated types. */
-          debug_above(3, log("Attempting to unify %s with %s",
-                             instance_predicate->str().c_str(),
-                             referenced_predicate->str().c_str()));
-          types::Unification unification = types::unify_many(
-              instance_predicate->params, referenced_predicate->params);
-          if (unification.result) {
-            debug_above(3, log("%s unified with %s with bindings %s",
-                               instance_predicate->str().c_str(),
-                               referenced_predicate->str().c_str(),
-                               str(unification.bindings).c_str()));
-            /* unification was successful. now check whether we've already
-             * found a matching instance or not */
-            /* this is the only instance which unifies so far. that's good */
-            found_instances.insert(instance_predicate);
-            std::swap(bindings, unification.bindings);
-          }
-        }
-      }
-
-      if (found_instances.size() == 1) {
+      if (instance_index.resolve(*referenced_predicate, bindings)) {
         assert(bindings.size() != 0);
 
         /* this is good, it means that we found a single type class
@@ -206,7 +228,9 @@ void tracked_types_have_ftvs(const TrackedTypes &tracked_types,
 CheckedDefinitionRef check_decl(
     const bool check_constraint_coverage,
     const DataCtorsMap &data_ctors_map,
-    const types::ClassPredicates &instance_predicates,
+    /* when given, free type variables that remain after checking are resolved
+     * against the program's instances */
+    const types::InstanceIndex *instance_index,
     const Identifier id,
     const Decl *decl,
     const types::Ref expected_type,
@@ -225,6 +249,7 @@ CheckedDefinitionRef check_decl(
                         make_context(expected_type->get_location(),
                                      "declaration %s has its expected type",
                                      id.str().c_str()));
+  time_trace_add_counter("constraints", constraints.size());
   types::Map bindings = zion::solver(
       check_constraint_coverage,
       make_context(id.location, "solving %s :: %s", id.name.c_str(),
@@ -235,7 +260,8 @@ CheckedDefinitionRef check_decl(
   instance_requirements = types::rebind(instance_requirements, bindings);
   types::SchemeRef scheme = ty->generalize(instance_requirements)->normalize();
 
-  if (instance_predicates.size() != 0) {
+  if (instance_index != nullptr &&
+      !instance_index->get_instance_predicates().empty()) {
     types::Ftvs last_seen_ftvs;
     while (true) {
       types::Ftvs ftvs;
@@ -252,7 +278,7 @@ CheckedDefinitionRef check_decl(
         const types::Ref &type = pair.second;
 
         types::Map bindings = resolve_free_type_after_specialization_inference(
-            expr, type, instance_requirements, instance_predicates);
+            expr, type, instance_requirements, *instance_index);
 
         if (bindings.size() != 0) {
           rebind_tracked_types(tracked_types, bindings);
@@ -287,7 +313,7 @@ CheckedDefinitionRef check_decl(
                            referenced_predicate->str().c_str());
           }
           error.add_info(INTERNAL_LOC(), "amongst all these instances:");
-          for (auto &predicate : instance_predicates) {
+          for (auto &predicate : instance_index->get_instance_predicates()) {
             error.add_info(predicate->get_location(), "%s",
                            predicate->str().c_str());
           }
@@ -297,7 +323,9 @@ CheckedDefinitionRef check_decl(
     }
   }
 
-  return std::make_shared<CheckedDefinition>(scheme, decl, tracked_types);
+  return std::make_shared<CheckedDefinition>(
+      scheme, decl,
+      std::make_shared<const TrackedTypes>(std::move(tracked_types)));
 }
 
 void initialize_builtin_schemes(types::SchemeResolver &scheme_resolver) {
@@ -376,13 +404,156 @@ tarjan::Graph build_program_graph(const std::vector<const Decl *> &decls) {
   return graph;
 }
 
+/* run inference on one strongly connected component of the program, and
+ * publish the resulting schemes to scheme_resolver. */
+std::list<std::pair<std::string, CheckedDefinitionRef>> check_scc(
+    const tarjan::Vertices &scc,
+    const std::string &entry_point_name,
+    const std::unordered_map<Symbol, const Decl *> &decl_map,
+    const DataCtorsMap &data_ctors_map,
+    types::SchemeResolver &scheme_resolver) {
+  TimeTraceScope trace("check_scc", [&scc]() { return join(scc, ", "); });
+
+  /* we are looking at a strongly coupled (aka mutually recursive) set of
+   * functions or expressions. let's run inference on them all at once. */
+  types::SchemeResolver local_scheme_resolver(&scheme_resolver);
+
+  types::Map map;
+  /* seed the SCC with a local type scheme */
+  for (auto name : scc) {
+    if (decl_map.count(name) != 0) {
+      map[name] = type_variable(INTERNAL_LOC());
+      local_scheme_resolver.insert_scheme(name, scheme({}, {}, map[name]));
+    } else {
+#ifdef ZION_DEBUG
+      if (debug_level() > 2) {
+        log("found a reference to " c_id("%s") " in SCCs that has no decl",
+            name.c_str());
+        std::set<Identifier> candidates;
+        auto scheme = scheme_resolver.lookup_scheme(
+            Identifier{name, INTERNAL_LOC()}, candidates);
+        if (scheme != nullptr) {
+          log("looked up scheme %s :: %s", name.c_str(),
+              scheme->str().c_str());
+        } else {
+          log("no scheme existed for %s", name.c_str());
+        }
+      }
+#endif
+    }
+  }
+
+  TrackedTypes tracked_types;
+  types::Constraints constraints;
+  types::ClassPredicates instance_requirements;
+
+  for (auto name : scc) {
+    if (decl_map.count(name) != 0) {
+      auto ty = infer(decl_map.at(name)->value, data_ctors_map,
+                      nullptr /*return_type*/, local_scheme_resolver,
+                      tracked_types, constraints, instance_requirements);
+      if (name == entry_point_name) {
+        append_to_constraints(
+            constraints, ty,
+            type_arrow(INTERNAL_LOC(),
+                       type_params({type_unit(INTERNAL_LOC())}),
+                       type_unit(INTERNAL_LOC())),
+            make_context(INTERNAL_LOC(),
+                         "main function must have signature fn () ()"));
+      }
+
+      append_to_constraints(
+          constraints, ty, map[name],
+          make_context(INTERNAL_LOC(), "scc checks should match inference"));
+    }
+    debug_above(2, log("inferred types %s", str(map).c_str()));
+  }
+
+  if (debug_all_expr_types) {
+    INDENT(0, "--debug_all_expr_types--");
+    log("All Expression Types in {%s}", join(scc, ", ").c_str());
+    for (auto pair : tracked_types) {
+      log_location(pair.first->get_location(), "%s :: %s",
+                   pair.first->str().c_str(), pair.second->str().c_str());
+    }
+    log("All Constraints for {%s}", join(scc, ", ").c_str());
+    log("%s", str(constraints).c_str());
+  }
+
+  time_trace_add_counter("constraints", constraints.size());
+  types::Map bindings = zion::solver(false /*check_constraint_coverage*/,
+                                     make_context(INTERNAL_LOC(), "solving"),
+                                     constraints, tracked_types,
+                                     scheme_resolver, instance_requirements);
+
+  rebind_tracked_types(tracked_types, bindings);
+#ifdef ZION_DEBUG
+  if (debug_all_expr_types) {
+    log("Rebound Expression Types for {%s}", join(scc, ", ").c_str());
+    for (auto pair : tracked_types) {
+      log_location(pair.first->get_location(), "%s :: %s",
+                   pair.first->str().c_str(),
+                   pair.second->generalize({})->str().c_str());
+    }
+  }
+#endif
+  auto scc_tracked_types = std::make_shared<const TrackedTypes>(
+      std::move(tracked_types));
+  std::list<std::pair<std::string, CheckedDefinitionRef>> checked_defns;
+  for (auto pair : map) {
+    auto scheme = pair.second->rebind(bindings)->generalize(
+        types::rebind(instance_requirements, bindings));
+    // NB: do not normalize the scheme
+    debug_above(1, log("resolved %s to scheme %s", pair.first.c_str(),
+                       scheme->normalize()->str().c_str()));
+    scheme_resolver.insert_scheme(pair.first, scheme);
+    // TODO: consider altering CheckedDefinition to have a type, not a scheme
+    checked_defns.push_back(
+        {pair.first, std::make_shared<const CheckedDefinition>(
+                         scheme, decl_map.at(pair.first), scc_tracked_types)});
+  }
+  return checked_defns;
+}
+
+/* publish the schemes that an earlier compilation resolved for this SCC,
+ * rather than running inference on it. returns false, having published
+ * nothing, unless every decl in the SCC was found in the interface cache. */
+bool load_cached_scc(
+    const tarjan::Vertices &scc,
+    const std::unordered_map<Symbol, const Decl *> &decl_map,
+    const InterfaceCache &interface_cache,
+    types::SchemeResolver &scheme_resolver,
+    std::list<std::pair<std::string, CheckedDefinitionRef>> &checked_defns) {
+  auto no_tracked_types = std::make_shared<const TrackedTypes>();
+  for (auto name : scc) {
+    if (decl_map.count(name) != 0) {
+      const Decl *decl = decl_map.at(name);
+      auto scheme = interface_cache.lookup(decl->id.location, name);
+      if (scheme == nullptr) {
+        checked_defns.clear();
+        return false;
+      }
+      checked_defns.push_back(
+          {name, std::make_shared<const CheckedDefinition>(
+                     scheme, decl, no_tracked_types)});
+    }
+  }
+
+  for (auto &pair : checked_defns) {
+    scheme_resolver.insert_scheme(pair.first, pair.second->scheme);
+  }
+  return true;
+}
+
 CheckedDefinitionsByName check_decls(std::string user_program_name,
                                      std::string entry_point_name,
                                      const std::vector<const Decl *> &decls,
                                      const DataCtorsMap &data_ctors_map,
+                                     InterfaceCache &interface_cache,
                                      types::SchemeResolver &scheme_resolver,
                                      bool emit_graph_dot) {
-  std::unordered_map<std::string, const Decl *> decl_map;
+  TimeTraceScope trace("check_decls");
+  std::unordered_map<Symbol, const Decl *> decl_map;
   for (auto decl : decls) {
     debug_above(5,
                 log("adding decl named %s to decl_map", decl->id.name.c_str()));
@@ -400,103 +571,117 @@ CheckedDefinitionsByName check_decls(std::string user_program_name,
     ui::open_file(png_file);
   }
 
-  CheckedDefinitionsByName checked_defns;
+  /* tarjan hands back the SCCs in dependency order. an SCC only needs the
+   * schemes of the SCCs it refers to, so rather than checking them one at a
+   * time, walk the condensation DAG and check every SCC whose dependencies are
+   * done on the thread pool. */
+  std::vector<const tarjan::Vertices *> scc_list;
+  std::unordered_map<Symbol, int> scc_index;
   for (auto &scc : sccs) {
-    /* we are looking at a strongly coupled (aka mutually recursive) set of
-     * functions or expressions. let's run inference on them all at once. */
-    types::SchemeResolver local_scheme_resolver(&scheme_resolver);
-
-    types::Map map;
-    /* seed the SCC with a local type scheme */
-    for (auto name : scc) {
-      if (decl_map.count(name) != 0) {
-        map[name] = type_variable(INTERNAL_LOC());
-        local_scheme_resolver.insert_scheme(name, scheme({}, {}, map[name]));
-      } else {
-#ifdef ZION_DEBUG
-        if (debug_level() > 2) {
-          log("found a reference to " c_id("%s") " in SCCs that has no decl",
-              name.c_str());
-          std::set<Identifier> candidates;
-          auto scheme = scheme_resolver.lookup_scheme(
-              Identifier{name, INTERNAL_LOC()}, candidates);
-          if (scheme != nullptr) {
-            log("looked up scheme %s :: %s", name.c_str(),
-                scheme->str().c_str());
-          } else {
-            log("no scheme existed for %s", name.c_str());
-          }
+    for (auto &name : scc) {
+      scc_index[name] = scc_list.size();
+    }
+    scc_list.push_back(&scc);
+  }
+
+  const int scc_count = scc_list.size();
+  std::vector<int> pending(scc_count);
+  std::vector<std::vector<int>> dependents(scc_count);
+  for (int i = 0; i < scc_count; ++i) {
+    std::set<int> dependencies;
+    for (auto &name : *scc_list[i]) {
+      auto edges = graph.find(name);
+      if (edges == graph.end()) {
+        continue;
+      }
+      for (auto &dependency : edges->second) {
+        auto j = scc_index.find(dependency);
+        if (j != scc_index.end() && j->second != i) {
+          dependencies.insert(j->second);
         }
-#endif
       }
     }
+    pending[i] = dependencies.size();
+    for (auto j : dependencies) {
+      dependents[j].push_back(i);
+    }
+  }
 
-    TrackedTypes tracked_types;
-    types::Constraints constraints;
-    types::ClassPredicates instance_requirements;
-
-    for (auto name : scc) {
-      if (decl_map.count(name) != 0) {
-        auto ty = infer(decl_map.at(name)->value, data_ctors_map,
-                        nullptr /*return_type*/, local_scheme_resolver,
-                        tracked_types, constraints, instance_requirements);
-        if (name == entry_point_name) {
-          append_to_constraints(
-              constraints, ty,
-              type_arrow(INTERNAL_LOC(),
-                         type_params({type_unit(INTERNAL_LOC())}),
-                         type_unit(INTERNAL_LOC())),
-              make_context(INTERNAL_LOC(),
-                           "main function must have signature fn () ()"));
+  std::vector<std::list<std::pair<std::string, CheckedDefinitionRef>>> results(
+      scc_count);
+  std::mutex schedule_mutex;
+  /* report the same error a serial walk would have hit first: keep checking
+   * SCCs that precede the earliest failure, and skip everything after it. */
+  int first_failure = scc_count;
+  std::exception_ptr failure;
+
+  ThreadPool pool(get_worker_count());
+  std::function<void(int)> schedule = [&](int i) {
+    pool.enqueue([&, i] {
+      {
+        std::lock_guard<std::mutex> lock(schedule_mutex);
+        if (i > first_failure) {
+          return;
         }
+      }
 
-        append_to_constraints(
-            constraints, ty, map[name],
-            make_context(INTERNAL_LOC(), "scc checks should match inference"));
+      try {
+        if (!load_cached_scc(*scc_list[i], decl_map, interface_cache,
+                             scheme_resolver, results[i])) {
+          /* name the type variables of this SCC independently of every other
+           * SCC, so that the output does not depend on the worker count. */
+          GensymScope gensym_scope(std::to_string(i));
+          results[i] = check_scc(*scc_list[i], entry_point_name, decl_map,
+                                 data_ctors_map, scheme_resolver);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(schedule_mutex);
+        if (i < first_failure) {
+          first_failure = i;
+          failure = std::current_exception();
+        }
+        return;
       }
-      debug_above(2, log("inferred types %s", str(map).c_str()));
-    }
 
-    if (debug_all_expr_types) {
-      INDENT(0, "--debug_all_expr_types--");
-      log("All Expression Types in {%s}", join(scc, ", ").c_str());
-      for (auto pair : tracked_types) {
-        log_location(pair.first->get_location(), "%s :: %s",
-                     pair.first->str().c_str(), pair.second->str().c_str());
+      std::vector<int> ready;
+      {
+        std::lock_guard<std::mutex> lock(schedule_mutex);
+        for (auto dependent : dependents[i]) {
+          if (--pending[dependent] == 0) {
+            ready.push_back(dependent);
+          }
+        }
       }
-      log("All Constraints for {%s}", join(scc, ", ").c_str());
-      log("%s", str(constraints).c_str());
+      for (auto dependent : ready) {
+        schedule(dependent);
+      }
+    });
+  };
+
+  /* find the roots before scheduling any of them, since workers start
+   * decrementing pending as soon as the first root is enqueued. */
+  std::vector<int> roots;
+  for (int i = 0; i < scc_count; ++i) {
+    if (pending[i] == 0) {
+      roots.push_back(i);
     }
+  }
+  for (auto root : roots) {
+    schedule(root);
+  }
+  pool.wait();
 
-    types::Map bindings = zion::solver(false /*check_constraint_coverage*/,
-                                       make_context(INTERNAL_LOC(), "solving"),
-                                       constraints, tracked_types,
-                                       scheme_resolver, instance_requirements);
+  if (failure != nullptr) {
+    std::rethrow_exception(failure);
+  }
 
-    rebind_tracked_types(tracked_types, bindings);
-#ifdef ZION_DEBUG
-    if (debug_all_expr_types) {
-      log("Rebound Expression Types for {%s}", join(scc, ", ").c_str());
-      for (auto pair : tracked_types) {
-        log_location(pair.first->get_location(), "%s :: %s",
-                     pair.first->str().c_str(),
-                     pair.second->generalize({})->str().c_str());
-      }
-    }
-#endif
-    for (auto pair : map) {
-      auto scheme = pair.second->rebind(bindings)->generalize(
-          types::rebind(instance_requirements, bindings));
-      // NB: do not normalize the scheme
-      debug_above(1, log("resolved %s to scheme %s", pair.first.c_str(),
-                         scheme->normalize()->str().c_str()));
-      scheme_resolver.insert_scheme(pair.first, scheme);
-      // TODO: consider altering CheckedDefinition to have a type, not a scheme
-      CheckedDefinitionRef checked_definition =
-          std::make_shared<const CheckedDefinition>(
-              scheme, decl_map[pair.first], tracked_types);
+  CheckedDefinitionsByName checked_defns;
+  for (auto &checked_scc : results) {
+    for (auto &pair : checked_scc) {
+      interface_cache.insert(pair.second->decl->id.location, pair.first,
+                             pair.second->scheme);
       checked_defns.insert(
-          {pair.first, std::list<CheckedDefinitionRef>{checked_definition}});
+          {pair.first, std::list<CheckedDefinitionRef>{pair.second}});
     }
   }
 
@@ -544,6 +729,7 @@ void check_instance_for_type_class_overload(
     const types::Map &subst,
     const DataCtorsMap &data_ctors_map,
     std::set<std::string> &names_checked,
+    InterfaceCache &interface_cache,
     types::SchemeResolver &scheme_resolver,
     const types::ClassPredicates &class_predicates,
     CheckedDefinitionsByName &checked_defns) {
@@ -561,9 +747,25 @@ void check_instance_for_type_class_overload(
   types::SchemeRef expected_scheme = expected_type->generalize(
       class_predicates);
 
-  CheckedDefinitionRef checked_defn = check_decl(
-      false /*check_constraint_coverage*/, data_ctors_map, {}, source_decl->id,
-      source_decl, expected_type, scheme_resolver);
+  /* an instance may take this decl from the type class's defaults, so it is
+   * cached under the instance's module and name */
+  const Location instance_location = instance->get_location();
+  const std::string instance_decl_name = make_instance_decl_id(
+                                             instance, source_decl->id)
+                                             .name;
+  CheckedDefinitionRef checked_defn;
+  if (auto scheme = interface_cache.lookup(instance_location,
+                                           instance_decl_name)) {
+    checked_defn = std::make_shared<const CheckedDefinition>(
+        scheme, source_decl, std::make_shared<const TrackedTypes>());
+  } else {
+    checked_defn = check_decl(false /*check_constraint_coverage*/,
+                              data_ctors_map, nullptr /*instance_index*/,
+                              source_decl->id, source_decl,
+                              expected_type, scheme_resolver);
+    interface_cache.insert(instance_location, instance_decl_name,
+                           checked_defn->scheme);
+  }
   const auto &resolved_scheme = checked_defn->scheme;
   const auto &decl = checked_defn->decl;
 
@@ -601,6 +803,7 @@ void check_instance_for_type_class_overloads(
     const TypeClass *type_class,
     const DataCtorsMap &data_ctors_map,
     std::vector<const Decl *> &instance_decls,
+    InterfaceCache &interface_cache,
     types::SchemeResolver &scheme_resolver,
     CheckedDefinitionsByName &checked_defns) {
   if (instance->class_predicate->params.size() !=
@@ -628,7 +831,7 @@ void check_instance_for_type_class_overloads(
     auto type = pair.second;
     check_instance_for_type_class_overload(
         name, type, type_class, instance, subst, data_ctors_map, names_checked,
-        scheme_resolver,
+        interface_cache, scheme_resolver,
         type_class->class_predicates /*, type_class->defaults*/, checked_defns);
   }
 
@@ -649,9 +852,11 @@ void check_instances(
     const std::vector<const Instance *> &instances,
     const std::map<std::string, const TypeClass *> &type_class_map,
     const DataCtorsMap &data_ctors_map,
+    InterfaceCache &interface_cache,
     /* out */ types::SchemeResolver &scheme_resolver,
     /* out */ CheckedDefinitionsByName &checked_defns,
     /* out */ types::ClassPredicates &instance_predicates) {
+  TimeTraceScope trace("check_instances");
   std::vector<const Decl *> instance_decls;
 
   for (const Instance *instance : instances) {
@@ -673,7 +878,7 @@ void check_instances(
                              .back();
         for (auto type_class_pair : type_class_map) {
           auto type_class = type_class_pair.second;
-          if (type_class->id.name.find(leaf_name) != std::string::npos) {
+          if (type_class->id.name.str().find(leaf_name) != std::string::npos) {
             error.add_info(type_class->id.location, "did you mean %s?",
                            type_class->id.str().c_str());
           }
@@ -683,9 +888,9 @@ void check_instances(
 
       /* first put an instance requirement on any superclasses of the associated
        * type_class */
-      check_instance_for_type_class_overloads(instance, type_class,
-                                              data_ctors_map, instance_decls,
-                                              scheme_resolver, checked_defns);
+      check_instance_for_type_class_overloads(
+          instance, type_class, data_ctors_map, instance_decls,
+          interface_cache, scheme_resolver, checked_defns);
 
       debug_above(
           3, log("adding predicate %s to the set of all instance predicates",
@@ -704,7 +909,7 @@ CheckedDefinitionRef specialize_checked_defn(
     const DataCtorsMap &data_ctors_map,
     const types::SchemeResolver &scheme_resolver,
     const CheckedDefinitionsByName &checked_defns,
-    const types::ClassPredicates &instance_predicates,
+    const types::InstanceIndex &instance_index,
     const Location location,
     const std::string name,
     const types::Ref &type) {
@@ -722,9 +927,12 @@ CheckedDefinitionRef specialize_checked_defn(
   CheckedDefinitionRef checked_defn_to_specialize;
   types::Map bindings;
 
-  for (auto checked_defn : checked_defns.at(name)) {
+  for (auto &checked_defn : checked_defns.at(name)) {
     /* we have to loop over all possible overloads to ensure that only one
      * unifies */
+    if (!types::could_unify(checked_defn->scheme->type, type)) {
+      continue;
+    }
     types::Unification unification = unify(checked_defn->scheme->type, type);
     if (unification.result) {
       /* multiple overloads exist that match this name and type */
@@ -755,31 +963,35 @@ CheckedDefinitionRef specialize_checked_defn(
                           decl_type->str().c_str(), str(bindings).c_str()));
 
   return check_decl(false /*check_constraint_coverage*/, data_ctors_map,
-                    instance_predicates, checked_defn_to_specialize->decl->id,
+                    &instance_index, checked_defn_to_specialize->decl->id,
                     checked_defn_to_specialize->decl, decl_type,
                     scheme_resolver);
 }
 
+/* the phases are handed from one to the next, so they are moved rather than
+ * copied */
 struct Phase2 {
   explicit Phase2(const std::shared_ptr<Compilation const> &compilation,
                   const std::shared_ptr<types::SchemeResolver> &scheme_resolver,
-                  const CheckedDefinitionsByName &&checked_defns,
-                  const types::ClassPredicates &instance_predicates,
-                  const DataCtorsMap &data_ctors_map)
+                  CheckedDefinitionsByName &&checked_defns,
+                  types::ClassPredicates &&instance_predicates)
       : compilation(compilation), scheme_resolver(scheme_resolver),
         checked_defns(std::move(checked_defns)),
-        instance_predicates(instance_predicates),
-        data_ctors_map(data_ctors_map) {
+        instance_predicates(std::move(instance_predicates)),
+        data_ctors_map(compilation->data_ctors_map) {
   }
+  Phase2(const Phase2 &) = delete;
+  Phase2(Phase2 &&) = default;
 
-  const std::shared_ptr<Compilation const> compilation;
-  const std::shared_ptr<types::SchemeResolver> scheme_resolver;
-  const CheckedDefinitionsByName checked_defns;
-  const types::ClassPredicates instance_predicates;
-  const DataCtorsMap data_ctors_map;
+  std::shared_ptr<Compilation const> compilation;
+  std::shared_ptr<types::SchemeResolver> scheme_resolver;
+  CheckedDefinitionsByName checked_defns;
+  types::ClassPredicates instance_predicates;
+  /* owned by compilation */
+  const DataCtorsMap &data_ctors_map;
 
   std::ostream &dump(std::ostream &os) {
-    for (auto pair : checked_defns) {
+    for (auto &pair : checked_defns) {
       const std::string &name = pair.first;
       const std::list<CheckedDefinitionRef> &checked_defns_list = pair.second;
       for (auto &checked_defn : checked_defns_list) {
@@ -812,14 +1024,23 @@ std::map<std::string, int> get_builtin_arities() {
   return builtin_arities;
 }
 
-Phase2 compile(std::string user_program_name_, bool emit_graph_dot) {
+Compilation::ref parse(std::string user_program_name) {
   auto builtin_arities = get_builtin_arities();
-  auto compilation = compiler::parse_program(user_program_name_,
-                                             builtin_arities);
+  Compilation::ref compilation;
+  {
+    TimeTraceScope trace("parse_program");
+    compilation = compiler::parse_program(user_program_name, builtin_arities);
+  }
   if (compilation == nullptr) {
     exit(EXIT_FAILURE);
   }
+  record_phase("parse");
+  return compilation;
+}
 
+Phase2 compile(std::string user_program_name_,
+               Compilation::ref compilation,
+               bool emit_graph_dot) {
   const Program *program = compilation->program;
 
   auto scheme_resolver_ptr = std::make_shared<types::SchemeResolver>();
@@ -831,19 +1052,32 @@ Phase2 compile(std::string user_program_name_, bool emit_graph_dot) {
   /* initialize the scheme_resolver with type class decls */
   auto type_class_map = check_type_classes(program->type_classes,
                                            scheme_resolver);
+  /* modules that have not changed since they were last checked can reuse the
+   * schemes that were resolved then */
+  InterfaceCache interface_cache(compilation->interface_keys);
+
   /* start resolving more schemes */
   CheckedDefinitionsByName checked_defns = check_decls(
       user_program_name_, zion::tld::mktld(compilation->program_name, "main"),
-      program->decls, compilation->data_ctors_map, scheme_resolver,
-      emit_graph_dot);
+      program->decls, compilation->data_ctors_map, interface_cache,
+      scheme_resolver, emit_graph_dot);
 
   types::ClassPredicates instance_predicates;
   check_instances(program->instances, type_class_map,
-                  compilation->data_ctors_map, scheme_resolver, checked_defns,
-                  instance_predicates);
+                  compilation->data_ctors_map, interface_cache,
+                  scheme_resolver, checked_defns, instance_predicates);
+  if (!user_error::errors_occurred()) {
+    interface_cache.save();
+  }
+  record_phase("check");
 
   return Phase2{compilation, scheme_resolver_ptr, std::move(checked_defns),
-                instance_predicates, compilation->data_ctors_map};
+                std::move(instance_predicates)};
+}
+
+Phase2 compile(std::string user_program_name_, bool emit_graph_dot) {
+  return compile(user_program_name_, parse(user_program_name_),
+                 emit_graph_dot);
 }
 
 typedef std::map<std::string,
@@ -852,7 +1086,7 @@ typedef std::map<std::string,
 
 void specialize_core(const types::TypeEnv &type_env,
                      const CheckedDefinitionsByName &checked_defns,
-                     const types::ClassPredicates &instance_predicates,
+                     const types::InstanceIndex &instance_index,
                      const types::SchemeResolver &scheme_resolver,
                      const DataCtorsMap &data_ctors_map,
                      types::DefnId defn_id_to_match,
@@ -891,14 +1125,34 @@ void specialize_core(const types::TypeEnv &type_env,
     return;
   }
 
+  if (auto base_defn_id = get_hof_specialization_base(defn_id_to_match)) {
+    /* a higher-order function specialized for some known function params */
+    specialize_core(type_env, checked_defns, instance_index, scheme_resolver,
+                    data_ctors_map, *base_defn_id, translation_map,
+                    needed_defns);
+    auto base_translation = get(translation_map, base_defn_id->id.name, type,
+                                Translation::ref{});
+    if (base_translation == nullptr) {
+      throw user_error(defn_id_to_match.get_location(),
+                       "unable to specialize %s",
+                       defn_id_to_match.str().c_str());
+    }
+    translation_map[defn_id_to_match.id.name][type] =
+        translate_hof_specialization(defn_id_to_match, *base_translation);
+    return;
+  }
+
   debug_above(7, log(c_good("Specializing subprogram %s"),
                      defn_id_to_match.str().c_str()));
+  TimeTraceScope trace("specialize_core", [&defn_id_to_match]() {
+    return defn_id_to_match.str();
+  });
 
   /* start the process of specializing our decl */
   /* get the decl and its tracked types so that we can rebind them and translate
    * a new decl */
   CheckedDefinitionRef checked_defn = specialize_checked_defn(
-      data_ctors_map, scheme_resolver, checked_defns, instance_predicates,
+      data_ctors_map, scheme_resolver, checked_defns, instance_index,
       defn_id_to_match.id.location, defn_id_to_match.id.name,
       defn_id_to_match.type);
 
@@ -910,7 +1164,7 @@ void specialize_core(const types::TypeEnv &type_env,
    * instantiate */
   const auto defn_type = checked_defn->scheme->type;
   const auto &decl = checked_defn->decl;
-  const auto &tracked_types = checked_defn->tracked_types;
+  const auto &tracked_types = *checked_defn->tracked_types;
 
   const types::DefnId defn_id{defn_id_to_match.id, defn_type};
 
@@ -933,7 +1187,7 @@ void specialize_core(const types::TypeEnv &type_env,
       }
     }
 
-    std::unordered_set<std::string> bound_vars;
+    std::unordered_set<Symbol> bound_vars;
     INDENT(1, string_format("----------- specialize %s ------------",
                             defn_id.str().c_str()));
 #ifdef ZION_DEBUG
@@ -961,6 +1215,7 @@ void specialize_core(const types::TypeEnv &type_env,
     debug_above(4, log("setting %s :: %s = %s", final_name.c_str(),
                        type->str().c_str(), translated_decl->str().c_str()));
     translation_map[final_name][type] = translated_decl;
+    time_trace_add_counter("specializations", 1);
   } catch (...) {
     translation_map[defn_id.id.name].erase(type);
     throw;
@@ -972,8 +1227,8 @@ struct Phase3 {
   TranslationMap translation_map;
 
   std::ostream &dump(std::ostream &os) {
-    for (auto pair : translation_map) {
-      for (auto overloads : pair.second) {
+    for (auto &pair : translation_map) {
+      for (auto &overloads : pair.second) {
         log_location(overloads.second->expr->get_location(), "%s :: %s = %s",
                      pair.first.c_str(), overloads.first->str().c_str(),
                      overloads.second->expr->str().c_str());
@@ -983,17 +1238,18 @@ struct Phase3 {
   }
 };
 
-Phase3 specialize(const Phase2 &phase_2) {
+Phase3 specialize(Phase2 &&phase_2) {
   if (user_error::errors_occurred()) {
     throw user_error(INTERNAL_LOC(), "quitting");
   }
+  TimeTraceScope trace("specialize");
   std::string entry_point_name = zion::tld::mktld(
       phase_2.compilation->program_name, "main");
   if (phase_2.checked_defns.count(entry_point_name) == 0) {
     auto error = user_error(
         Location{phase_2.compilation->program_filename, 1, 1},
         "could not find a definition for %s", entry_point_name.c_str());
-    for (auto pair : phase_2.checked_defns) {
+    for (auto &pair : phase_2.checked_defns) {
       if (pair.first.find(entry_point_name) != std::string::npos) {
         for (auto checked_def : pair.second) {
           error.add_info(checked_def->get_location(),
@@ -1010,17 +1266,20 @@ Phase3 specialize(const Phase2 &phase_2) {
   const Decl *program_main = checked_defn_main->decl;
   types::Ref program_type = checked_defn_main->scheme->type;
 
+  reset_hof_specializations();
   types::NeededDefns needed_defns;
   types::DefnId main_defn{program_main->id, program_type};
   insert_needed_defn(needed_defns, main_defn, INTERNAL_LOC(), main_defn);
 
-  CheckedDefinitionsByName checked_defns = phase_2.checked_defns;
+  /* instances are looked up by class and head type constructor, and each
+   * predicate is only resolved once */
+  const types::InstanceIndex instance_index(phase_2.instance_predicates);
   TranslationMap translation_map;
   while (needed_defns.size() != 0) {
     auto next_defn_id = needed_defns.begin()->first;
     try {
-      specialize_core(phase_2.compilation->type_env, checked_defns,
-                      phase_2.instance_predicates, *phase_2.scheme_resolver,
+      specialize_core(phase_2.compilation->type_env, phase_2.checked_defns,
+                      instance_index, *phase_2.scheme_resolver,
                       phase_2.data_ctors_map, next_defn_id, translation_map,
                       needed_defns);
     } catch (user_error &e) {
@@ -1036,8 +1295,8 @@ Phase3 specialize(const Phase2 &phase_2) {
 
   if (debug_compiled_env) {
     INDENT(0, "--debug_compiled_env--");
-    for (auto pair : translation_map) {
-      for (auto overload : pair.second) {
+    for (auto &pair : translation_map) {
+      for (auto &overload : pair.second) {
         if (pair.first == "std.Ref") {
           assert(overload.second != nullptr);
           log_location(overload.second->get_location(), "%s :: %s = %s",
@@ -1047,33 +1306,35 @@ Phase3 specialize(const Phase2 &phase_2) {
       }
     }
   }
-  return Phase3{phase_2, translation_map};
+  record_phase("specialize");
+  return Phase3{std::move(phase_2), std::move(translation_map)};
 }
 
 struct Phase4 {
   Phase4(const Phase4 &) = delete;
-  Phase4(Phase3 phase_3,
-         gen::GenEnv &&gen_env,
-         llvm::Module *llvm_module,
-         std::string output_llvm_filename)
-      : phase_3(phase_3), gen_env(std::move(gen_env)), llvm_module(llvm_module),
-        output_llvm_filename(output_llvm_filename) {
+  Phase4(Phase3 &&phase_3, gen::GenEnv &&gen_env, llvm::Module *llvm_module)
+      : phase_3(std::move(phase_3)), gen_env(std::move(gen_env)),
+        llvm_module(llvm_module) {
   }
   Phase4(Phase4 &&rhs)
-      : phase_3(rhs.phase_3), gen_env(std::move(rhs.gen_env)),
-        llvm_module(rhs.llvm_module),
-        output_llvm_filename(rhs.output_llvm_filename) {
+      : phase_3(std::move(rhs.phase_3)), gen_env(std::move(rhs.gen_env)),
+        llvm_module(rhs.llvm_module) {
     rhs.llvm_module = nullptr;
   }
   ~Phase4() {
     delete llvm_module;
-    // FUTURE: unlink(output_llvm_filename.c_str());
   }
 
   Phase3 phase_3;
   gen::GenEnv gen_env;
   llvm::Module *llvm_module = nullptr;
-  std::string output_llvm_filename;
+
+  /* where build products for this program are written */
+  std::string get_output_filename(std::string extension) const {
+    auto temp_dir = std::string(getenv("TMPDIR") ? getenv("TMPDIR") : ".");
+    return temp_dir + "/" + phase_3.phase_2.compilation->program_name +
+           extension;
+  }
 
   std::ostream &dump(std::ostream &os) {
     return os << llvm_print_module(*llvm_module);
@@ -1089,7 +1350,7 @@ struct CodeSymbol {
 
 std::unordered_set<std::string> get_globals(const Phase3 &phase_3) {
   std::unordered_set<std::string> globals;
-  for (auto pair : phase_3.translation_map) {
+  for (auto &pair : phase_3.translation_map) {
     debug_above(7, log("adding global %s", pair.first.c_str()));
     globals.insert(pair.first);
   }
@@ -1166,12 +1427,12 @@ void write_main_block(llvm::IRBuilder<> &builder,
   builder.CreateRet(builder.getInt32(0));
 }
 
-Phase4 ssa_gen(llvm::LLVMContext &context, const Phase3 &phase_3) {
+Phase4 ssa_gen(llvm::LLVMContext &context, Phase3 &&phase_3) {
+  TimeTraceScope trace("ssa_gen");
   llvm::Module *llvm_module = new llvm::Module("program", context);
   llvm::IRBuilder<> builder(context);
 
   gen::GenEnv gen_env;
-  std::string output_filename;
 
   try {
     const std::unordered_set<std::string> globals = get_globals(phase_3);
@@ -1185,7 +1446,7 @@ Phase4 ssa_gen(llvm::LLVMContext &context, const Phase3 &phase_3) {
     debug_above(6, log("globals are %s", join(globals).c_str()));
     debug_above(2, log("type_env is %s",
                        str(phase_3.phase_2.compilation->type_env).c_str()));
-    for (auto pair : phase_3.translation_map) {
+    for (auto &pair : phase_3.translation_map) {
       for (auto &overload : pair.second) {
         const std::string &name = pair.first;
         const types::Ref &type = overload.first;
@@ -1237,12 +1498,34 @@ Phase4 ssa_gen(llvm::LLVMContext &context, const Phase3 &phase_3) {
               assert(llvm_entry_terminator);
               builder.SetInsertPoint(llvm_entry_terminator);
 
-              switch (gen::gen(
+              gen::ResolutionStatus status = gen::gen(
                   name, builder, llvm_module, nullptr /*defer_guard*/,
                   nullptr /*break_to_block*/, nullptr /*continue_to_block*/,
                   translation->expr, translation->typing,
                   phase_3.phase_2.compilation->type_env, gen_env, {}, globals,
-                  &publishable)) {
+                  &publishable);
+
+              llvm::BasicBlock *llvm_entry_block =
+                  llvm_entry_terminator->getParent();
+              if (builder.GetInsertBlock() != llvm_entry_block) {
+                /* this initializer has loops or branches in it, and finished
+                 * in a block of its own. everything ahead of the entry
+                 * terminator moves into a new block, and the initializer
+                 * falls through to the terminator, which stays put for anyone
+                 * else generating just ahead of it. */
+                llvm::BasicBlock *llvm_head_block = llvm::BasicBlock::Create(
+                    builder.getContext(), "", llvm_main_function,
+                    llvm_entry_block);
+                llvm_entry_block->replaceAllUsesWith(llvm_head_block);
+                llvm_head_block->getInstList().splice(
+                    llvm_head_block->end(), llvm_entry_block->getInstList(),
+                    llvm_entry_block->begin(),
+                    llvm_entry_terminator->getIterator());
+                builder.CreateBr(llvm_entry_block);
+                builder.SetInsertPoint(llvm_entry_terminator);
+              }
+
+              switch (status) {
               case gen::rs_resolve_again:
                 return gen::rs_resolve_again;
               case gen::rs_cache_global_load:
@@ -1305,23 +1588,62 @@ Phase4 ssa_gen(llvm::LLVMContext &context, const Phase3 &phase_3) {
     write_main_block(builder, llvm_module, gen_env, main_closure,
                      llvm_main_function);
 
-    auto temp_dir = std::string(getenv("TMPDIR") ? getenv("TMPDIR") : ".");
-    output_filename = temp_dir + "/" +
-                      phase_3.phase_2.compilation->program_name + ".ll";
-
+    TimeTraceScope verify_trace("llvm_verify_module");
     llvm_verify_module(*llvm_module);
-
-    std::ofstream ofs;
-    ofs.open(output_filename.c_str(), std::ofstream::out);
-    ofs << llvm_print_module(*llvm_module) << std::endl;
-    ofs.close();
-
   } catch (user_error &e) {
     print_exception(e);
     /* and continue */
   }
 
-  return Phase4(phase_3, std::move(gen_env), llvm_module, output_filename);
+  record_phase("gen");
+  return Phase4(std::move(phase_3), std::move(gen_env), llvm_module);
+}
+
+/* what it takes to build a program besides its own modules */
+struct LinkFlags {
+  std::string c_flags;
+  std::string lib_flags;
+  std::vector<std::string> runtime_sources;
+};
+
+/* gather the runtime sources and the compiler and library flags that the
+ * link-ins of compilation ask for */
+LinkFlags get_link_flags(const Compilation &compilation) {
+  const std::string runtime_dir = getenv("ZION_RUNTIME");
+  LinkFlags link_flags;
+  link_flags.runtime_sources.push_back(runtime_dir + "/zion_rt.c");
+  std::stringstream ss_c_flags;
+  std::stringstream ss_lib_flags;
+  for (auto link_in : compilation.link_ins) {
+    std::string link_text = unescape_json_quotes(link_in.name.text);
+    switch (link_in.lit) {
+    case lit_pkgconfig: {
+      ss_c_flags << get_pkg_config("--cflags-only-I", link_text) << " ";
+      ss_lib_flags << get_pkg_config("--libs --static", link_text) << " ";
+      break;
+    }
+    case lit_link:
+      ss_lib_flags << "-l\"" << link_text << "\" ";
+      break;
+    case lit_compile:
+      link_flags.runtime_sources.push_back(runtime_dir + "/" + link_text);
+      break;
+    }
+  }
+  link_flags.c_flags = ss_c_flags.str();
+  link_flags.lib_flags = ss_lib_flags.str();
+  return link_flags;
+}
+
+/* link the runtime that phase_4 needs into its module */
+void link_runtime(Phase4 &phase_4, const LinkFlags &link_flags) {
+  /* the runtime only needs to be compiled once per set of flags */
+  std::vector<std::string> bitcode_filenames;
+  for (auto &runtime_source : link_flags.runtime_sources) {
+    bitcode_filenames.push_back(
+        get_runtime_bitcode(runtime_source, link_flags.c_flags));
+  }
+  link_runtime(*phase_4.llvm_module, bitcode_filenames);
 }
 
 struct Job {
@@ -1330,6 +1652,21 @@ struct Job {
   std::vector<std::string> args;
 };
 
+/* the positive number that follows prefix in opt, such as the 4 in -j4 */
+int parse_count_option(const std::string &opt, const std::string &prefix) {
+  const char *value = opt.c_str() + prefix.size();
+  char *end = nullptr;
+  errno = 0;
+  long count = strtol(value, &end, 10);
+  if (end == value || *end != '\0' || errno == ERANGE || count < 1 ||
+      count > INT_MAX) {
+    throw user_error(INTERNAL_LOC(),
+                     "%s expects a whole number of at least 1, not \"%s\"",
+                     prefix.c_str(), value);
+  }
+  return count;
+}
+
 int run_job(const Job &job) {
   get_help = in_vector("-help", job.opts) || in_vector("--help", job.opts);
   debug_compiled_env = (getenv("SHOW_ENV") != nullptr) ||
@@ -1341,6 +1678,36 @@ int run_job(const Job &job) {
   debug_all_translated_defns = (getenv("SHOW_DEFN_TYPES") != nullptr) ||
                                in_vector("-show-defn-types", job.opts);
   bool graph_deps = in_vector("-graph", job.opts);
+  show_stats = in_vector("-stats", job.opts) || in_vector("--stats", job.opts);
+  int codegen_partitions = 1;
+  std::string time_trace_filename;
+  for (auto &opt : job.opts) {
+    /* -j<N> sets how many threads the compiler may use */
+    if (starts_with(opt, "-j")) {
+      set_worker_count(parse_count_option(opt, "-j"));
+    }
+    /* -codegen-partitions=<N> splits code generation into N modules */
+    if (starts_with(opt, "-codegen-partitions=")) {
+      codegen_partitions = parse_count_option(opt, "-codegen-partitions=");
+    }
+    /* --time-trace=<file> writes a profile of the compilation to file */
+    if (starts_with(opt, "--time-trace=")) {
+      time_trace_filename = opt.substr(strlen("--time-trace="));
+      start_time_trace();
+    }
+  }
+  /* the trace only covers the compiler, so it is written before the program
+   * runs */
+  auto finish_time_trace = [&] {
+    if (!time_trace_filename.empty()) {
+      write_time_trace(time_trace_filename);
+      time_trace_filename.clear();
+    }
+  };
+
+  /* everything the compiler builds for this job lives and dies together */
+  Arena arena;
+  ArenaScope arena_scope(arena);
 
   std::map<std::string, std::function<int(const Job &, bool)>> cmd_map;
   cmd_map["help"] = [&](const Job &job, bool explain) {
@@ -1358,6 +1725,10 @@ int run_job(const Job &job) {
         cmd_pair.second(job, true);
       }
     }
+    std::cout << "options:" << std::endl;
+    std::cout << "\t-j<N>: use up to N threads to compile, rather than one per "
+                 "hardware thread. N must be at least 1"
+              << std::endl;
     std::cout << "Also try looking at the manpage. man zion." << std::endl;
     return EXIT_FAILURE;
   };
@@ -1400,6 +1771,160 @@ int run_job(const Job &job) {
     test_assert(!zion::tld::is_tld_type("::copy::copy"));
     test_assert(tld::split_fqn("::inc").size() == 1);
 
+    test_assert(Location("a.zion", 1, 2) == Location("a.zion", 1, 2));
+    test_assert(Location("a.zion", 1, 2).filename() == "a.zion");
+    test_assert(!(Location("b.zion", 1, 1) < Location("a.zion", 2, 1)));
+
+    test_assert(Symbol("::std::Int") == Symbol(std::string("::std::Int")));
+    test_assert(Symbol("a") < Symbol("b") && !(Symbol("b") < Symbol("a")));
+    test_assert(Symbol("xyz").hash() == std::hash<std::string>()("xyz"));
+
+    {
+      Arena test_arena;
+      ArenaScope test_arena_scope(test_arena);
+      auto var = new Var(make_iid("x"));
+      test_assert(test_arena.bytes_allocated() >= sizeof(Var));
+      test_assert(reinterpret_cast<uintptr_t>(var) % alignof(Var) == 0);
+      test_assert(&Arena::current() == &test_arena);
+    }
+
+    {
+      /* an arena destroys the objects that new placed in it, and only those */
+      static int destroyed_count = 0;
+      struct Counted : public ArenaAllocated {
+        ~Counted() {
+          ++destroyed_count;
+        }
+      };
+      {
+        Arena test_arena;
+        ArenaScope test_arena_scope(test_arena);
+        new Counted();
+        new Counted();
+        Counted on_stack;
+      }
+      test_assert(destroyed_count == 3);
+    }
+
+    {
+      /* a module's interface key follows its transitive imports */
+      std::map<std::string, std::set<std::string>> imports{
+          {"a.zion", {"b.zion"}}, {"b.zion", {"a.zion", "c.zion"}}};
+      auto keys = get_interface_keys(
+          {{"a.zion", 1}, {"b.zion", 2}, {"c.zion", 3}, {"d.zion", 4}},
+          imports);
+      auto changed_keys = get_interface_keys(
+          {{"a.zion", 1}, {"b.zion", 2}, {"c.zion", 5}, {"d.zion", 4}},
+          imports);
+      test_assert(keys.at("a.zion") != keys.at("b.zion"));
+      test_assert(keys.at("a.zion") != changed_keys.at("a.zion"));
+      test_assert(keys.at("d.zion") == changed_keys.at("d.zion"));
+      test_assert(interface_hash("zion") == interface_hash("zion"));
+      test_assert(interface_hash("zion") != interface_hash("noiz"));
+    }
+
+    {
+      /* interfaces written to a sink are found in memory by later caches */
+      int interfaces[2];
+      test_assert(pipe(interfaces) == 0);
+      Location location{"sink.zion", 1, 1};
+      auto int_type = type_id(make_iid("Int"));
+      std::map<std::string, std::string> interface_keys{
+          {"sink.zion", "sink-key"}};
+      set_interface_sink(interfaces[1]);
+      {
+        InterfaceCache interface_cache(interface_keys);
+        interface_cache.insert(location, "sink.f", scheme({}, {}, int_type));
+        interface_cache.save();
+      }
+      set_interface_sink(-1);
+      close(interfaces[1]);
+
+      std::string text;
+      char buffer[256];
+      ssize_t count;
+      while ((count = read(interfaces[0], buffer, sizeof(buffer))) > 0) {
+        text.append(buffer, count);
+      }
+      close(interfaces[0]);
+      std::istringstream is(text);
+      remember_interfaces(is);
+
+      InterfaceCache interface_cache(interface_keys);
+      auto found = interface_cache.lookup(location, "sink.f");
+      test_assert(found != nullptr && type_equality(found->type, int_type));
+      test_assert(interface_cache.lookup(location, "sink.g") == nullptr);
+    }
+
+    {
+      /* instances are only unified against predicates with the same heads */
+      auto classname = make_iid(zion::tld::mktld("test", "Show"));
+      auto int_type = type_id(make_iid("Int"));
+      auto vector_of = [](types::Ref type) {
+        return type_operator(type_id(make_iid("Vector")), type);
+      };
+      auto a = type_variable(make_iid("a"));
+      types::ClassPredicates instances{
+          std::make_shared<types::ClassPredicate>(classname,
+                                                  types::Refs{int_type}),
+          std::make_shared<types::ClassPredicate>(
+              classname, types::Refs{vector_of(a)})};
+      types::InstanceIndex instance_index(instances);
+
+      auto b = type_variable(make_iid("b"));
+      types::ClassPredicate vector_predicate(classname,
+                                             types::Refs{vector_of(b)});
+      test_assert(instance_index.get_candidates(vector_predicate).size() == 1);
+      types::ClassPredicate open_predicate(classname, types::Refs{b});
+      test_assert(instance_index.get_candidates(open_predicate).size() == 2);
+      test_assert(types::get_head_name(vector_of(int_type)) == "Vector");
+      test_assert(types::get_head_name(b).empty());
+      test_assert(types::could_unify(vector_of(b), vector_of(int_type)));
+      test_assert(!types::could_unify(vector_of(b), int_type));
+
+      types::Map bindings;
+      test_assert(!instance_index.resolve(open_predicate, bindings));
+      types::ClassPredicate nested_predicate(
+          classname, types::Refs{vector_of(vector_of(b))});
+      test_assert(instance_index.resolve(nested_predicate, bindings));
+      test_assert(bindings.size() == 1);
+      /* remembered resolutions still refer to the predicate's variables */
+      types::Map remembered_bindings;
+      test_assert(
+          instance_index.resolve(nested_predicate, remembered_bindings));
+      test_assert(remembered_bindings.size() == 1 &&
+                  type_equality(remembered_bindings.begin()->second,
+                                vector_of(b)));
+      /* and so do resolutions remembered for another predicate that only
+       * differs by the names of its type variables */
+      auto c = type_variable(make_iid("c"));
+      types::ClassPredicate renamed_predicate(
+          classname, types::Refs{vector_of(vector_of(c))});
+      types::Map renamed_bindings;
+      test_assert(instance_index.resolve(renamed_predicate, renamed_bindings));
+      test_assert(renamed_bindings.size() == 1 &&
+                  type_equality(renamed_bindings.begin()->second,
+                                vector_of(c)));
+    }
+
+    {
+      /* eviction removes the least recently used files first */
+      char dir_template[] = "/tmp/zion-evict.XXXXXX";
+      std::string dir = mkdtemp(dir_template);
+      for (int i = 0; i < 3; ++i) {
+        std::string filename = string_format("%s/%d", dir.c_str(), i);
+        std::ofstream(filename) << std::string(100, 'x');
+        timeval times[2] = {{1000 + i, 0}, {1000 + i, 0}};
+        test_assert(utimes(filename.c_str(), times) == 0);
+      }
+      evict_least_recently_used(dir, 250);
+      test_assert(!file_exists(dir + "/0"));
+      test_assert(file_exists(dir + "/1") && file_exists(dir + "/2"));
+      evict_least_recently_used(dir, 0);
+      test_assert(!file_exists(dir + "/1") && !file_exists(dir + "/2"));
+      test_assert(rmdir(dir.c_str()) == 0);
+    }
+
     return EXIT_SUCCESS;
   };
   cmd_map["find"] = [&](const Job &job, bool explain) {
@@ -1426,9 +1951,8 @@ int run_job(const Job &job) {
 
     std::string filename = compiler::resolve_module_filename(
         INTERNAL_LOC(), job.args[0], ".zion");
-    std::ifstream ifs;
-    ifs.open(filename.c_str());
-    Lexer lexer({filename}, ifs);
+    MappedFile source(filename);
+    Lexer lexer({filename}, source.view());
     Token token;
     bool newline = false;
     while (lexer.get_token(token, newline, nullptr)) {
@@ -1516,9 +2040,19 @@ int run_job(const Job &job) {
       llvm::LLVMContext context;
       Phase4 phase_4 = ssa_gen(context,
                                specialize(compile(job.args[0], graph_deps)));
+      if (user_error::errors_occurred()) {
+        return EXIT_FAILURE;
+      }
 
-      std::cout << phase_4.output_llvm_filename << std::endl;
-      return user_error::errors_occurred() ? EXIT_FAILURE : EXIT_SUCCESS;
+      /* textual IR is only written out on request */
+      auto output_filename = phase_4.get_output_filename(".ll");
+      std::ofstream ofs;
+      ofs.open(output_filename.c_str(), std::ofstream::out);
+      ofs << llvm_print_module(*phase_4.llvm_module) << std::endl;
+      ofs.close();
+
+      std::cout << output_filename << std::endl;
+      return EXIT_SUCCESS;
     }
   };
   cmd_map["run"] = [&](const Job &job, bool explain) {
@@ -1529,91 +2063,184 @@ int run_job(const Job &job) {
       return EXIT_FAILURE;
     }
 
+    auto compilation = parse(job.args[0]);
+    const std::string executable = compilation->program_name;
+    const LinkFlags link_flags = get_link_flags(*compilation);
+
+    /* a program whose inputs have not changed since it was last built can be
+     * run without compiling it again, unless the compiler was asked to show
+     * its work */
+    std::string build_key;
+    if (!graph_deps && !debug_compiled_env && !debug_types &&
+        !debug_all_expr_types && !debug_all_translated_defns && !show_stats) {
+      build_key = get_build_key(*compilation, link_flags.c_flags,
+                                link_flags.lib_flags,
+                                link_flags.runtime_sources);
+    }
+    if (!build_key.empty() && restore_build(build_key, executable)) {
+      record_phase("build cache");
+      finish_time_trace();
+      return run_program(executable, vec_slice(job.args, 1, job.args.size()));
+    }
+
+    /* a cached build would not repeat what compiling it logged */
+    const int log_count = get_log_count();
     llvm::LLVMContext context;
-    Phase4 phase_4 = ssa_gen(context,
-                             specialize(compile(job.args[0], graph_deps)));
+    Phase4 phase_4 = ssa_gen(
+        context, specialize(compile(job.args[0], compilation, graph_deps)));
 
     if (!user_error::errors_occurred()) {
-      std::stringstream ss_c_flags;
-      std::stringstream ss_compilands;
-      std::stringstream ss_lib_flags;
-      ss_compilands << "\"$ZION_RUNTIME/zion_rt.c\" ";
-      for (auto link_in : phase_4.phase_3.phase_2.compilation->link_ins) {
-        std::string link_text = unescape_json_quotes(link_in.name.text);
-        switch (link_in.lit) {
-        case lit_pkgconfig: {
-          ss_c_flags << get_pkg_config("--cflags-only-I", link_text) << " ";
-          ss_lib_flags << get_pkg_config("--libs --static", link_text) << " ";
-          break;
-        }
-        case lit_link:
-          ss_lib_flags << "-l\"" << link_text << "\" ";
-          break;
-        case lit_compile:
-          ss_compilands << "\"$ZION_RUNTIME/" << link_text << "\" ";
-          break;
-        }
+      link_runtime(phase_4, link_flags);
+
+      /* lower the module straight to object files in process */
+      std::stringstream ss_objects;
+      for (auto &object_filename :
+           emit_object_files(*phase_4.llvm_module,
+                             phase_4.get_output_filename(""),
+                             codegen_partitions)) {
+        ss_objects << "\"" << object_filename << "\" ";
       }
 
       auto command_line = string_format(
-          // We are using clang to lower the code from LLVM, and link it
-          // to the runtime.
-#ifdef __APPLE__
-          "\"$(brew --prefix)/opt/llvm/bin/clang\" "
-#else
-          "clang "
-#endif
-          // Include any necessary include dirs for C dependencies.
+          // We are only using clang to link the program to its libraries.
           "%s "
-#ifdef __APPLE__
-          "-I \"$(xcrun --sdk macosx --show-sdk-path)/usr/include\" "
-#endif
-          // Allow for the user to specify optimizations
-          "$ZION_OPT_FLAGS "
-          // NB: we don't embed the target triple into the LL, so any
-          // targeted triple causes an ugly error from clang, so I just
-          // ignore it here.
-          "-Wno-override-module "
-          // HACKHACK: temporary workaround to allow libsodium to compile
-          "-Wno-nullability-completeness "
-          // TODO: plumb host targeting through clang here
-          // "--target=$(llvm-config --host-target) "
-          // Include extra compilands
+          // Allow for the user to specify link-time optimizations
+          "%s "
+          // Include the program, which has the runtime linked into it.
           "%s "
           // Add linker flags
           "-lm %s "
-          // Don't forget the built .ll file from our frontend here.
-          "%s "
           // Give the binary a name.
           "-o %s",
-          ss_c_flags.str().c_str(), ss_compilands.str().c_str(),
-          ss_lib_flags.str().c_str(), phase_4.output_llvm_filename.c_str(),
-          phase_4.phase_3.phase_2.compilation->program_name.c_str(),
-          phase_4.phase_3.phase_2.compilation->program_name.c_str());
+          get_clang().c_str(), get_opt_flags(), ss_objects.str().c_str(),
+          link_flags.lib_flags.c_str(), executable.c_str());
       if (debug_compile_step) {
         log("running %s", command_line.c_str());
       }
-      if (std::system(command_line.c_str()) != 0) {
-        throw user_error(INTERNAL_LOC(), "failed to compile binary");
+      {
+        TimeTraceScope trace("clang", command_line);
+        if (std::system(command_line.c_str()) != 0) {
+          throw user_error(INTERNAL_LOC(), "failed to link binary");
+        }
+      }
+      if (!build_key.empty() && get_log_count() == log_count) {
+        save_build(build_key, executable);
       }
 
-      return run_program(phase_4.phase_3.phase_2.compilation->program_name,
-                         vec_slice(job.args, 1, job.args.size()));
+      finish_time_trace();
+      return run_program(executable, vec_slice(job.args, 1, job.args.size()));
     } else {
       return EXIT_FAILURE;
     }
   };
 
+  cmd_map["jit"] = [&](const Job &job, bool explain) {
+    if (explain) {
+      std::cout << "jit: compiles, specializes, generates LLVM output, then "
+                   "runs it in process without writing a binary"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (job.args.size() < 1) {
+      return run_job({"help", {}});
+    }
+
+    auto context = std::make_unique<llvm::LLVMContext>();
+    std::unique_ptr<llvm::Module> llvm_module;
+    LinkFlags link_flags;
+    {
+      Phase4 phase_4 = ssa_gen(*context,
+                               specialize(compile(job.args[0], graph_deps)));
+      if (user_error::errors_occurred()) {
+        return EXIT_FAILURE;
+      }
+      link_flags = get_link_flags(*phase_4.phase_3.phase_2.compilation);
+      link_runtime(phase_4, link_flags);
+
+      /* the JIT takes ownership of the module */
+      llvm_module.reset(phase_4.llvm_module);
+      phase_4.llvm_module = nullptr;
+    }
+
+    finish_time_trace();
+    return jit_program(std::move(context), std::move(llvm_module),
+                       link_flags.lib_flags, job.args);
+  };
+
+  cmd_map["cache"] = [&](const Job &job, bool explain) {
+    if (explain) {
+      std::cout << "cache: shows what is in $ZION_CACHE (stats) or removes it "
+                   "(clear)"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (job.args.size() != 1 ||
+        (job.args[0] != "stats" && job.args[0] != "clear")) {
+      return run_job({"help", {}});
+    }
+
+    auto stats = get_build_cache_stats();
+    if (stats.cache_dir.empty()) {
+      log(log_error, "ZION_CACHE is not set, so nothing is cached");
+      return EXIT_FAILURE;
+    }
+    if (job.args[0] == "clear") {
+      clear_build_cache();
+      return EXIT_SUCCESS;
+    }
+
+    const std::uintmax_t kb = 1024;
+    std::cout << "cache: " << stats.cache_dir << std::endl;
+    std::cout << "executables: " << stats.executables << " ("
+              << stats.executable_bytes / kb << " KB of "
+              << stats.max_executable_bytes / kb << " KB)" << std::endl;
+    std::cout << "executable hits: " << stats.hits
+              << ", misses: " << stats.misses << std::endl;
+    std::cout << "interfaces: " << stats.interfaces << " ("
+              << stats.interface_bytes / kb << " KB)" << std::endl;
+    std::cout << "runtime bitcode: " << stats.bitcode_files << " ("
+              << stats.bitcode_bytes / kb << " KB)" << std::endl;
+    return EXIT_SUCCESS;
+  };
+
+  cmd_map["server"] = [&](const Job &job, bool explain) {
+    if (explain) {
+      std::cout << "server: runs the commands of clients that set ZION_SERVER "
+                   "to the given socket, keeping checked modules in memory "
+                   "between them"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::string socket_path;
+    if (job.args.size() == 1) {
+      socket_path = job.args[0];
+    } else if (job.args.empty() && getenv("ZION_SERVER") != nullptr) {
+      socket_path = getenv("ZION_SERVER");
+    } else {
+      return run_job({"help", {}});
+    }
+
+    /* each request is run in a child that has the client's environment */
+    return run_server(socket_path, run_command_line);
+  };
+
+  int result;
   if (!in(job.cmd, cmd_map)) {
     Job new_job;
     new_job.args.insert(new_job.args.begin(), job.cmd);
     std::copy(job.args.begin(), job.args.end(),
               std::back_inserter(new_job.args));
     new_job.cmd = "run";
-    return cmd_map["run"](new_job, false /*explain*/);
+    result = cmd_map["run"](new_job, false /*explain*/);
   } else {
-    return cmd_map[job.cmd](job, get_help);
+    result = cmd_map[job.cmd](job, get_help);
   }
+
+  if (show_stats) {
+    print_stats();
+  }
+  finish_time_trace();
+  return result;
 }
 
 } // namespace zion
@@ -1649,23 +2276,19 @@ void setup_environment_variables() {
   ss << getenv("ZION_ROOT") << "/runtime";
   setenv("ZION_RUNTIME", ss.str().c_str(), false /*overwrite*/);
 }
-} // namespace
 
-int main(int argc, char *argv[]) {
+int run_command_line(const std::vector<std::string> &argv) {
   setup_environment_variables();
   init_dbg();
-  zion::init_host();
-  std::shared_ptr<logger> logger(std::make_shared<standard_logger>("", "."));
 
   zion::Job job;
-  if (1 < argc) {
-    int index = 1;
-    job.cmd = argv[index++];
-    while (index < argc) {
+  if (!argv.empty()) {
+    job.cmd = argv[0];
+    for (std::size_t index = 1; index < argv.size(); ++index) {
       if (starts_with(argv[index], "-")) {
-        job.opts.push_back(argv[index++]);
+        job.opts.push_back(argv[index]);
       } else {
-        job.args.push_back(argv[index++]);
+        job.args.push_back(argv[index]);
       }
     }
   } else {
@@ -1680,3 +2303,21 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 }
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+
+  /* with ZION_SERVER set, a running `zion server` does the work */
+  const char *zion_server = getenv("ZION_SERVER");
+  int exit_code;
+  if (zion_server != nullptr && zion_server[0] != '\0' &&
+      (args.empty() || args[0] != "server") &&
+      zion::forward_to_server(zion_server, args, exit_code)) {
+    return exit_code;
+  }
+
+  zion::init_host();
+  std::shared_ptr<logger> logger(std::make_shared<standard_logger>("", "."));
+  return run_command_line(args);
+}
@@ -545,7 +545,8 @@ void difference(Pattern::ref lhs,
 
   if (lhs_allof) {
     if (rhs_allof) {
-      if (lhs_allof->type->repr() == rhs_allof->type->repr()) {
+      if (lhs_allof->type->get_signature() ==
+          rhs_allof->type->get_signature()) {
         /* subtracting an entire type from itself */
         send(theNothing);
         return;
@@ -18,8 +18,8 @@ typedef std::map<std::string, std::map<Identifier, Identifier>> SymbolExports;
 typedef std::map<std::string, std::map<std::string, std::set<Identifier>>>
     SymbolImports;
 
-typedef std::map<std::string, types::Map> ParsedDataCtorsMap;
-typedef std::unordered_map<std::string, int> ParsedCtorIdMap;
+typedef std::unordered_map<Symbol, types::Map> ParsedDataCtorsMap;
+typedef std::unordered_map<Symbol, int> ParsedCtorIdMap;
 
 struct ParseState {
   typedef LogLevel ParseError_level;
@@ -1,6 +1,7 @@
 #include "parser.h"
 
 #include <csignal>
+#include <functional>
 #include <iostream>
 #include <stdlib.h>
 #include <string>
@@ -121,25 +122,16 @@ const Expr *parse_return_statement(ParseState &ps) {
           : unit_expr(INTERNAL_LOC()));
 }
 
-const Expr *parse_for_block(ParseState &ps) {
-  chomp_ident(K(for));
-
-  bool filtered_matching = ps.token.is_ident(K(match));
-  if (filtered_matching) {
-    ps.advance();
-  }
-
-  BoundVarLifetimeTracker bvlt(ps);
-  const Predicate *for_var_predicate = parse_predicate(
-      ps, false /* allow_else */, maybe<Identifier>(), true /*allow_var_refs*/);
-
-  auto in_token = ps.token;
-  chomp_ident(K(in));
-
-  const Expr *iterable = bvlt.escaped_parse_expr(
-      false /*allow_for_comprehensions*/);
-  const Expr *block = parse_block(ps, false /*expression_means_return*/);
-
+/* `for predicate in iterable block` calls the iterator closure that
+ * iter(iterable) returns until it returns Nothing, and runs block for each
+ * item that matches predicate. unless filtered_matching is set, every item
+ * must match. */
+const Expr *build_for_loop(ParseState &ps,
+                           Location in_location,
+                           const Predicate *for_var_predicate,
+                           const Expr *iterable,
+                           const Expr *block,
+                           bool filtered_matching) {
   auto iterator_id = Identifier{fresh(), for_var_predicate->get_location()};
   PatternBlocks pattern_blocks;
   pattern_blocks.push_back(new PatternBlock(
@@ -158,7 +150,7 @@ const Expr *parse_for_block(ParseState &ps) {
                 Identifier{fresh(), iterator_id.location})},
             ps.id_mapped(Identifier{"Just", iterator_id.location}),
             maybe<Identifier>()),
-        new Continue(in_token.location)));
+        new Continue(in_location)));
   }
 
   pattern_blocks.push_back(new PatternBlock(
@@ -166,19 +158,40 @@ const Expr *parse_for_block(ParseState &ps) {
           iterator_id.location, {},
           ps.id_mapped(Identifier{"Nothing", iterator_id.location}),
           maybe<Identifier>()),
-      new Break(in_token.location)));
+      new Break(in_location)));
 
   return new Let(
       iterator_id,
-      new Application(
-          new Var(ps.id_mapped(Identifier{"iter", in_token.location})),
-          {iterable}),
-      new While(new Var(ps.id_mapped(Identifier{"True", in_token.location})),
+      new Application(new Var(ps.id_mapped(Identifier{"iter", in_location})),
+                      {iterable}),
+      new While(new Var(ps.id_mapped(Identifier{"True", in_location})),
                 new Match(new Application(new Var(iterator_id),
                                           {unit_expr(iterator_id.location)}),
                           pattern_blocks)));
 }
 
+const Expr *parse_for_block(ParseState &ps) {
+  chomp_ident(K(for));
+
+  bool filtered_matching = ps.token.is_ident(K(match));
+  if (filtered_matching) {
+    ps.advance();
+  }
+
+  BoundVarLifetimeTracker bvlt(ps);
+  const Predicate *for_var_predicate = parse_predicate(
+      ps, false /* allow_else */, maybe<Identifier>(), true /*allow_var_refs*/);
+
+  auto in_token = ps.token;
+  chomp_ident(K(in));
+
+  const Expr *iterable = bvlt.escaped_parse_expr(
+      false /*allow_for_comprehensions*/);
+  const Expr *block = parse_block(ps, false /*expression_means_return*/);
+  return build_for_loop(ps, in_token.location, for_var_predicate, iterable,
+                        block, filtered_matching);
+}
+
 const Expr *parse_new_expr(ParseState &ps) {
   ps.advance();
   return new As(new Application(new Var(ps.id_mapped(Identifier{
@@ -465,7 +478,7 @@ const Expr *parse_var_ref(ParseState &ps) {
     /* special case: inject the current filename as a raw string */
     auto token = ps.token_and_advance();
     return new Literal(Token{token.location, tk_string,
-                             escape_json_quotes(token.location.filename)});
+                             escape_json_quotes(token.location.filename())});
   } else if (in(ps.token.text, ps.builtin_arities)) {
     /* special case: this is a __builtin */
     RawParseMode rpm(ps);
@@ -575,40 +588,50 @@ const Expr *parse_base_expr(ParseState &ps) {
   }
 }
 
+/* a new, empty collection of the given type */
+const Expr *new_collection(Location location, types::Ref type) {
+  return new As(new Application(new Var(Identifier{
+                                    tld::mktld(GLOBAL_SCOPE_NAME, "new"),
+                                    location}),
+                                {unit_expr(location)}),
+                type, false /*force_cast*/);
+}
+
 const Expr *build_array_literal(Location location,
                                 const std::vector<const Expr *> &exprs) {
-  auto array_var = new Var(Identifier(fresh(), location));
-
-  /* take all the exprs from the array, and turn them into statements to fill
-   * out a vector */
-  std::vector<const Expr *> stmts;
-
-  if (exprs.size() != 0) {
-    /* we know how many items we'll need space for, so we might as well reserve
-     * that space ahead of time */
-    stmts.push_back(new Application(
-        new Var(Identifier{tld::mktld("std", "reserve"), location}),
-        {new Var(array_var->id),
-         new Literal(
-             Token{location, tk_integer, std::to_string(exprs.size())})}));
+  if (exprs.size() == 0) {
+    return new_collection(location, type_vector_type(type_variable(location)));
   }
 
-  for (auto expr : exprs) {
-    stmts.push_back(new Application(
-        new Var(Identifier{tld::mktld("std", "append"), expr->get_location()}),
-        {array_var, expr}));
-  }
+  /* we know exactly how many items there are, so store them straight into an
+   * array of that size, and then hand the array to a new vector */
+  Identifier array_id{fresh(), location};
+  auto integer = [location](std::size_t value) {
+    return new Literal(Token{location, tk_integer, std::to_string(value)});
+  };
+  auto ref = [location](const Expr *value) {
+    return new Application(new Var(Identifier{REF_TYPE_OPERATOR, location}),
+                           {value});
+  };
 
-  /* now, add another item just for the actual array value to be returned */
-  stmts.push_back(array_var);
+  std::vector<const Expr *> stmts;
+  for (std::size_t i = 0; i < exprs.size(); ++i) {
+    Location expr_location = exprs[i]->get_location();
+    stmts.push_back(new Builtin(
+        new Var(Identifier{"__builtin_store_ptr", expr_location}),
+        {new Builtin(new Var(Identifier{"__builtin_ptr_add", expr_location}),
+                     {new Var(array_id), integer(i)}),
+         exprs[i]}));
+  }
+  stmts.push_back(new Application(
+      new Var(Identifier{VECTOR_TYPE, location}),
+      {ref(new Var(array_id)), ref(integer(exprs.size())),
+       ref(integer(exprs.size()))}));
 
   return new Let(
-      array_var->id,
-      new As(
-          new Application(new Var(Identifier{
-                              tld::mktld(GLOBAL_SCOPE_NAME, "new"), location}),
-                          {unit_expr(location)}),
-          type_vector_type(type_variable(location)), false /*force_cast*/),
+      array_id,
+      new Application(new Var(Identifier{tld::mktld("std", "alloc"), location}),
+                      {integer(exprs.size())}),
       new Block(stmts));
 }
 
@@ -727,6 +750,57 @@ const Expr *parse_generator(ParseState &ps, const Expr *expr) {
   return build_generator(expr->get_location(), expr, generator_for);
 }
 
+/* [expr for predicate in iterable if condition] and the set and map
+ * comprehensions expand to a for loop that adds each item to collection with
+ * add_item, which is given the collection. when there is no condition,
+ * the collection first reserves room for every item of an iterable whose
+ * length is known. */
+const Expr *build_comprehension(
+    ParseState &ps,
+    const GeneratorFor &generator_for,
+    const Expr *collection,
+    const std::function<const Expr *(const Expr *collection)> &add_item,
+    bool reserve) {
+  Location location = generator_for.iterable->get_location();
+  Identifier iterable_id{fresh(), location};
+  Identifier collection_id{fresh(), location};
+
+  const Expr *item = add_item(new Var(collection_id));
+  if (generator_for.condition != nullptr) {
+    item = new Conditional(generator_for.condition, item,
+                           unit_expr(location));
+  }
+
+  std::vector<const Expr *> stmts;
+  if (reserve && generator_for.condition == nullptr) {
+    stmts.push_back(new Builtin(
+        new Var(Identifier{"__builtin_reserve_for", location}),
+        {new Var(collection_id), new Var(iterable_id)}));
+  }
+  stmts.push_back(build_for_loop(ps, location, generator_for.predicate,
+                                 new Var(iterable_id), new Block({item}),
+                                 false /*filtered_matching*/));
+  stmts.push_back(new Var(collection_id));
+
+  return new Let(iterable_id, generator_for.iterable,
+                 new Let(collection_id, collection, new Block(stmts)));
+}
+
+const Expr *parse_comprehension(
+    ParseState &ps,
+    const Expr *collection,
+    const std::function<const Expr *(const Expr *collection)> &add_item,
+    bool reserve) {
+  BoundVarLifetimeTracker bvlt(ps);
+  GeneratorFor generator_for = parse_generator_for(ps);
+  if (ps.token.is_ident(K(for))) {
+    throw user_error(ps.token.location,
+                     "nested comprehensions are not legal in Zion");
+  }
+  return build_comprehension(ps, generator_for, collection, add_item,
+                             reserve);
+}
+
 const Expr *parse_array_literal(ParseState &ps) {
   Location location = ps.token.location;
   chomp_token(tk_lsquare);
@@ -787,9 +861,17 @@ const Expr *parse_array_literal(ParseState &ps) {
       ps.advance();
     } else if (ps.token.is_ident(K(for))) {
       if (i == 1) {
-        const Expr *list_comprehension = new Application(
-            new Var(Identifier{tld::mktld("std", "vector"), location}),
-            {parse_generator(ps, exprs[0])});
+        const Expr *expr = exprs[0];
+        const Expr *list_comprehension = parse_comprehension(
+            ps,
+            new_collection(location, type_vector_type(type_variable(location))),
+            [expr](const Expr *vector) {
+              return new Application(
+                  new Var(Identifier{tld::mktld("std", "append"),
+                                     expr->get_location()}),
+                  {vector, expr});
+            },
+            true /*reserve*/);
         chomp_token(tk_rsquare);
         return list_comprehension;
 
@@ -1010,7 +1092,6 @@ const Expr *parse_associative_array_literal(ParseState &ps) {
     ++i;
 
     const Expr *lhs = parse_expr(ps, false /*allow_for_comprehensions*/);
-    auto prior_token = ps.token;
     if (ps.token.tk == tk_colon) {
       if (is_set) {
         throw user_error(ps.token.location,
@@ -1036,23 +1117,37 @@ const Expr *parse_associative_array_literal(ParseState &ps) {
     if (i == 1 && ps.token.is_ident(K(for))) {
       assert(exprs.size() == 1);
       /* this is a dictionary or set comprehension */
+      const Expr *key = exprs[0].first;
+      const Expr *value = exprs[0].second;
+      Location location = start_curly_token.location;
+      const Expr *ret = nullptr;
       if (is_set) {
-        const Expr *ret = new Application(
-            new Var(Identifier{tld::mktld("set", "set"),
-                               exprs[0].first->get_location()}),
-            {parse_generator(ps, exprs[0].first)});
-        chomp_token(tk_rcurly);
-        return ret;
+        ret = parse_comprehension(
+            ps,
+            new_collection(location, type_set_type(type_variable(location))),
+            [key](const Expr *set) {
+              return new Application(
+                  new Var(Identifier{tld::mktld("std", "insert"),
+                                     key->get_location()}),
+                  {set, key});
+            },
+            false /*reserve*/);
       } else {
-        const Expr *ret = new Application(
-            new Var(Identifier{tld::mktld("map", "from_pairs"),
-                               exprs[0].first->get_location()}),
-            {parse_generator(ps,
-                             new Tuple(prior_token.location,
-                                       {exprs[0].first, exprs[0].second}))});
-        chomp_token(tk_rcurly);
-        return ret;
+        ret = parse_comprehension(
+            ps,
+            new_collection(location,
+                           type_map_type(type_variable(location),
+                                         type_variable(location))),
+            [key, value](const Expr *map) {
+              return new Application(
+                  new Var(Identifier{tld::mktld("std", "set_indexed_item"),
+                                     key->get_location()}),
+                  {map, key, value});
+            },
+            false /*reserve*/);
       }
+      chomp_token(tk_rcurly);
+      return ret;
     }
   }
 
@@ -1121,7 +1216,6 @@ const Expr *parse_application(ParseState &ps,
                               const Expr *expr,
                               std::vector<const Expr *> args) {
   /* function call or implicit partial application (implicit lambda) */
-  auto location = ps.token.location;
   ps.advance();
   if (ps.token.tk == tk_rparen) {
     ps.advance();
@@ -18,7 +18,7 @@ const Expr *build_patterns(const types::DefnId &for_defn_id,
                            const PatternBlocks &pattern_blocks,
                            int index,
                            const DataCtorsMap &data_ctors_map,
-                           const std::unordered_set<std::string> &bound_vars_,
+                           const std::unordered_set<Symbol> &bound_vars_,
                            const TrackedTypes &tracked_types,
                            const types::TypeEnv &type_env,
                            TrackedTypes &typing,
@@ -58,7 +58,7 @@ const Expr *build_patterns(const types::DefnId &for_defn_id,
             typing, needed_defns, returns,
             [&for_defn_id, &pattern_block](
                 const DataCtorsMap &data_ctors_map,
-                const std::unordered_set<std::string> &bound_vars,
+                const std::unordered_set<Symbol> &bound_vars,
                 const TrackedTypes &tracked_types,
                 const types::TypeEnv &type_env, TrackedTypes &typing,
                 types::NeededDefns &needed_defns,
@@ -72,7 +72,7 @@ const Expr *build_patterns(const types::DefnId &for_defn_id,
             [index, &pattern_blocks, &for_defn_id, &scrutinee_id,
              &scrutinee_type, &expected_type](
                 const DataCtorsMap &data_ctors_map,
-                const std::unordered_set<std::string> &bound_vars,
+                const std::unordered_set<Symbol> &bound_vars,
                 const TrackedTypes &tracked_types,
                 const types::TypeEnv &type_env, TrackedTypes &typing,
                 types::NeededDefns &needed_defns,
@@ -135,7 +135,7 @@ const Expr *translate_match_expr(
     const types::DefnId &for_defn_id,
     const ast::Match *match,
     const DataCtorsMap &data_ctors_map,
-    const std::unordered_set<std::string> &bound_vars,
+    const std::unordered_set<Symbol> &bound_vars,
     const TrackedTypes &tracked_types,
     const types::TypeEnv &type_env,
     TrackedTypes &typing,
@@ -172,7 +172,7 @@ const Expr *translate_match_expr(
 }
 
 void Literal::get_bound_vars(
-    std::unordered_set<std::string> &bound_vars) const {
+    std::unordered_set<Symbol> &bound_vars) const {
 }
 
 const Expr *Literal::translate(
@@ -181,7 +181,7 @@ const Expr *Literal::translate(
     const types::Ref &scrutinee_type,
     bool do_checks,
     const DataCtorsMap &data_ctors_map,
-    const std::unordered_set<std::string> &bound_vars,
+    const std::unordered_set<Symbol> &bound_vars,
     const TrackedTypes &tracked_types,
     const types::TypeEnv &type_env,
     TrackedTypes &typing,
@@ -236,7 +236,7 @@ const Expr *translate_next(const types::DefnId &for_defn_id,
                            const types::Refs &param_types,
                            bool do_checks,
                            const DataCtorsMap &data_ctors_map,
-                           const std::unordered_set<std::string> &bound_vars_,
+                           const std::unordered_set<Symbol> &bound_vars_,
                            const TrackedTypes &tracked_types,
                            const std::vector<const Predicate *> &params,
                            int param_index,
@@ -255,7 +255,7 @@ const Expr *translate_next(const types::DefnId &for_defn_id,
   auto matching = [&for_defn_id, param_index, dim_offset, &matched, &failed,
                    &params, &scrutinee_id, &scrutinee_type, &param_types,
                    do_checks](const DataCtorsMap &data_ctors_map,
-                              const std::unordered_set<std::string> &bound_vars,
+                              const std::unordered_set<Symbol> &bound_vars,
                               const TrackedTypes &tracked_types,
                               const types::TypeEnv &type_env,
                               TrackedTypes &typing,
@@ -305,7 +305,7 @@ const Expr *translate_next(const types::DefnId &for_defn_id,
 }
 
 void CtorPredicate::get_bound_vars(
-    std::unordered_set<std::string> &bound_vars) const {
+    std::unordered_set<Symbol> &bound_vars) const {
   if (name_assignment.valid) {
     bound_vars.insert(name_assignment.t.name);
   }
@@ -320,7 +320,7 @@ const Expr *CtorPredicate::translate(
     const types::Ref &scrutinee_type,
     bool do_checks,
     const DataCtorsMap &data_ctors_map,
-    const std::unordered_set<std::string> &bound_vars,
+    const std::unordered_set<Symbol> &bound_vars,
     const TrackedTypes &tracked_types,
     const types::TypeEnv &type_env,
     TrackedTypes &typing,
@@ -467,7 +467,7 @@ const Expr *CtorPredicate::translate(
 }
 
 void TuplePredicate::get_bound_vars(
-    std::unordered_set<std::string> &bound_vars) const {
+    std::unordered_set<Symbol> &bound_vars) const {
   if (name_assignment.valid) {
     bound_vars.insert(name_assignment.t.name);
   }
@@ -482,7 +482,7 @@ const Expr *TuplePredicate::translate(
     const types::Ref &scrutinee_type,
     bool do_checks,
     const DataCtorsMap &data_ctors_map,
-    const std::unordered_set<std::string> &bound_vars,
+    const std::unordered_set<Symbol> &bound_vars,
     const TrackedTypes &tracked_types,
     const types::TypeEnv &type_env,
     TrackedTypes &typing,
@@ -503,7 +503,7 @@ const Expr *TuplePredicate::translate(
 }
 
 void IrrefutablePredicate::get_bound_vars(
-    std::unordered_set<std::string> &bound_vars) const {
+    std::unordered_set<Symbol> &bound_vars) const {
   if (name_assignment.valid) {
     bound_vars.insert(name_assignment.t.name);
   }
@@ -515,7 +515,7 @@ const Expr *IrrefutablePredicate::translate(
     const types::Ref &scrutinee_type,
     bool do_checks,
     const DataCtorsMap &data_ctors_map,
-    const std::unordered_set<std::string> &bound_vars,
+    const std::unordered_set<Symbol> &bound_vars,
     const TrackedTypes &tracked_types,
     const types::TypeEnv &type_env,
     TrackedTypes &typing,
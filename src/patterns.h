@@ -13,16 +13,40 @@ const ast::Expr *translate_match_expr(
     const types::DefnId &for_defn_id,
     const ast::Match *match,
     const DataCtorsMap &data_ctors_map,
-    const std::unordered_set<std::string> &bound_vars,
+    const std::unordered_set<Symbol> &bound_vars,
     const TrackedTypes &tracked_types,
     const types::TypeEnv &type_env,
     TrackedTypes &typing,
     types::NeededDefns &needed_defns,
     bool &returns);
 
+/* translate pattern_blocks from index onwards into a chain of conditionals
+ * over the value bound to scrutinee_id */
+const ast::Expr *build_patterns(const types::DefnId &for_defn_id,
+                                const ast::PatternBlocks &pattern_blocks,
+                                int index,
+                                const DataCtorsMap &data_ctors_map,
+                                const std::unordered_set<Symbol> &bound_vars,
+                                const TrackedTypes &tracked_types,
+                                const types::TypeEnv &type_env,
+                                TrackedTypes &typing,
+                                types::NeededDefns &needed_defns,
+                                bool &returns,
+                                Identifier scrutinee_id,
+                                types::Ref scrutinee_type,
+                                types::Ref expected_type);
+
+/* throw a user_error unless pattern_blocks cover every value of
+ * pattern_value_type exactly once */
+void check_patterns(Location location,
+                    std::string expr,
+                    const DataCtorsMap &data_ctors_map,
+                    const ast::PatternBlocks &pattern_blocks,
+                    types::Ref pattern_value_type);
+
 typedef const std::function<const ast::Expr *(
     const DataCtorsMap &data_ctors_map,
-    const std::unordered_set<std::string> &bound_vars,
+    const std::unordered_set<Symbol> &bound_vars,
     const TrackedTypes &tracked_types,
     const types::TypeEnv &type_env,
     TrackedTypes &typing,
@@ -8,42 +8,60 @@ namespace zion {
 
 using namespace ast;
 
-std::string prefix(const std::set<std::string> &bindings,
-                   std::string pre,
-                   std::string name) {
-  auto names = tld::split_fqn(name);
-  if (names.size() > 1) {
+namespace {
+
+/* true when name has a module qualifier. a bare "::name" is a tld that has
+ * not been qualified yet. this is tld::split_fqn(name).size() > 1 without the
+ * allocations. */
+bool is_module_qualified(const std::string &name) {
+  size_t start = 0;
+  while (name.compare(start, 2, "::") == 0) {
+    start += 2;
+  }
+  return name.find("::", start) != std::string::npos;
+}
+
+} // namespace
+
+std::string prefix(const std::unordered_set<Symbol> &bindings,
+                   const std::string &pre,
+                   const std::string &name) {
+  if (is_module_qualified(name)) {
     return name;
   }
 
-  if (in(name, bindings)) {
+  if (in(Symbol{name}, bindings)) {
     return tld::mktld(pre, name);
   } else {
     return name;
   }
 }
 
-Identifier prefix(const std::set<std::string> &bindings,
-                  std::string pre,
+Identifier prefix(const std::unordered_set<Symbol> &bindings,
+                  const std::string &pre,
                   const Identifier &id) {
-  return Identifier{prefix(bindings, pre, id.name), id.location};
+  if (is_module_qualified(id.name) || !in(id.name, bindings)) {
+    /* avoid re-interning names that are not rebound */
+    return id;
+  }
+  return Identifier{tld::mktld(pre, id.name), id.location};
 }
 
-Token prefix(const std::set<std::string> &bindings,
-             std::string pre,
+Token prefix(const std::unordered_set<Symbol> &bindings,
+             const std::string &pre,
              Token name) {
   assert(name.tk == tk_identifier);
   return Token{name.location, tk_identifier, prefix(bindings, pre, name.text)};
 }
 
-Expr *prefix(const std::set<std::string> &bindings,
-             std::string pre,
+Expr *prefix(const std::unordered_set<Symbol> &bindings,
+             const std::string &pre,
              Expr *value);
 
-const Predicate *prefix(const std::set<std::string> &bindings,
-                        std::string pre,
+const Predicate *prefix(const std::unordered_set<Symbol> &bindings,
+                        const std::string &pre,
                         const Predicate *predicate,
-                        std::set<std::string> &new_symbols) {
+                        std::unordered_set<Symbol> &new_symbols) {
   if (auto p = dcast<const TuplePredicate *>(predicate)) {
     if (p->name_assignment.valid) {
       new_symbols.insert(p->name_assignment.t.name);
@@ -77,10 +95,10 @@ const Predicate *prefix(const std::set<std::string> &bindings,
   }
 }
 
-const PatternBlock *prefix(const std::set<std::string> &bindings,
-                           std::string pre,
+const PatternBlock *prefix(const std::unordered_set<Symbol> &bindings,
+                           const std::string &pre,
                            const PatternBlock *pattern_block) {
-  std::set<std::string> new_symbols;
+  std::unordered_set<Symbol> new_symbols;
   const Predicate *new_predicate = prefix(
       bindings, pre, pattern_block->predicate, new_symbols);
 
@@ -88,31 +106,21 @@ const PatternBlock *prefix(const std::set<std::string> &bindings,
                                                 pre, pattern_block->result));
 }
 
-const Decl *prefix(const std::set<std::string> &bindings,
-                   std::string pre,
+const Decl *prefix(const std::unordered_set<Symbol> &bindings,
+                   const std::string &pre,
                    const Decl *value) {
   return new Decl(prefix(bindings, pre, value->id),
                   prefix(bindings, pre, value->value));
 }
 
-const TypeDecl *prefix(const std::set<std::string> &bindings,
-                       std::string pre,
+const TypeDecl *prefix(const std::unordered_set<Symbol> &bindings,
+                       const std::string &pre,
                        const TypeDecl *type_decl) {
   return new TypeDecl{prefix(bindings, pre, type_decl->id), type_decl->params};
 }
 
-std::set<std::string> only_type_names(const std::set<std::string> &bindings) {
-  std::set<std::string> only_type_names;
-  for (auto binding : bindings) {
-    if (tld::is_tld_type(binding)) {
-      only_type_names.insert(binding);
-    }
-  }
-  return only_type_names;
-}
-
-const TypeClass *prefix(const std::set<std::string> &bindings,
-                        std::string pre,
+const TypeClass *prefix(const std::unordered_set<Symbol> &bindings,
+                        const std::string &pre,
                         const TypeClass *type_class) {
   return new TypeClass(
       prefix(bindings, pre, type_class->id), type_class->type_var_ids,
@@ -122,16 +130,16 @@ const TypeClass *prefix(const std::set<std::string> &bindings,
 }
 
 types::ClassPredicateRef prefix(
-    const std::set<std::string> &bindings,
-    std::string pre,
+    const std::unordered_set<Symbol> &bindings,
+    const std::string &pre,
     const types::ClassPredicateRef &class_predicate) {
   return std::make_shared<types::ClassPredicate>(
       prefix(bindings, pre, class_predicate->classname),
       prefix(bindings, pre, class_predicate->params));
 }
 
-types::ClassPredicates prefix(const std::set<std::string> &bindings,
-                              std::string pre,
+types::ClassPredicates prefix(const std::unordered_set<Symbol> &bindings,
+                              const std::string &pre,
                               const types::ClassPredicates &class_predicates) {
   types::ClassPredicates new_cps;
   for (auto &cp : class_predicates) {
@@ -140,42 +148,42 @@ types::ClassPredicates prefix(const std::set<std::string> &bindings,
   return new_cps;
 }
 
-const Instance *prefix(const std::set<std::string> &bindings,
-                       std::string pre,
+const Instance *prefix(const std::unordered_set<Symbol> &bindings,
+                       const std::string &pre,
                        const Instance *instance) {
   return new Instance(prefix(bindings, pre, instance->class_predicate),
                       prefix(bindings, pre, instance->decls));
 }
 
-types::Ref prefix(const std::set<std::string> &bindings,
-                  std::string pre,
+types::Ref prefix(const std::unordered_set<Symbol> &bindings,
+                  const std::string &pre,
                   types::Ref type) {
   if (type == nullptr) {
     return nullptr;
   }
 
-  std::set<std::string> uppercase_bindings = only_type_names(bindings);
-  return type->prefix_ids(uppercase_bindings, pre);
+  return type->prefix_ids(bindings, pre);
 }
 
-std::set<std::string> without(const std::set<std::string> &s,
-                              const Identifiers &vars) {
-  std::set<std::string> c = s;
+std::unordered_set<Symbol> without(const std::unordered_set<Symbol> &s,
+                                   const Identifiers &vars) {
+  std::unordered_set<Symbol> c = s;
   for (auto &var : vars) {
     c.erase(var.name);
   }
   return c;
 }
 
-const Application *prefix_application(const std::set<std::string> &bindings,
-                                      std::string pre,
-                                      const Application *application) {
+const Application *prefix_application(
+    const std::unordered_set<Symbol> &bindings,
+    const std::string &pre,
+    const Application *application) {
   return new Application(prefix(bindings, pre, application->a),
                          prefix(bindings, pre, application->params));
 }
 
-const Expr *prefix(const std::set<std::string> &bindings,
-                   std::string pre,
+const Expr *prefix(const std::unordered_set<Symbol> &bindings,
+                   const std::string &pre,
                    const Expr *value) {
   if (auto static_print = dcast<const StaticPrint *>(value)) {
     return new StaticPrint(static_print->location,
@@ -245,8 +253,8 @@ const Expr *prefix(const std::set<std::string> &bindings,
   }
 }
 
-std::vector<const Expr *> prefix(const std::set<std::string> &bindings,
-                                 std::string pre,
+std::vector<const Expr *> prefix(const std::unordered_set<Symbol> &bindings,
+                                 const std::string &pre,
                                  std::vector<const Expr *> values) {
   std::vector<const Expr *> new_values;
   for (auto value : values) {
@@ -255,8 +263,8 @@ std::vector<const Expr *> prefix(const std::set<std::string> &bindings,
   return new_values;
 }
 
-types::Map prefix(const std::set<std::string> &bindings,
-                  std::string pre,
+types::Map prefix(const std::unordered_set<Symbol> &bindings,
+                  const std::string &pre,
                   const types::Map &data_ctors) {
   types::Map new_data_ctors;
   for (auto pair : data_ctors) {
@@ -266,8 +274,8 @@ types::Map prefix(const std::set<std::string> &bindings,
   return new_data_ctors;
 }
 
-ParsedDataCtorsMap prefix(const std::set<std::string> &bindings,
-                          std::string pre,
+ParsedDataCtorsMap prefix(const std::unordered_set<Symbol> &bindings,
+                          const std::string &pre,
                           const ParsedDataCtorsMap &data_ctors_map) {
   ParsedDataCtorsMap new_data_ctors_map;
   for (auto pair : data_ctors_map) {
@@ -277,7 +285,7 @@ ParsedDataCtorsMap prefix(const std::set<std::string> &bindings,
   return new_data_ctors_map;
 }
 
-const Module *prefix(const std::set<std::string> &bindings,
+const Module *prefix(const std::unordered_set<Symbol> &bindings,
                      const Module *module) {
   return new Module(module->name, module->imports,
                     prefix(bindings, module->name, module->decls),
@@ -290,8 +298,8 @@ const Module *prefix(const std::set<std::string> &bindings,
                     prefix(bindings, module->name, module->type_env));
 }
 
-types::Scheme::Ref prefix(const std::set<std::string> &bindings,
-                          std::string pre,
+types::Scheme::Ref prefix(const std::unordered_set<Symbol> &bindings,
+                          const std::string &pre,
                           types::Scheme::Ref scheme) {
   return ::scheme(scheme->vars, {},
                   // prefix(bindings, pre, scheme->predicates, false),
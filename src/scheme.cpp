@@ -86,13 +86,12 @@ Scheme::Ref Scheme::freshen() const {
 }
 
 Ftvs Scheme::ftvs() const {
-  if (!has_ftvs) {
-    has_ftvs = true;
+  std::call_once(ftvs_once, [this] {
     cached_ftvs = type->get_ftvs();
     for (auto &v : vars) {
       cached_ftvs.erase(v);
     }
-  }
+  });
   return cached_ftvs;
 }
 
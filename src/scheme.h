@@ -3,6 +3,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -49,7 +50,7 @@ struct Scheme final : public std::enable_shared_from_this<Scheme> {
   types::Ref const type;
 
 private:
-  mutable bool has_ftvs = false;
+  mutable std::once_flag ftvs_once;
   mutable Ftvs cached_ftvs;
 };
 
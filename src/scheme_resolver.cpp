@@ -9,13 +9,19 @@ namespace types {
 SchemeResolver::SchemeResolver(const SchemeResolver *parent) : parent(parent) {
 }
 
-bool SchemeResolver::scheme_exists(std::string name) const {
-  return (state.count(name) == 1) ||
-         (parent != nullptr && parent->scheme_exists(name));
+bool SchemeResolver::scheme_exists(Symbol name) const {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (state.count(name) == 1) {
+      return true;
+    }
+  }
+  return parent != nullptr && parent->scheme_exists(name);
 }
 
-void SchemeResolver::insert_scheme(std::string name,
+void SchemeResolver::insert_scheme(Symbol name,
                                    const types::SchemeRef &scheme) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
   if (state.count(name) != 0) {
     debug_above(3,
                 log("attempt to insert scheme %s for preexisting name %s :: %s",
@@ -32,29 +38,34 @@ void SchemeResolver::insert_scheme(std::string name,
 types::SchemeRef SchemeResolver::lookup_scheme(
     const Identifier &id,
     std::set<Identifier> &candidates) const {
-  auto iter = state.find(id.name);
-  if (iter != state.end()) {
-    return iter->second;
-  } else {
-    std::string upper_name = to_upper(id.name);
-    for (auto &pair : state) {
+  for (auto resolver = this; resolver != nullptr; resolver = resolver->parent) {
+    std::shared_lock<std::shared_mutex> lock(resolver->mutex);
+    auto iter = resolver->state.find(id.name);
+    if (iter != resolver->state.end()) {
+      return iter->second;
+    }
+  }
+
+  /* the symbol is undefined. only now is it worth searching every scope for
+   * similarly named symbols to suggest. */
+  std::string upper_name = to_upper(id.name);
+  std::string regex = "[^.]+\\.?" + regex_sanitize(upper_name);
+  for (auto resolver = this; resolver != nullptr; resolver = resolver->parent) {
+    std::shared_lock<std::shared_mutex> lock(resolver->mutex);
+    for (auto &pair : resolver->state) {
       /* look for a substring match in another symbol */
-      std::string regex = "[^.]+\\.?" + regex_sanitize(upper_name);
       if (regex_match(to_upper(pair.first), regex)) {
         candidates.insert(Identifier{pair.first, pair.second->get_location()});
       }
     }
-    if (parent != nullptr) {
-      return parent->lookup_scheme(id, candidates);
-    } else {
-      auto user_error = zion::user_error(
-          id.location, "symbol " c_id("%s") " is undefined", id.name.c_str());
-      for (auto &id : candidates) {
-        user_error.add_info(id.location, "did you mean %s?", id.str().c_str());
-      }
-      throw user_error;
-    }
   }
+
+  auto user_error = zion::user_error(
+      id.location, "symbol " c_id("%s") " is undefined", id.name.c_str());
+  for (auto &id : candidates) {
+    user_error.add_info(id.location, "did you mean %s?", id.str().c_str());
+  }
+  throw user_error;
 }
 
 void SchemeResolver::rebind(const types::Map &bindings) const {
@@ -62,6 +73,7 @@ void SchemeResolver::rebind(const types::Map &bindings) const {
     parent->rebind(bindings);
   }
 
+  std::shared_lock<std::shared_mutex> lock(mutex);
   types::Scheme::Map new_state;
   for (const auto &pair : state) {
     const auto &name = pair.first;
@@ -87,7 +99,12 @@ std::string SchemeResolver::str() const {
   std::stringstream ss;
   ss << "{";
   const char *delim = "";
-  for (auto &pair : state) {
+  std::map<Symbol, types::SchemeRef> ordered_state;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    ordered_state.insert(state.begin(), state.end());
+  }
+  for (auto &pair : ordered_state) {
     ss << delim;
     delim = ", ";
     ss << pair.first << ": " << pair.second->str();
@@ -3,7 +3,9 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 
 #include "identifier.h"
 #include "location.h"
@@ -16,11 +18,11 @@ struct SchemeResolver final {
   SchemeResolver() = default;
   SchemeResolver(const SchemeResolver *parent);
   SchemeResolver(const SchemeResolver &rhs) = delete;
-  SchemeResolver(SchemeResolver &&rhs) = default;
+  SchemeResolver(SchemeResolver &&rhs) = delete;
   ~SchemeResolver() = default;
 
-  bool scheme_exists(std::string name) const;
-  void insert_scheme(std::string name, const types::SchemeRef &scheme);
+  bool scheme_exists(Symbol name) const;
+  void insert_scheme(Symbol name, const types::SchemeRef &scheme);
   types::SchemeRef lookup_scheme(const Identifier &id,
                                  std::set<Identifier> &candidates) const;
   void rebind(const types::Map &bindings) const;
@@ -28,7 +30,10 @@ struct SchemeResolver final {
   std::string str() const;
 
 private:
-  types::Scheme::Map state;
+  /* the program-wide resolver is shared by every SCC being checked in
+   * parallel, so all access to state goes through this lock. */
+  mutable std::shared_mutex mutex;
+  std::unordered_map<Symbol, types::SchemeRef> state;
   const SchemeResolver *parent = nullptr;
 };
 
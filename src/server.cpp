@@ -0,0 +1,432 @@
+#include "server.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "dbg.h"
+#include "interface_cache.h"
+#include "logger.h"
+#include "user_error.h"
+#include "utils.h"
+
+extern char **environ;
+
+namespace zion {
+
+namespace {
+
+/* a request is a 32-bit length followed by that many bytes of NUL-terminated
+ * fields: the client's working directory, its argument count, its arguments,
+ * and then its environment. the client's stdin, stdout and stderr are passed
+ * along with the length. the reply is the 32-bit exit code of the command. */
+const int passed_fd_count = 3;
+
+/* how long a connected client has to finish sending its request */
+const int request_timeout_seconds = 10;
+
+struct Request {
+  int fds[passed_fd_count] = {-1, -1, -1};
+  std::string cwd;
+  std::vector<std::string> argv;
+  std::vector<std::string> env;
+};
+
+/* a request that a child process is handling */
+struct Child {
+  int client;
+  /* the read end of the pipe that the child writes its interfaces to */
+  int interfaces;
+  std::string interface_text;
+};
+
+bool write_all(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    auto count = ::write(fd, data, size);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += count;
+    size -= count;
+  }
+  return true;
+}
+
+bool read_all(int fd, char *data, std::size_t size) {
+  while (size > 0) {
+    auto count = ::read(fd, data, size);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return false;
+    }
+    data += count;
+    size -= count;
+  }
+  return true;
+}
+
+sockaddr_un get_socket_address(const std::string &socket_path) {
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    throw user_error(INTERNAL_LOC(), "server socket path %s is too long",
+                     socket_path.c_str());
+  }
+  strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  return address;
+}
+
+/* returns -1 if nothing is listening at socket_path */
+int connect_to_server(const std::string &socket_path) {
+  auto address = get_socket_address(socket_path);
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server == -1) {
+    return -1;
+  }
+  if (connect(server, reinterpret_cast<const sockaddr *>(&address),
+              sizeof(address)) != 0) {
+    close(server);
+    return -1;
+  }
+  return server;
+}
+
+bool send_request(int server, const std::string &payload) {
+  std::uint32_t size = payload.size();
+  iovec iov{&size, sizeof(size)};
+  int fds[passed_fd_count] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+  char control[CMSG_SPACE(sizeof(fds))];
+  memset(control, 0, sizeof(control));
+
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  if (sendmsg(server, &message, 0) != sizeof(size)) {
+    return false;
+  }
+  return write_all(server, payload.data(), payload.size());
+}
+
+void close_fds(const Request &request) {
+  for (int fd : request.fds) {
+    if (fd != -1) {
+      close(fd);
+    }
+  }
+}
+
+bool receive_request(int client, Request &request) {
+  std::uint32_t size = 0;
+  iovec iov{&size, sizeof(size)};
+  char control[CMSG_SPACE(sizeof(request.fds))];
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  ssize_t count;
+  do {
+    count = recvmsg(client, &message, 0);
+  } while (count < 0 && errno == EINTR);
+  if (count != sizeof(size)) {
+    return false;
+  }
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(request.fds))) {
+    return false;
+  }
+  memcpy(request.fds, CMSG_DATA(cmsg), sizeof(request.fds));
+
+  std::string payload(size, '\0');
+  if (!read_all(client, &payload[0], size)) {
+    return false;
+  }
+  std::vector<std::string> fields;
+  std::size_t start = 0;
+  for (std::size_t i = 0; i < payload.size(); ++i) {
+    if (payload[i] == '\0') {
+      fields.push_back(payload.substr(start, i - start));
+      start = i + 1;
+    }
+  }
+  if (fields.size() < 2) {
+    return false;
+  }
+  std::size_t argc = atoi(fields[1].c_str());
+  if (fields.size() < 2 + argc) {
+    return false;
+  }
+  request.cwd = fields[0];
+  request.argv.assign(fields.begin() + 2, fields.begin() + 2 + argc);
+  request.env.assign(fields.begin() + 2 + argc, fields.end());
+  return true;
+}
+
+/* whether the process at the other end of client runs as this user. requests
+ * run commands in a directory and environment of the client's choosing. */
+bool is_same_user(int client) {
+#ifdef __APPLE__
+  uid_t uid;
+  gid_t gid;
+  return getpeereid(client, &uid, &gid) == 0 && uid == getuid();
+#else
+  ucred credentials;
+  socklen_t size = sizeof(credentials);
+  return getsockopt(client, SOL_SOCKET, SO_PEERCRED, &credentials, &size) ==
+             0 &&
+         credentials.uid == getuid();
+#endif
+}
+
+/* runs in the child, after the server's own descriptors have been closed.
+ * reading the request here keeps a slow client from holding up the others. */
+int handle_request(int client,
+                   int interface_sink,
+                   const ServerHandler &handler) {
+  timeval timeout{request_timeout_seconds, 0};
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  Request request;
+  if (!receive_request(client, request)) {
+    close_fds(request);
+    return EXIT_FAILURE;
+  }
+  close(client);
+
+  signal(SIGPIPE, SIG_DFL);
+  for (int fd = 0; fd < passed_fd_count; ++fd) {
+    dup2(request.fds[fd], fd);
+    close(request.fds[fd]);
+  }
+  if (chdir(request.cwd.c_str()) != 0) {
+    perror(request.cwd.c_str());
+    return EXIT_FAILURE;
+  }
+
+  /* take on the client's environment in place of the server's */
+  std::vector<std::string> names;
+  for (char **var = environ; *var != nullptr; ++var) {
+    names.push_back(std::string(*var).substr(0, strcspn(*var, "=")));
+  }
+  for (auto &name : names) {
+    unsetenv(name.c_str());
+  }
+  for (auto &var : request.env) {
+    auto equals = var.find('=');
+    if (equals != std::string::npos) {
+      setenv(var.substr(0, equals).c_str(), var.substr(equals + 1).c_str(),
+             true /*overwrite*/);
+    }
+  }
+
+  set_interface_sink(interface_sink);
+  return handler(request.argv);
+}
+
+void finish_request(pid_t pid, Child &child) {
+  int status = 0;
+  while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {
+  }
+
+  std::int32_t exit_code = EXIT_FAILURE;
+  if (WIFEXITED(status)) {
+    exit_code = WEXITSTATUS(status);
+    /* a child that was killed may not have written all of its interfaces */
+    std::istringstream is(child.interface_text);
+    remember_interfaces(is);
+  } else if (WIFSIGNALED(status)) {
+    exit_code = 128 + WTERMSIG(status);
+  }
+  debug_above(1, log("server request %d finished with %d", (int)pid,
+                     (int)exit_code));
+
+  write_all(child.client, reinterpret_cast<const char *>(&exit_code),
+            sizeof(exit_code));
+  close(child.client);
+  close(child.interfaces);
+}
+
+} // namespace
+
+int run_server(const std::string &socket_path, const ServerHandler &handler) {
+  auto address = get_socket_address(socket_path);
+
+  /* never take over from a server that is still running, but clean up after
+   * one that exited without removing its socket */
+  int running_server = connect_to_server(socket_path);
+  if (running_server != -1) {
+    close(running_server);
+    throw user_error(INTERNAL_LOC(), "a server is already listening on %s",
+                     socket_path.c_str());
+  }
+  struct stat st;
+  if (lstat(socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+    unlink(socket_path.c_str());
+  }
+
+  /* only this user may connect */
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  mode_t old_umask = umask(S_IRWXG | S_IRWXO);
+  bool bound = listener != -1 &&
+               bind(listener, reinterpret_cast<const sockaddr *>(&address),
+                    sizeof(address)) == 0;
+  umask(old_umask);
+  if (!bound || chmod(socket_path.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+      listen(listener, SOMAXCONN) != 0) {
+    throw user_error(INTERNAL_LOC(), "unable to listen on %s: %s",
+                     socket_path.c_str(), strerror(errno));
+  }
+  /* clients that go away must not take the server with them */
+  signal(SIGPIPE, SIG_IGN);
+  log(log_info, "listening on %s", socket_path.c_str());
+
+  std::map<pid_t, Child> children;
+  while (true) {
+    std::vector<pollfd> pollfds{{listener, POLLIN, 0}};
+    std::vector<pid_t> pids;
+    for (auto &pair : children) {
+      pollfds.push_back({pair.second.interfaces, POLLIN, 0});
+      pids.push_back(pair.first);
+    }
+    if (poll(pollfds.data(), pollfds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw user_error(INTERNAL_LOC(), "server failed to poll: %s",
+                       strerror(errno));
+    }
+
+    for (std::size_t i = 1; i < pollfds.size(); ++i) {
+      if (pollfds[i].revents == 0) {
+        continue;
+      }
+      auto &child = children.at(pids[i - 1]);
+      char buffer[4096];
+      auto count = read(child.interfaces, buffer, sizeof(buffer));
+      if (count > 0) {
+        child.interface_text.append(buffer, count);
+      } else if (count == 0 || errno != EINTR) {
+        /* the pipe only closes when the child exits */
+        finish_request(pids[i - 1], child);
+        children.erase(pids[i - 1]);
+      }
+    }
+
+    if ((pollfds[0].revents & POLLIN) == 0) {
+      continue;
+    }
+    int client = accept(listener, nullptr, nullptr);
+    if (client == -1) {
+      continue;
+    }
+    if (!is_same_user(client)) {
+      log(log_warning, "refusing a request from another user");
+      close(client);
+      continue;
+    }
+
+    int interfaces[2];
+    if (pipe(interfaces) != 0) {
+      close(client);
+      continue;
+    }
+    /* neither the compiler's subprocesses nor the program it runs should keep
+     * the pipe open */
+    fcntl(interfaces[1], F_SETFD, FD_CLOEXEC);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(listener);
+      close(interfaces[0]);
+      for (auto &pair : children) {
+        close(pair.second.client);
+        close(pair.second.interfaces);
+      }
+      exit(handle_request(client, interfaces[1], handler));
+    }
+
+    close(interfaces[1]);
+    if (pid == -1) {
+      log(log_error, "unable to fork a server child: %s", strerror(errno));
+      std::int32_t exit_code = EXIT_FAILURE;
+      write_all(client, reinterpret_cast<const char *>(&exit_code),
+                sizeof(exit_code));
+      close(client);
+      close(interfaces[0]);
+      continue;
+    }
+    children[pid] = Child{client, interfaces[0], {}};
+  }
+}
+
+bool forward_to_server(const std::string &socket_path,
+                       const std::vector<std::string> &argv,
+                       int &exit_code) {
+  int server = connect_to_server(socket_path);
+  if (server == -1) {
+    return false;
+  }
+
+  std::string payload;
+  auto add_field = [&payload](const std::string &field) {
+    payload += field;
+    payload.push_back('\0');
+  };
+  add_field(get_cwd());
+  add_field(std::to_string(argv.size()));
+  for (auto &arg : argv) {
+    add_field(arg);
+  }
+  for (char **var = environ; *var != nullptr; ++var) {
+    add_field(*var);
+  }
+
+  if (!send_request(server, payload)) {
+    close(server);
+    return false;
+  }
+
+  std::int32_t reply;
+  bool replied = read_all(server, reinterpret_cast<char *>(&reply),
+                          sizeof(reply));
+  close(server);
+  if (!replied) {
+    log(log_error, "the server at %s stopped before replying",
+        socket_path.c_str());
+    exit_code = EXIT_FAILURE;
+  } else {
+    exit_code = reply;
+  }
+  return true;
+}
+
+} // namespace zion
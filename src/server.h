@@ -0,0 +1,28 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace zion {
+
+/* runs one zion command line for a client and returns its exit code. it is
+ * called in a child process whose working directory, environment and standard
+ * streams have already been switched to the client's. */
+using ServerHandler = std::function<int(const std::vector<std::string> &argv)>;
+
+/* listen on the unix socket at socket_path, which only this user can use,
+ * and handle each request in a child forked from this process. the interfaces
+ * that those children check are remembered here, so later children start with
+ * them in memory and only check modules whose sources changed. returns only if
+ * the socket cannot be served. */
+int run_server(const std::string &socket_path, const ServerHandler &handler);
+
+/* ask the server listening at socket_path to run argv with this process's
+ * working directory, environment and standard streams. returns false, having
+ * run nothing, if no server is listening there. */
+bool forward_to_server(const std::string &socket_path,
+                       const std::vector<std::string> &argv,
+                       int &exit_code);
+
+} // namespace zion
@@ -4,7 +4,10 @@
 #include "ast.h"
 #endif
 
+#include <unordered_set>
+
 #include "dbg.h"
+#include "ptr.h"
 #include "unification.h"
 #include "user_error.h"
 
@@ -43,6 +46,196 @@ void check_constraints_cover_tracked_types(
 }
 #endif
 
+/* a union-find substitution over type variables. each bound variable has a
+ * cell pointing at the type it was unified with, and lookups compress chains
+ * of bound variables. bindings made while unifying one constraint are
+ * trailed, so that a failed constraint can be undone for error reporting. */
+class UnionFind {
+public:
+  bool unify(types::Ref a, types::Ref b) {
+    a = find(a);
+    b = find(b);
+    if (a == b) {
+      return true;
+    }
+
+    if (auto tv_a = dyncast<const types::TypeVariable>(a)) {
+      if (auto tv_b = dyncast<const types::TypeVariable>(b)) {
+        if (tv_a->id.name == tv_b->id.name) {
+          return true;
+        }
+      }
+      return bind(tv_a->id.name, b);
+    } else if (auto tv_b = dyncast<const types::TypeVariable>(b)) {
+      return bind(tv_b->id.name, a);
+    } else if (auto ti_a = dyncast<const types::TypeId>(a)) {
+      if (auto ti_b = dyncast<const types::TypeId>(b)) {
+        return ti_a->id.name == ti_b->id.name;
+      }
+    } else if (auto to_a = dyncast<const types::TypeOperator>(a)) {
+      if (auto to_b = dyncast<const types::TypeOperator>(b)) {
+        return unify(to_a->oper, to_b->oper) &&
+               unify(to_a->operand, to_b->operand);
+      }
+    } else if (auto tpa_a = dyncast<const types::TypeParams>(a)) {
+      if (auto tpa_b = dyncast<const types::TypeParams>(b)) {
+        return unify_many(tpa_a->dimensions, tpa_b->dimensions);
+      }
+    } else if (auto tup_a = dyncast<const types::TypeTuple>(a)) {
+      if (auto tup_b = dyncast<const types::TypeTuple>(b)) {
+        return unify_many(tup_a->dimensions, tup_b->dimensions);
+      }
+    }
+    return false;
+  }
+
+  /* returns type with all bound type variables substituted away */
+  types::Ref resolve(const types::Ref &type) {
+    types::Map bindings;
+    for (auto &ftv : type->get_ftvs()) {
+      if (cells.count(ftv) != 0) {
+        bindings[ftv] = resolve_variable(ftv);
+      }
+    }
+    return type->rebind(bindings);
+  }
+
+  types::Map get_bindings() {
+    types::Map bindings;
+    for (auto &pair : cells) {
+      bindings[pair.first] = resolve_variable(pair.first);
+    }
+    return bindings;
+  }
+
+  void commit() {
+    trail.clear();
+  }
+
+  void rollback() {
+    while (trail.size() != 0) {
+      auto &entry = trail.back();
+      if (entry.second != nullptr) {
+        cells[entry.first] = entry.second;
+      } else {
+        cells.erase(entry.first);
+      }
+      trail.pop_back();
+    }
+    resolved.clear();
+    dependents.clear();
+  }
+
+private:
+  types::Ref find(const types::Ref &type) {
+    auto tv = dyncast<const types::TypeVariable>(type);
+    if (tv == nullptr) {
+      return type;
+    }
+    auto iter = cells.find(tv->id.name);
+    if (iter == cells.end()) {
+      return type;
+    }
+    types::Ref root = find(iter->second);
+    if (root != iter->second) {
+      /* path compression */
+      trail.push_back({iter->first, iter->second});
+      iter->second = root;
+    }
+    return root;
+  }
+
+  bool bind(const std::string &name, const types::Ref &type) {
+    std::unordered_set<std::string> visited;
+    if (occurs(name, type, visited)) {
+      return false;
+    }
+    trail.push_back({name, nullptr});
+    cells[name] = type;
+
+    /* only the resolutions that mention name have changed */
+    auto iter = dependents.find(name);
+    if (iter != dependents.end()) {
+      for (auto &dependent : iter->second) {
+        resolved.erase(dependent);
+      }
+      dependents.erase(iter);
+    }
+    return true;
+  }
+
+  /* whether the type variable name is free in type once the bound type
+   * variables within it are followed. visited holds the bound type variables
+   * that have already been walked, so that each is walked only once. */
+  bool occurs(const std::string &name,
+              const types::Ref &type,
+              std::unordered_set<std::string> &visited) {
+    if (auto tv = dyncast<const types::TypeVariable>(type)) {
+      auto iter = cells.find(tv->id.name);
+      if (iter == cells.end()) {
+        return tv->id.name == name;
+      }
+      return visited.insert(tv->id.name).second &&
+             occurs(name, find(type), visited);
+    } else if (auto to = dyncast<const types::TypeOperator>(type)) {
+      return occurs(name, to->oper, visited) ||
+             occurs(name, to->operand, visited);
+    } else if (auto tpa = dyncast<const types::TypeParams>(type)) {
+      return occurs_in_any(name, tpa->dimensions, visited);
+    } else if (auto tup = dyncast<const types::TypeTuple>(type)) {
+      return occurs_in_any(name, tup->dimensions, visited);
+    } else if (auto tl = dyncast<const types::TypeLambda>(type)) {
+      return tl->binding.name != name && occurs(name, tl->body, visited);
+    }
+    return false;
+  }
+
+  bool occurs_in_any(const std::string &name,
+                     const types::Refs &types,
+                     std::unordered_set<std::string> &visited) {
+    for (auto &type : types) {
+      if (occurs(name, type, visited)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool unify_many(const types::Refs &as, const types::Refs &bs) {
+    if (as.size() != bs.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < as.size(); ++i) {
+      if (!unify(as[i], bs[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  types::Ref resolve_variable(const std::string &name) {
+    auto iter = resolved.find(name);
+    if (iter != resolved.end()) {
+      return iter->second;
+    }
+    types::Ref type = resolve(cells.at(name));
+    resolved[name] = type;
+    for (auto &ftv : type->get_ftvs()) {
+      dependents[ftv].push_back(name);
+    }
+    return type;
+  }
+
+  std::unordered_map<std::string, types::Ref> cells;
+  /* prior values of the cells written since the last commit */
+  std::vector<std::pair<std::string, types::Ref>> trail;
+  /* memoized resolutions of bound type variables */
+  std::unordered_map<std::string, types::Ref> resolved;
+  /* the memoized resolutions that each free type variable appears in, which
+   * binding that type variable invalidates */
+  std::unordered_map<std::string, std::vector<std::string>> dependents;
+};
+
 } // namespace
 
 types::Map solver(bool check_constraint_coverage,
@@ -66,33 +259,31 @@ types::Map solver(bool check_constraint_coverage,
   }
 #endif
 
-  types::Map bindings;
-  for (auto iter = constraints.begin(); iter != constraints.end();) {
-    types::Unification unification = types::unify(iter->a, iter->b);
-    if (unification.result) {
-      if (unification.bindings.size() != 0) {
-        rebind_tracked_types(tracked_types, unification.bindings);
-        scheme_resolver.rebind(unification.bindings);
-
-        /* save the bindings */
-        types::Map new_bindings = compose(unification.bindings, bindings);
-        std::swap(bindings, new_bindings);
-      }
-      ++iter;
-
-      rebind_constraints(iter, constraints.end(), unification.bindings);
-
-      /* rebind the class predicates */
-      instance_requirements = types::rebind(instance_requirements,
-                                            unification.bindings);
+  UnionFind substitution;
+  for (auto &constraint : constraints) {
+    if (substitution.unify(constraint.a, constraint.b)) {
+      substitution.commit();
       continue;
-    } else {
-      auto error = user_error(unification.error_location, "%s",
-                              unification.error_string.c_str());
-      error.add_info(iter->context.location, "while checking that %s",
-                     iter->context.message.c_str());
-      throw error;
     }
+
+    /* report the failure exactly as unifying the rebound constraint would */
+    substitution.rollback();
+    types::Unification unification = types::unify(
+        substitution.resolve(constraint.a), substitution.resolve(constraint.b));
+    assert(!unification.result);
+    auto error = user_error(unification.error_location, "%s",
+                            unification.error_string.c_str());
+    error.add_info(constraint.context.location, "while checking that %s",
+                   constraint.context.message.c_str());
+    throw error;
+  }
+
+  /* apply the substitution once for the whole set of constraints */
+  types::Map bindings = substitution.get_bindings();
+  if (bindings.size() != 0) {
+    rebind_tracked_types(tracked_types, bindings);
+    scheme_resolver.rebind(bindings);
+    instance_requirements = types::rebind(instance_requirements, bindings);
   }
   return bindings;
 }
@@ -0,0 +1,295 @@
+#include "specialize_hofs.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <map>
+
+#include "ast.h"
+#include "dbg.h"
+#include "logger.h"
+#include "ptr.h"
+#include "time_trace.h"
+#include "user_error.h"
+#include "utils.h"
+
+namespace zion {
+
+using namespace ast;
+
+namespace {
+
+struct HofSpecialization {
+  types::DefnId base;
+  /* the index and the translation of each known function param */
+  std::vector<std::pair<std::size_t, const Expr *>> known_params;
+  /* the types of the known params and everything within them */
+  TrackedTypes typing;
+};
+
+/* specialization happens on a single thread, so none of this is locked */
+std::map<types::DefnId, HofSpecialization> specializations;
+int budget = 0;
+int specialized_count = 0;
+
+/* call visit with expr and every expression within it, along with the names
+ * that are bound within expr at that point. returns false if expr holds
+ * something that translation does not produce. */
+bool walk(const Expr *expr,
+          const std::unordered_set<Symbol> &bound_within,
+          const std::function<
+              void(const Expr *, const std::unordered_set<Symbol> &)> &visit) {
+  visit(expr, bound_within);
+  auto walk_all = [&](const std::vector<const Expr *> &exprs) {
+    for (auto expr : exprs) {
+      if (!walk(expr, bound_within, visit)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  if (dcast<const Literal *>(expr) || dcast<const Var *>(expr) ||
+      dcast<const Break *>(expr) || dcast<const Continue *>(expr) ||
+      dcast<const Sizeof *>(expr)) {
+    return true;
+  } else if (auto lambda = dcast<const Lambda *>(expr)) {
+    auto new_bound_within = bound_within;
+    for (auto &var : lambda->vars) {
+      new_bound_within.insert(var.name);
+    }
+    return walk(lambda->body, new_bound_within, visit);
+  } else if (auto application = dcast<const Application *>(expr)) {
+    return walk(application->a, bound_within, visit) &&
+           walk_all(application->params);
+  } else if (auto let = dcast<const Let *>(expr)) {
+    auto new_bound_within = bound_within;
+    new_bound_within.insert(let->var.name);
+    return walk(let->value, bound_within, visit) &&
+           walk(let->body, new_bound_within, visit);
+  } else if (auto condition = dcast<const Conditional *>(expr)) {
+    return walk_all({condition->cond, condition->truthy, condition->falsey});
+  } else if (auto while_ = dcast<const While *>(expr)) {
+    return walk_all({while_->condition, while_->block});
+  } else if (auto block = dcast<const Block *>(expr)) {
+    return walk_all(block->statements);
+  } else if (auto return_ = dcast<const ReturnStatement *>(expr)) {
+    return walk(return_->value, bound_within, visit);
+  } else if (auto tuple = dcast<const Tuple *>(expr)) {
+    return walk_all(tuple->dims);
+  } else if (auto tuple_deref = dcast<const TupleDeref *>(expr)) {
+    return walk(tuple_deref->expr, bound_within, visit);
+  } else if (auto as = dcast<const As *>(expr)) {
+    return walk(as->expr, bound_within, visit);
+  } else if (auto ffi = dcast<const FFI *>(expr)) {
+    return walk_all(ffi->exprs);
+  } else if (auto builtin = dcast<const Builtin *>(expr)) {
+    return walk(builtin->var, bound_within, visit) && walk_all(builtin->exprs);
+  } else if (auto defer = dcast<const Defer *>(expr)) {
+    return walk(defer->application, bound_within, visit);
+  }
+  return false;
+}
+
+/* whether lambda only refers to its own params and locals, and to globals */
+bool is_closed(const Lambda *lambda,
+               const std::unordered_set<Symbol> &bound_vars) {
+  bool closed = true;
+  bool walked = walk(lambda, {},
+                     [&](const Expr *expr,
+                         const std::unordered_set<Symbol> &bound_within) {
+                       auto var = dcast<const Var *>(expr);
+                       if (var != nullptr && in(var->id.name, bound_vars) &&
+                           !in(var->id.name, bound_within)) {
+                         closed = false;
+                       }
+                     });
+  return walked && closed;
+}
+
+bool is_function_type(types::Ref type) {
+  return unfold_arrows(type).size() > 1;
+}
+
+bool is_global(const Var *var, const std::unordered_set<Symbol> &bound_vars) {
+  return !in(var->id.name, bound_vars) &&
+         !starts_with(var->id.name, "__builtin_");
+}
+
+/* whether body calls the variable name that it is given, as opposed to only
+ * storing it or passing it along */
+bool calls_var(const Expr *body, Symbol name) {
+  bool calls = false;
+  walk(body, {},
+       [&](const Expr *expr, const std::unordered_set<Symbol> &bound_within) {
+         auto application = dcast<const Application *>(expr);
+         if (application == nullptr || in(name, bound_within)) {
+           return;
+         }
+         auto var = dcast<const Var *>(application->a);
+         if (var != nullptr && var->id.name == name) {
+           calls = true;
+         }
+       });
+  return calls;
+}
+
+} // namespace
+
+int get_specialize_budget() {
+  const char *budget_text = getenv("ZION_SPECIALIZE_BUDGET");
+  if (budget_text == nullptr || budget_text[0] == '\0') {
+    return 0;
+  }
+
+  char *end = nullptr;
+  errno = 0;
+  const long budget = strtol(budget_text, &end, 10);
+  if (*end != '\0' || errno == ERANGE || budget < 0 || budget > INT_MAX) {
+    throw user_error(INTERNAL_LOC(),
+                     "ZION_SPECIALIZE_BUDGET should be a count of nodes, not "
+                     "\"%s\"",
+                     budget_text);
+  }
+  return budget;
+}
+
+void reset_hof_specializations() {
+  specializations.clear();
+  budget = get_specialize_budget();
+  specialized_count = 0;
+}
+
+int get_hof_specialization_count() {
+  return specialized_count;
+}
+
+const Expr *specialize_hof_callee(
+    const types::DefnId &for_defn_id,
+    const Expr *callee,
+    const std::vector<const Expr *> &params,
+    const DataCtorsMap &data_ctors_map,
+    const std::unordered_set<Symbol> &bound_vars,
+    TrackedTypes &typing,
+    types::NeededDefns &needed_defns) {
+  /* data constructors only store their params */
+  auto callee_var = dcast<const Var *>(callee);
+  if (budget <= 0 || callee_var == nullptr ||
+      !is_global(callee_var, bound_vars) ||
+      in(callee_var->id.name, data_ctors_map.ctor_id_map)) {
+    return nullptr;
+  }
+
+  HofSpecialization specialization{
+      types::DefnId{callee_var->id, typing.at(callee)}, {}, {}};
+  std::vector<std::string> keys;
+  for (std::size_t i = 0; i < params.size(); ++i) {
+    auto param = params[i];
+    if (!is_function_type(typing.at(param))) {
+      continue;
+    }
+    if (auto var = dcast<const Var *>(param)) {
+      if (is_global(var, bound_vars)) {
+        keys.push_back(string_format("%d=%s", int(i), var->id.name.c_str()));
+        specialization.known_params.push_back({i, param});
+      }
+    } else if (auto lambda = dcast<const Lambda *>(param)) {
+      if (is_closed(lambda, bound_vars)) {
+        /* the same lambda may translate differently within each
+         * specialization of the function that it is written in */
+        keys.push_back(string_format(
+            "%d=fn@%s@%zx", int(i), lambda->get_location().repr().c_str(),
+            std::hash<std::string>{}(for_defn_id.str())));
+        specialization.known_params.push_back({i, param});
+      }
+    }
+  }
+  if (keys.empty()) {
+    return nullptr;
+  }
+
+  for (auto &known_param : specialization.known_params) {
+    walk(known_param.second, {},
+         [&](const Expr *expr, const std::unordered_set<Symbol> &) {
+           auto iter = typing.find(expr);
+           if (iter != typing.end()) {
+             specialization.typing[expr] = iter->second;
+           }
+         });
+  }
+
+  const Identifier id{string_format("%s{%s}", callee_var->id.name.c_str(),
+                                    join(keys, ",").c_str()),
+                      callee_var->get_location()};
+  const types::DefnId defn_id{id, specialization.base.type};
+  if (specializations.count(defn_id) == 0) {
+    specializations.emplace(defn_id, std::move(specialization));
+  }
+
+  debug_above(3, log("specializing %s for %s", callee->str().c_str(),
+                     id.str().c_str()));
+  insert_needed_defn(needed_defns, defn_id, callee->get_location(),
+                     for_defn_id);
+  auto new_callee = new Var(id);
+  typing[new_callee] = defn_id.type;
+  return new_callee;
+}
+
+const types::DefnId *get_hof_specialization_base(
+    const types::DefnId &defn_id) {
+  auto iter = specializations.find(defn_id);
+  return iter != specializations.end() ? &iter->second.base : nullptr;
+}
+
+Translation::ref translate_hof_specialization(const types::DefnId &defn_id,
+                                              const Translation &base) {
+  const HofSpecialization &specialization = specializations.at(defn_id);
+
+  int size = 0;
+  walk(base.expr, {},
+       [&size](const Expr *, const std::unordered_set<Symbol> &) { ++size; });
+  auto lambda = dcast<const Lambda *>(base.expr);
+
+  /* only the known params that the base calls make calls direct */
+  std::vector<std::pair<std::size_t, const Expr *>> called_params;
+  if (lambda != nullptr) {
+    for (auto &known_param : specialization.known_params) {
+      if (known_param.first < lambda->vars.size() &&
+          calls_var(lambda->body, lambda->vars[known_param.first].name)) {
+        called_params.push_back(known_param);
+      }
+    }
+  }
+
+  TrackedTypes typing;
+  if (called_params.empty() || size > budget) {
+    /* share the base */
+    auto var = new Var(specialization.base.id);
+    typing[var] = defn_id.type;
+    return std::make_shared<Translation>(var, std::move(typing));
+  }
+  budget -= size;
+  ++specialized_count;
+  time_trace_add_counter("specialized higher-order functions", 1);
+
+  typing = base.typing;
+  for (auto &pair : specialization.typing) {
+    typing[pair.first] = pair.second;
+  }
+
+  /* fn (f, xs) => body becomes fn (_, xs) => let f = known_f in body */
+  auto vars = lambda->vars;
+  const Expr *body = lambda->body;
+  for (auto &known_param : called_params) {
+    const Identifier &var = lambda->vars[known_param.first];
+    vars[known_param.first] = Identifier{fresh(), var.location};
+    body = new Let(var, known_param.second, body);
+    typing[body] = base.typing.at(lambda->body);
+  }
+  auto new_lambda = new Lambda(vars, {}, nullptr, body);
+  typing[new_lambda] = defn_id.type;
+  return std::make_shared<Translation>(new_lambda, std::move(typing));
+}
+
+} // namespace zion
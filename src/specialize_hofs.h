@@ -0,0 +1,54 @@
+#pragma once
+#include <unordered_set>
+#include <vector>
+
+#include "ast_decls.h"
+#include "data_ctors_map.h"
+#include "defn_id.h"
+#include "tracked_types.h"
+#include "translate.h"
+
+namespace zion {
+
+/* functions such as map and filter are monomorphized by type alone, so every
+ * caller shares one instance of them that calls its function params
+ * indirectly. when a call passes a global function, or a lambda that captures
+ * nothing, a higher-order function can instead be specialized for that
+ * argument. the specialization binds the param to the argument before running
+ * the original body, so the calls within it become direct, and can be
+ * inlined. this is optional: the clones are limited to a budget of translated
+ * nodes, which $ZION_SPECIALIZE_BUDGET sets, and there are none when it is
+ * unset or 0. */
+void reset_hof_specializations();
+
+/* the budget that $ZION_SPECIALIZE_BUDGET asks for, or 0 when it is unset.
+ * throws a user_error when it is not a count. */
+int get_specialize_budget();
+
+/* how many specializations have been made since the last reset */
+int get_hof_specialization_count();
+
+/* given the translated parts of an application, return the callee to use
+ * instead, which is a specialization of callee for the known function
+ * params, or nullptr when there are none or callee is a data constructor. */
+const ast::Expr *specialize_hof_callee(
+    const types::DefnId &for_defn_id,
+    const ast::Expr *callee,
+    const std::vector<const ast::Expr *> &params,
+    const DataCtorsMap &data_ctors_map,
+    const std::unordered_set<Symbol> &bound_vars,
+    TrackedTypes &typing,
+    types::NeededDefns &needed_defns);
+
+/* if defn_id is a specialization that specialize_hof_callee asked for, the
+ * function that it specializes, otherwise nullptr */
+const types::DefnId *get_hof_specialization_base(
+    const types::DefnId &defn_id);
+
+/* translate the specialization defn_id from the translation of its base.
+ * when the base calls none of the known function params, or the budget has
+ * run out, the specialization shares the base. */
+Translation::ref translate_hof_specialization(const types::DefnId &defn_id,
+                                              const Translation &base);
+
+} // namespace zion
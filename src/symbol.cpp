@@ -0,0 +1,137 @@
+#include "symbol.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+struct Symbol::Entry {
+  std::string text;
+  std::size_t hash;
+};
+
+namespace {
+
+struct SymbolTable {
+  std::mutex mutex;
+  /* a deque never moves its elements, so Entry pointers held by Symbols stay
+   * valid as the table grows. the index keys view the entries' own text. */
+  std::deque<Symbol::Entry> entries;
+  std::unordered_map<std::string_view, const Symbol::Entry *> index;
+};
+
+SymbolTable &get_symbol_table() {
+  static SymbolTable symbol_table;
+  return symbol_table;
+}
+
+const Symbol::Entry *intern(std::string_view text) {
+  auto &table = get_symbol_table();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  auto iter = table.index.find(text);
+  if (iter != table.index.end()) {
+    return iter->second;
+  }
+  std::string owned_text{text};
+  std::size_t hash = std::hash<std::string>()(owned_text);
+  table.entries.push_back(Symbol::Entry{std::move(owned_text), hash});
+  const Symbol::Entry *entry = &table.entries.back();
+  table.index.insert({std::string_view{entry->text}, entry});
+  return entry;
+}
+
+const Symbol::Entry *empty_entry() {
+  static const Symbol::Entry *entry = intern({});
+  return entry;
+}
+
+} // namespace
+
+Symbol::Symbol() : entry(empty_entry()) {
+}
+
+Symbol::Symbol(const std::string &text) : entry(intern(text)) {
+}
+
+Symbol::Symbol(std::string_view text) : entry(intern(text)) {
+}
+
+Symbol::Symbol(const char *text) : entry(intern(text)) {
+}
+
+const std::string &Symbol::str() const {
+  return entry->text;
+}
+
+const char *Symbol::c_str() const {
+  return entry->text.c_str();
+}
+
+std::size_t Symbol::size() const {
+  return entry->text.size();
+}
+
+bool Symbol::empty() const {
+  return entry->text.empty();
+}
+
+std::size_t Symbol::hash() const {
+  return entry->hash;
+}
+
+std::size_t Symbol::interned_count() {
+  auto &table = get_symbol_table();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  return table.entries.size();
+}
+
+Symbol::operator const std::string &() const {
+  return entry->text;
+}
+
+bool Symbol::operator<(const Symbol &rhs) const {
+  return entry != rhs.entry && entry->text < rhs.entry->text;
+}
+
+bool operator==(const Symbol &lhs, const std::string &rhs) {
+  return lhs.str() == rhs;
+}
+
+bool operator==(const std::string &lhs, const Symbol &rhs) {
+  return lhs == rhs.str();
+}
+
+bool operator==(const Symbol &lhs, const char *rhs) {
+  return lhs.str() == rhs;
+}
+
+bool operator!=(const Symbol &lhs, const std::string &rhs) {
+  return lhs.str() != rhs;
+}
+
+bool operator!=(const std::string &lhs, const Symbol &rhs) {
+  return lhs != rhs.str();
+}
+
+bool operator!=(const Symbol &lhs, const char *rhs) {
+  return lhs.str() != rhs;
+}
+
+std::string operator+(const Symbol &lhs, const std::string &rhs) {
+  return lhs.str() + rhs;
+}
+
+std::string operator+(const std::string &lhs, const Symbol &rhs) {
+  return lhs + rhs.str();
+}
+
+std::string operator+(const Symbol &lhs, const char *rhs) {
+  return lhs.str() + rhs;
+}
+
+std::string operator+(const char *lhs, const Symbol &rhs) {
+  return lhs + rhs.str();
+}
+
+std::ostream &operator<<(std::ostream &os, const Symbol &symbol) {
+  return os << symbol.str();
+}
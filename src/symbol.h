@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/* a Symbol is an interned string. every distinct spelling is stored exactly
+ * once in a process-wide table, so copying a Symbol is copying a pointer,
+ * equality is pointer equality, and hashing reads a cached value. ordering is
+ * still lexicographic so that ordered containers of Symbols iterate in the
+ * same order as they would with std::string keys. */
+class Symbol {
+public:
+  Symbol();
+  Symbol(const std::string &text);
+  Symbol(std::string_view text);
+  Symbol(const char *text);
+
+  const std::string &str() const;
+  const char *c_str() const;
+  std::size_t size() const;
+  bool empty() const;
+  /* equal to std::hash<std::string>()(str()) */
+  std::size_t hash() const;
+
+  /* how many distinct spellings have been interned so far */
+  static std::size_t interned_count();
+
+  operator const std::string &() const;
+
+  bool operator==(const Symbol &rhs) const {
+    return entry == rhs.entry;
+  }
+  bool operator!=(const Symbol &rhs) const {
+    return entry != rhs.entry;
+  }
+  bool operator<(const Symbol &rhs) const;
+
+  struct Entry;
+
+private:
+  const Entry *entry;
+};
+
+bool operator==(const Symbol &lhs, const std::string &rhs);
+bool operator==(const std::string &lhs, const Symbol &rhs);
+bool operator==(const Symbol &lhs, const char *rhs);
+bool operator!=(const Symbol &lhs, const std::string &rhs);
+bool operator!=(const std::string &lhs, const Symbol &rhs);
+bool operator!=(const Symbol &lhs, const char *rhs);
+std::string operator+(const Symbol &lhs, const std::string &rhs);
+std::string operator+(const std::string &lhs, const Symbol &rhs);
+std::string operator+(const Symbol &lhs, const char *rhs);
+std::string operator+(const char *lhs, const Symbol &rhs);
+
+std::ostream &operator<<(std::ostream &os, const Symbol &symbol);
+
+namespace std {
+template <> struct hash<Symbol> {
+  std::size_t operator()(const Symbol &symbol) const {
+    return symbol.hash();
+  }
+};
+} // namespace std
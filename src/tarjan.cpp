@@ -15,15 +15,15 @@ struct IndexAndLow {
   int lowlink;
 };
 
-typedef std::unordered_map<std::string, IndexAndLow> State;
-typedef std::list<std::string> Stack;
-typedef std::unordered_set<std::string> StackSet;
+typedef std::unordered_map<Symbol, IndexAndLow> State;
+typedef std::list<Symbol> Stack;
+typedef std::unordered_set<Symbol> StackSet;
 
 int strong_connect(const Graph &graph,
                    State &state,
                    Stack &stack,
                    StackSet &stack_set,
-                   std::string cur,
+                   Symbol cur,
                    int index,
                    SCCs &sccs) {
   /* Set the depth index for cur to the smallest unused index */
@@ -52,9 +52,9 @@ int strong_connect(const Graph &graph,
   // If cur is a root node, pop the stack and generate an SCC
   if (state[cur].lowlink == state[cur].index) {
     // start a new strongly connected component
-    sccs.push_back(std::set<std::string>{});
+    sccs.push_back(Vertices{});
     while (stack.size() != 0) {
-      const std::string next = stack.back();
+      const Symbol next = stack.back();
       stack.pop_back();
       stack_set.erase(next);
       // add next to current strongly connected component
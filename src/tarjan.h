@@ -6,11 +6,13 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "symbol.h"
+
 namespace tarjan {
 
 /* Tarjan's Strongly Connected Components algorithm */
-typedef std::set<std::string> Vertices;
-typedef std::unordered_map<std::string, Vertices> Graph;
+typedef std::set<Symbol> Vertices;
+typedef std::unordered_map<Symbol, Vertices> Graph;
 
 typedef std::list<Vertices> SCCs;
 
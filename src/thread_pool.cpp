@@ -0,0 +1,79 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+int worker_count = std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+int get_worker_count() {
+  return worker_count;
+}
+
+void set_worker_count(int worker_count_) {
+  worker_count = std::max(1, worker_count_);
+}
+
+ThreadPool::ThreadPool(int worker_count) {
+  if (worker_count > 1) {
+    for (int i = 0; i < worker_count; ++i) {
+      threads.emplace_back([this] { work(); });
+    }
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  task_ready.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(std::move(task));
+  }
+  task_ready.notify_one();
+}
+
+void ThreadPool::wait() {
+  if (threads.empty()) {
+    /* run everything inline, including whatever the tasks enqueue. */
+    while (!queue.empty()) {
+      auto task = std::move(queue.front());
+      queue.pop_front();
+      task();
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  tasks_done.wait(lock, [this] { return queue.empty() && running == 0; });
+}
+
+void ThreadPool::work() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    task_ready.wait(lock, [this] { return stopping || !queue.empty(); });
+    if (queue.empty()) {
+      /* we are stopping and there is nothing left to do */
+      return;
+    }
+
+    auto task = std::move(queue.front());
+    queue.pop_front();
+    ++running;
+    lock.unlock();
+    task();
+    lock.lock();
+    --running;
+    if (queue.empty() && running == 0) {
+      tasks_done.notify_all();
+    }
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* the number of worker threads the compiler may use, as set by -j. */
+int get_worker_count();
+void set_worker_count(int worker_count);
+
+/* a fixed set of worker threads draining a shared queue of tasks. tasks may
+ * enqueue further tasks. a pool with a single worker spawns no threads at all;
+ * its tasks run in order on the thread that calls wait(). */
+class ThreadPool {
+public:
+  explicit ThreadPool(int worker_count);
+  ThreadPool(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  void enqueue(std::function<void()> task);
+  /* block until the queue is empty and no task is running */
+  void wait();
+
+private:
+  void work();
+
+  std::mutex mutex;
+  std::condition_variable task_ready;
+  std::condition_variable tasks_done;
+  std::deque<std::function<void()>> queue;
+  int running = 0;
+  bool stopping = false;
+  std::vector<std::thread> threads;
+};
@@ -0,0 +1,144 @@
+#include "time_trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "user_error.h"
+#include "utils.h"
+
+namespace zion {
+
+namespace {
+
+struct TraceEvent {
+  /* 'X' for a scoped timing, 'C' for a counter */
+  char phase;
+  std::string name;
+  std::string detail;
+  std::int64_t timestamp_micros;
+  std::int64_t duration_micros;
+  int thread;
+  std::int64_t value;
+};
+
+struct TimeTrace {
+  std::mutex mutex;
+  std::chrono::steady_clock::time_point start;
+  std::vector<TraceEvent> events;
+  /* threads are numbered in the order that they first record an event */
+  std::map<std::thread::id, int> threads;
+  std::map<std::string, std::int64_t> counters;
+};
+
+bool enabled = false;
+
+TimeTrace &get_time_trace() {
+  static TimeTrace time_trace;
+  return time_trace;
+}
+
+std::int64_t now_micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - get_time_trace().start)
+      .count();
+}
+
+/* the caller must hold the time trace's mutex */
+int get_thread(TimeTrace &time_trace) {
+  auto iter = time_trace.threads.find(std::this_thread::get_id());
+  if (iter != time_trace.threads.end()) {
+    return iter->second;
+  }
+  int thread = time_trace.threads.size();
+  time_trace.threads[std::this_thread::get_id()] = thread;
+  return thread;
+}
+
+void record_counter(const char *name, std::int64_t value, bool add) {
+  if (!enabled) {
+    return;
+  }
+  std::int64_t timestamp_micros = now_micros();
+  auto &time_trace = get_time_trace();
+  std::lock_guard<std::mutex> lock(time_trace.mutex);
+  auto &counter = time_trace.counters[name];
+  counter = add ? counter + value : value;
+  time_trace.events.push_back(TraceEvent{'C', name, {}, timestamp_micros, 0,
+                                         get_thread(time_trace), counter});
+}
+
+} // namespace
+
+void start_time_trace() {
+  get_time_trace().start = std::chrono::steady_clock::now();
+  enabled = true;
+}
+
+bool time_trace_enabled() {
+  return enabled;
+}
+
+TimeTraceScope::TimeTraceScope(const char *name, const std::string &detail)
+    : name(name) {
+  if (enabled) {
+    this->detail = detail;
+    start_micros = now_micros();
+  }
+}
+
+TimeTraceScope::~TimeTraceScope() {
+  if (start_micros < 0) {
+    return;
+  }
+  std::int64_t duration_micros = now_micros() - start_micros;
+  auto &time_trace = get_time_trace();
+  std::lock_guard<std::mutex> lock(time_trace.mutex);
+  time_trace.events.push_back(TraceEvent{'X', name, std::move(detail),
+                                         start_micros, duration_micros,
+                                         get_thread(time_trace), 0});
+}
+
+void time_trace_counter(const char *name, std::int64_t value) {
+  record_counter(name, value, false /*add*/);
+}
+
+void time_trace_add_counter(const char *name, std::int64_t delta) {
+  record_counter(name, delta, true /*add*/);
+}
+
+void write_time_trace(const std::string &filename) {
+  std::ofstream ofs(filename);
+  if (!ofs.good()) {
+    throw user_error(INTERNAL_LOC(), "unable to write time trace to %s",
+                     filename.c_str());
+  }
+
+  auto &time_trace = get_time_trace();
+  std::lock_guard<std::mutex> lock(time_trace.mutex);
+  ofs << "{\"traceEvents\":[";
+  const char *delim = "\n";
+  for (auto &event : time_trace.events) {
+    ofs << delim << "{\"ph\":\"" << event.phase << "\",\"name\":";
+    escape_json_quotes(ofs, event.name);
+    ofs << ",\"cat\":\"zion\",\"pid\":1,\"tid\":" << event.thread
+        << ",\"ts\":" << event.timestamp_micros;
+    if (event.phase == 'X') {
+      ofs << ",\"dur\":" << event.duration_micros << ",\"args\":{\"detail\":";
+      /* details are often built by str(), which colors its output */
+      escape_json_quotes(ofs, clean_ansi_escapes(event.detail));
+      ofs << "}}";
+    } else {
+      ofs << ",\"args\":{";
+      escape_json_quotes(ofs, event.name);
+      ofs << ":" << event.value << "}}";
+    }
+    delim = ",\n";
+  }
+  ofs << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+} // namespace zion
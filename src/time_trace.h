@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace zion {
+
+/* a profile of where compile time goes, written out as Chrome trace-event
+ * JSON that chrome://tracing or ui.perfetto.dev can display. nothing is
+ * recorded until start_time_trace is called. */
+void start_time_trace();
+bool time_trace_enabled();
+
+/* records the time between its construction and destruction as one event on
+ * the calling thread. detail names what the work was for, such as a module or
+ * a function. a detail that costs something to build can be given as a
+ * function instead, which is only called when tracing is enabled. */
+class TimeTraceScope {
+public:
+  TimeTraceScope(const char *name, const std::string &detail = {});
+  template <typename GetDetail,
+            typename = std::enable_if_t<
+                std::is_invocable_r_v<std::string, GetDetail>>>
+  TimeTraceScope(const char *name, GetDetail get_detail)
+      : TimeTraceScope(name,
+                       time_trace_enabled() ? get_detail() : std::string()) {
+  }
+  TimeTraceScope(const TimeTraceScope &) = delete;
+  ~TimeTraceScope();
+
+private:
+  const char *name;
+  std::string detail;
+  std::int64_t start_micros = -1;
+};
+
+/* set the counter called name to value */
+void time_trace_counter(const char *name, std::int64_t value);
+/* add delta to the counter called name */
+void time_trace_add_counter(const char *name, std::int64_t delta);
+
+/* write every event recorded so far to filename */
+void write_time_trace(const std::string &filename);
+
+} // namespace zion
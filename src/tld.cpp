@@ -8,17 +8,17 @@ namespace tld {
 #define SCOPE_SEP "::"
 #define SCOPE_SEP_LEN 2
 
-bool is_fqn(std::string name) {
+bool is_fqn(const std::string &name) {
   return name.find(SCOPE_SEP) != std::string::npos;
 }
 
-std::vector<std::string> split_fqn(std::string fqn) {
+std::vector<std::string> split_fqn(const std::string &fqn) {
   auto ns = split(fqn, SCOPE_SEP);
   assert(ns.size() < 3);
   return ns;
 }
 
-std::string mktld(std::string module, std::string name) {
+std::string mktld(const std::string &module, const std::string &name) {
   if (starts_with(name, SCOPE_SEP)) {
     return tld(module + name);
   } else {
@@ -26,7 +26,7 @@ std::string mktld(std::string module, std::string name) {
   }
 }
 
-bool is_tld(std::string name) {
+bool is_tld(const std::string &name) {
   if (starts_with(name, SCOPE_SEP)) {
     assert(name.find(SCOPE_SEP) != std::string::npos);
     return true;
@@ -35,7 +35,7 @@ bool is_tld(std::string name) {
   }
 }
 
-std::string tld(std::string name) {
+std::string tld(const std::string &name) {
   if (is_tld(name)) {
     return name;
   } else {
@@ -51,7 +51,8 @@ Identifier tld(Identifier id) {
   }
 }
 
-bool test_first_char_of_leaf(std::string _name, int (*char_predicate)(int)) {
+bool test_first_char_of_leaf(const std::string &_name,
+                             int (*char_predicate)(int)) {
   auto names = split_fqn(_name);
   const auto &name = names.back();
   if (starts_with(name, SCOPE_SEP)) {
@@ -71,7 +72,7 @@ bool test_first_char_of_leaf(std::string _name, int (*char_predicate)(int)) {
   }
 }
 
-bool is_lowercase_leaf(std::string name) {
+bool is_lowercase_leaf(const std::string &name) {
   return test_first_char_of_leaf(name, islower);
 }
 
@@ -79,19 +80,19 @@ int not_is_lower(int ch) {
   return !islower(ch);
 }
 
-bool is_tld_type(std::string name) {
+bool is_tld_type(const std::string &name) {
   return test_first_char_of_leaf(name, not_is_lower);
 }
 
-bool is_in_module(std::string module, std::string name) {
+bool is_in_module(const std::string &module, const std::string &name) {
   return starts_with(name, std::string(SCOPE_SEP) + module + SCOPE_SEP);
 }
 
-std::string fqn_leaf(std::string fqn) {
+std::string fqn_leaf(const std::string &fqn) {
   return split_fqn(fqn).back();
 }
 
-std::string strip_prefix(std::string fqn) {
+std::string strip_prefix(const std::string &fqn) {
   if (starts_with(fqn, SCOPE_SEP)) {
     return fqn.substr(strlen(SCOPE_SEP));
   } else {
@@ -129,7 +129,7 @@ K(with);
 bool is_restricted_var_name(std::string x);
 
 struct Token {
-  Token(const Location &location = Location{{""}, -1, -1},
+  Token(const Location &location = Location{},
         TokenKind tk = tk_none,
         std::string text = "")
       : location(location), tk(tk), text(text) {
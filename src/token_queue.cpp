@@ -10,14 +10,17 @@ struct token_matcher {
   TokenKind tk;
 };
 
+Token TokenSpan::token() const {
+  return Token{location, tk, std::string(text)};
+}
+
 void TokenQueue::enqueue(const Location &location, TokenKind tk) {
-  std::string token_text;
-  enqueue(location, tk, token_text);
+  enqueue(location, tk, std::string_view{});
 }
 
 void TokenQueue::enqueue(const Location &location,
                          TokenKind tk,
-                         const std::string &token_text) {
+                         std::string_view token_text) {
   m_last_tk = tk;
   m_queue.push_back({location, tk, token_text});
 }
@@ -26,21 +29,27 @@ bool TokenQueue::empty() const {
   return m_queue.empty();
 }
 
-Token TokenQueue::pop() {
-  Token token = m_queue.front();
+TokenSpan TokenQueue::pop() {
+  TokenSpan token = m_queue.front();
   m_queue.pop_front();
   if (m_queue.empty()) {
     return token;
   } else {
-    Token next_token = m_queue.front();
+    const TokenSpan &next_token = m_queue.front();
     if (token.tk == tk_integer && next_token.tk == tk_float &&
         token.location.line == next_token.location.line &&
         int(token.location.col + token.text.size()) ==
             next_token.location.col &&
-        starts_with(next_token.text, ".")) {
-      /* combine these two tokens into a single float */
+        next_token.text.size() != 0 && next_token.text[0] == '.') {
+      /* combine these two tokens into a single float. they are adjacent in
+       * the source buffer, so the combined text is still a single span. */
+      assert(token.text.data() + token.text.size() == next_token.text.data());
+      token = TokenSpan{
+          token.location, tk_float,
+          std::string_view(token.text.data(),
+                           token.text.size() + next_token.text.size())};
       m_queue.pop_front();
-      return Token{token.location, tk_float, token.text + next_token.text};
+      return token;
     } else {
       return token;
     }
@@ -1,20 +1,31 @@
-#include <list>
+#include <deque>
+#include <string_view>
 
 #include "token.h"
 
 namespace zion {
 
+/* a lexed token whose text still refers into the lexer's source buffer. it is
+ * only copied into an owning Token once the parser asks for it. */
+struct TokenSpan {
+  Location location;
+  TokenKind tk = tk_none;
+  std::string_view text;
+
+  Token token() const;
+};
+
 struct TokenQueue {
-  std::list<Token> m_queue;
+  std::deque<TokenSpan> m_queue;
   TokenKind m_last_tk = tk_none;
   void enqueue(const Location &location,
                TokenKind tk,
-               const std::string &token_text);
+               std::string_view token_text);
   void enqueue(const Location &location, TokenKind tk);
   bool empty() const;
   TokenKind last_tk() const;
   void set_last_tk(TokenKind tk);
-  Token pop();
+  TokenSpan pop();
 };
 
 } // namespace zion
@@ -8,6 +8,9 @@
 namespace zion {
 
 typedef std::unordered_map<const zion::ast::Expr *, types::Ref> TrackedTypes;
+/* tracked types are immutable once checking is done, so everything that was
+ * checked together shares a single table */
+typedef std::shared_ptr<const TrackedTypes> TrackedTypesRef;
 
 types::Ref get_tracked_type(const TrackedTypes &tracked_types,
                             const ast::Expr *e);
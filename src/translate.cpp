@@ -5,7 +5,9 @@
 #include "ast.h"
 #include "builtins.h"
 #include "dbg.h"
+#include "for_loops.h"
 #include "ptr.h"
+#include "specialize_hofs.h"
 #include "unification.h"
 #include "user_error.h"
 
@@ -44,7 +46,7 @@ struct TTC {
 const Expr *texpr(const types::DefnId &for_defn_id,
                   const ast::Expr *expr,
                   const DataCtorsMap &data_ctors_map,
-                  const std::unordered_set<std::string> &bound_vars,
+                  const std::unordered_set<Symbol> &bound_vars,
                   const TrackedTypes &tracked_types,
                   types::Ref type,
                   const types::TypeEnv &type_env,
@@ -173,10 +175,20 @@ const Expr *texpr(const types::DefnId &for_defn_id,
                   operand_types[i]->rebind(unification.bindings), type_env,
                   typing, needed_defns, returns));
       }
+      if (auto specialized = specialize_hof_callee(
+              for_defn_id, a, new_params, data_ctors_map, bound_vars, typing,
+              needed_defns)) {
+        a = specialized;
+      }
       auto new_app = new Application(a, {new_params});
       typing[new_app] = type;
       return new_app;
     } else if (auto let = dcast<const Let *>(expr)) {
+      if (auto for_loop = translate_for_loop(
+              for_defn_id, let, data_ctors_map, bound_vars, tracked_types, type,
+              type_env, typing, needed_defns, returns)) {
+        return for_loop;
+      }
       auto new_value = texpr(for_defn_id, let->value, data_ctors_map,
                              bound_vars, tracked_types,
                              get_tracked_type(tracked_types, let->value),
@@ -307,6 +319,10 @@ const Expr *texpr(const types::DefnId &for_defn_id,
                               get_tracked_type(tracked_types, expr), type_env,
                               typing, needed_defns, returns));
       }
+      if (builtin->var->id.name == "__builtin_reserve_for") {
+        return translate_reserve_for(for_defn_id, builtin->get_location(),
+                                     exprs, typing, needed_defns);
+      }
       auto new_builtin = new Builtin(
           dynamic_cast<const Var *>(texpr(
               for_defn_id, builtin->var, data_ctors_map, bound_vars,
@@ -355,7 +371,7 @@ Translation::ref translate_expr(
     const types::DefnId &for_defn_id,
     const ast::Expr *expr,
     const DataCtorsMap &data_ctors_map,
-    const std::unordered_set<std::string> &bound_vars,
+    const std::unordered_set<Symbol> &bound_vars,
     const TrackedTypes &tracked_types,
     const types::TypeEnv &type_env,
     types::NeededDefns &needed_defns,
@@ -365,12 +381,12 @@ Translation::ref translate_expr(
                                       bound_vars, tracked_types,
                                       get_tracked_type(tracked_types, expr),
                                       type_env, typing, needed_defns, returns);
-  return std::make_shared<Translation>(translated_expr, typing);
+  return std::make_shared<Translation>(translated_expr, std::move(typing));
 }
 
-Translation::Translation(const ast::Expr *expr, const TrackedTypes &typing)
-    : expr(expr), typing(typing) {
-  check_typing_for_ftvs(std::string("making a Translation"), typing);
+Translation::Translation(const ast::Expr *expr, TrackedTypes &&typing)
+    : expr(expr), typing(std::move(typing)) {
+  check_typing_for_ftvs(std::string("making a Translation"), this->typing);
 }
 
 std::string Translation::str() const {
@@ -13,7 +13,7 @@ namespace zion {
 struct Translation {
   typedef std::shared_ptr<Translation> ref;
 
-  Translation(const ast::Expr *expr, const TrackedTypes &typing);
+  Translation(const ast::Expr *expr, TrackedTypes &&typing);
 
   const ast::Expr *expr;
   TrackedTypes const typing;
@@ -26,7 +26,7 @@ Translation::ref translate_expr(
     const types::DefnId &for_defn_id,
     const ast::Expr *expr,
     const DataCtorsMap &data_ctors_map,
-    const std::unordered_set<std::string> &bound_vars,
+    const std::unordered_set<Symbol> &bound_vars,
     const TrackedTypes &tracked_types,
     const types::TypeEnv &type_env,
     types::NeededDefns &needed_defns,
@@ -34,7 +34,7 @@ Translation::ref translate_expr(
 const ast::Expr *texpr(const types::DefnId &for_defn_id,
                        const ast::Expr *expr,
                        const DataCtorsMap &data_ctors_map,
-                       const std::unordered_set<std::string> &bound_vars,
+                       const std::unordered_set<Symbol> &bound_vars,
                        const TrackedTypes &tracked_types,
                        types::Ref type,
                        const types::TypeEnv &type_env,
@@ -1,5 +1,6 @@
 #include "types.h"
 
+#include <atomic>
 #include <iostream>
 #include <sstream>
 
@@ -23,9 +24,40 @@ const char *STD_MANAGED_TYPE = "Var";
 const char *STD_MAP_TYPE = "map.Map";
 const char *VOID_TYPE = "void";
 
-int next_generic = 1;
+namespace {
+std::atomic<int> next_generic{1};
+thread_local GensymScope *current_gensym_scope = nullptr;
+} // namespace
+
+GensymScope::GensymScope(std::string tag)
+    : tag(tag), outer(current_gensym_scope) {
+  assert(tag.size() != 0 && !isalpha(tag[0]));
+  current_gensym_scope = this;
+}
+
+GensymScope::~GensymScope() {
+  current_gensym_scope = outer;
+}
+
+GensymScope *GensymScope::current() {
+  return current_gensym_scope;
+}
+
+std::string GensymScope::next_gensym_name() {
+  /* the counter is all letters and the tag does not start with one, so these
+   * can never collide with each other or with unscoped names. */
+  return string_format("__%s%s", alphabetize(next_generic++).c_str(),
+                       tag.c_str());
+}
+
+std::string GensymScope::next_fresh_name() {
+  return string_format("__v%s_%d", tag.c_str(), next_fresh++);
+}
 
 std::string gensym_name() {
+  if (auto scope = GensymScope::current()) {
+    return scope->next_gensym_name();
+  }
   return string_format("__%s", alphabetize(next_generic++).c_str());
 }
 
@@ -57,12 +89,10 @@ int Type::ftv_count() const {
 
 const Ftvs &Type::get_ftvs() const {
   /* maintain this object's predicate map cache */
-  if (!ftvs_valid_) {
+  std::call_once(ftvs_once_, [this] {
     /* call into derived classes */
     this->compute_ftvs();
-
-    ftvs_valid_ = true;
-  }
+  });
 
   return ftvs_;
 }
@@ -76,11 +106,23 @@ std::string Type::str(const Map &bindings) const {
 }
 
 std::string Type::repr(const Map &bindings) const {
+  if (bindings.size() == 0) {
+    return get_signature().str();
+  }
   std::stringstream ss;
   emit(ss, bindings, 0);
   return ss.str();
 }
 
+const Symbol &Type::get_signature() const {
+  std::call_once(signature_once_, [this] {
+    std::stringstream ss;
+    emit(ss, {}, 0);
+    signature_ = Symbol{ss.str()};
+  });
+  return signature_;
+}
+
 types::ClassPredicates get_overlapping_predicates(
     const types::ClassPredicates &class_predicates,
     const Ftvs &ftvs,
@@ -190,9 +232,10 @@ types::Ref TypeId::rewrite_ids(
   }
 }
 
-Ref TypeId::prefix_ids(const std::set<std::string> &bindings,
+Ref TypeId::prefix_ids(const std::unordered_set<Symbol> &bindings,
                        const std::string &pre) const {
-  if (in(id.name, bindings)) {
+  /* only type names are rebound within types */
+  if (in(id.name, bindings) && zion::tld::is_tld_type(id.name)) {
     return type_id(zion::prefix(bindings, pre, id));
   } else {
     return shared_from_this();
@@ -253,7 +296,7 @@ types::Ref TypeVariable::rewrite_ids(
   return shared_from_this();
 }
 
-Ref TypeVariable::prefix_ids(const std::set<std::string> &bindings,
+Ref TypeVariable::prefix_ids(const std::unordered_set<Symbol> &bindings,
                              const std::string &pre) const {
   return shared_from_this();
 }
@@ -337,7 +380,7 @@ types::Ref TypeOperator::rewrite_ids(
                          operand->rewrite_ids(rewrite_rules));
 }
 
-Ref TypeOperator::prefix_ids(const std::set<std::string> &bindings,
+Ref TypeOperator::prefix_ids(const std::unordered_set<Symbol> &bindings,
                              const std::string &pre) const {
   return ::type_operator(oper->prefix_ids(bindings, pre),
                          operand->prefix_ids(bindings, pre));
@@ -440,7 +483,7 @@ types::Ref TypeTuple::rewrite_ids(
   return ::type_tuple(location, zion::rewrite_types(rewrite_rules, dimensions));
 }
 
-Ref TypeTuple::prefix_ids(const std::set<std::string> &bindings,
+Ref TypeTuple::prefix_ids(const std::unordered_set<Symbol> &bindings,
                           const std::string &pre) const {
   bool anything_was_rebound = false;
   Refs type_dimensions;
@@ -554,7 +597,7 @@ types::Ref TypeParams::rewrite_ids(
   return ::type_params(zion::rewrite_types(rewrite_rules, dimensions));
 }
 
-Ref TypeParams::prefix_ids(const std::set<std::string> &bindings,
+Ref TypeParams::prefix_ids(const std::unordered_set<Symbol> &bindings,
                            const std::string &pre) const {
   bool anything_was_rebound = false;
   Refs type_dimensions;
@@ -645,7 +688,7 @@ types::Ref TypeLambda::rewrite_ids(
   return ::type_lambda(binding, body->rewrite_ids(rewrite_rules));
 }
 
-Ref TypeLambda::prefix_ids(const std::set<std::string> &bindings,
+Ref TypeLambda::prefix_ids(const std::unordered_set<Symbol> &bindings,
                            const std::string &pre) const {
   return type_lambda(binding,
                      body->prefix_ids(without(bindings, binding.name), pre));
@@ -2,6 +2,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -48,23 +49,23 @@ struct Type : public std::enable_shared_from_this<Type> {
   SchemeRef generalize(const types::ClassPredicates &pm) const;
   std::string repr(const Map &bindings) const;
   std::string repr() const {
-    return this->repr({});
+    return get_signature().str();
   }
 
   virtual Location get_location() const = 0;
 
   std::string str() const;
   std::string str(const Map &bindings) const;
-  std::string get_signature() const {
-    return repr();
-  }
+  /* the interned repr() of this type, computed once. two types are equal
+   * exactly when their signatures are, which is a pointer comparison. */
+  const Symbol &get_signature() const;
 
   virtual Ref rebind(const Map &bindings) const = 0;
   virtual Ref remap_vars(
       const std::map<std::string, std::string> &map) const = 0;
   virtual Ref rewrite_ids(
       const std::map<Identifier, Identifier> &rewrite_rules) const = 0;
-  virtual Ref prefix_ids(const std::set<std::string> &bindings,
+  virtual Ref prefix_ids(const std::unordered_set<Symbol> &bindings,
                          const std::string &pre) const = 0;
   virtual Ref apply(Ref type) const;
 
@@ -73,15 +74,32 @@ struct Type : public std::enable_shared_from_this<Type> {
   }
 
 private:
-  mutable bool ftvs_valid_ = false;
+  /* types are shared between threads, so the lazily computed caches below are
+   * each filled exactly once. */
+  mutable std::once_flag ftvs_once_;
+  mutable std::once_flag signature_once_;
+  mutable Symbol signature_;
 
 protected:
   mutable Ftvs ftvs_;
 };
 
+/* orders types by the cached hashes of their signatures, and only compares
+ * the text of signatures whose hashes collide, so that comparing two types is
+ * usually O(1). the hashes do not depend on the order in which signatures were
+ * interned, so maps keyed by CompareType iterate in the same order on every
+ * run, although that order is not lexicographic. */
 struct CompareType {
   bool operator()(const Ref &a, const Ref &b) const {
-    return a->repr() < b->repr();
+    if (a == b) {
+      return false;
+    }
+    const Symbol &signature_a = a->get_signature();
+    const Symbol &signature_b = b->get_signature();
+    if (signature_a.hash() != signature_b.hash()) {
+      return signature_a.hash() < signature_b.hash();
+    }
+    return signature_a < signature_b;
   }
 };
 
@@ -100,7 +118,7 @@ struct TypeVariable final : public Type {
   Ref remap_vars(const std::map<std::string, std::string> &map) const override;
   types::Ref rewrite_ids(
       const std::map<Identifier, Identifier> &rewrite_rules) const override;
-  Ref prefix_ids(const std::set<std::string> &bindings,
+  Ref prefix_ids(const std::unordered_set<Symbol> &bindings,
                  const std::string &pre) const override;
   Location get_location() const override;
 };
@@ -118,7 +136,7 @@ struct TypeId final : public Type {
   Ref remap_vars(const std::map<std::string, std::string> &map) const override;
   types::Ref rewrite_ids(
       const std::map<Identifier, Identifier> &rewrite_rules) const override;
-  Ref prefix_ids(const std::set<std::string> &bindings,
+  Ref prefix_ids(const std::unordered_set<Symbol> &bindings,
                  const std::string &pre) const override;
   Location get_location() const override;
 };
@@ -141,7 +159,7 @@ struct TypeOperator final : public Type {
   Ref remap_vars(const std::map<std::string, std::string> &map) const override;
   types::Ref rewrite_ids(
       const std::map<Identifier, Identifier> &rewrite_rules) const override;
-  Ref prefix_ids(const std::set<std::string> &bindings,
+  Ref prefix_ids(const std::unordered_set<Symbol> &bindings,
                  const std::string &pre) const override;
   Location get_location() const override;
 };
@@ -161,7 +179,7 @@ struct TypeTuple final : public Type {
       const std::map<std::string, std::string> &map) const override;
   types::Ref rewrite_ids(
       const std::map<Identifier, Identifier> &rewrite_rules) const override;
-  types::Ref prefix_ids(const std::set<std::string> &bindings,
+  types::Ref prefix_ids(const std::unordered_set<Symbol> &bindings,
                         const std::string &pre) const override;
   Location get_location() const override;
 
@@ -184,7 +202,7 @@ struct TypeParams final : public Type {
       const std::map<std::string, std::string> &map) const override;
   types::Ref rewrite_ids(
       const std::map<Identifier, Identifier> &rewrite_rules) const override;
-  types::Ref prefix_ids(const std::set<std::string> &bindings,
+  types::Ref prefix_ids(const std::unordered_set<Symbol> &bindings,
                         const std::string &pre) const override;
   Location get_location() const override;
 
@@ -209,7 +227,7 @@ struct TypeLambda final : public Type {
   Ref remap_vars(const std::map<std::string, std::string> &map) const override;
   types::Ref rewrite_ids(
       const std::map<Identifier, Identifier> &rewrite_rules) const override;
-  Ref prefix_ids(const std::set<std::string> &bindings,
+  Ref prefix_ids(const std::unordered_set<Symbol> &bindings,
                  const std::string &pre) const override;
   Ref apply(types::Ref type) const override;
   Location get_location() const override;
@@ -231,6 +249,30 @@ types::ClassPredicates get_overlapping_predicates(
 std::string gensym_name();
 Identifier gensym(Location location);
 
+/* while a GensymScope is alive on the current thread, gensym_name() and
+ * ast::fresh() draw from counters private to that scope and tag their names
+ * with the scope's tag. work that runs concurrently with other work opens a
+ * scope so that the names it generates do not depend on how threads were
+ * scheduled. a tag must not begin with a letter. */
+class GensymScope {
+public:
+  explicit GensymScope(std::string tag);
+  GensymScope(const GensymScope &) = delete;
+  ~GensymScope();
+
+  /* the innermost scope open on this thread, or nullptr */
+  static GensymScope *current();
+
+  std::string next_gensym_name();
+  std::string next_fresh_name();
+
+private:
+  std::string const tag;
+  int next_generic = 1;
+  int next_fresh = 0;
+  GensymScope *const outer;
+};
+
 /* type data ctors */
 types::Ref type_bool(Location location);
 types::Ref type_bool(Location location);
@@ -14,6 +14,21 @@
 
 namespace types {
 
+namespace {
+
+/* normalized schemes name their variables in order, so two schemes are the
+ * same scheme when they quantify the same number of variables over the same
+ * predicates and type. */
+bool normalized_scheme_equality(types::Scheme::Ref a, types::Scheme::Ref b) {
+  a = a->normalize();
+  b = b->normalize();
+  return a->vars.size() == b->vars.size() &&
+         a->type->get_signature() == b->type->get_signature() &&
+         ::str(a->predicates) == ::str(b->predicates);
+}
+
+} // namespace
+
 types::SchemeRef scheme_unify(types::Scheme::Ref a, types::Scheme::Ref b) {
   if (a == nullptr || b == nullptr) {
     assert(false);
@@ -22,7 +37,7 @@ types::SchemeRef scheme_unify(types::Scheme::Ref a, types::Scheme::Ref b) {
   // log("checking %s == %s", a->str().c_str(), b->str().c_str());
   // log("normalized checking %s == %s", a->normalize()->str().c_str(),
   // b->normalize()->str().c_str());
-  if (a->normalize()->str() == b->normalize()->str()) {
+  if (normalized_scheme_equality(a, b)) {
     debug_above(4, log("found exact match between %s and %s", a->str().c_str(),
                        b->str().c_str()));
     return a;
@@ -42,8 +57,8 @@ types::SchemeRef scheme_unify(types::Scheme::Ref a, types::Scheme::Ref b) {
   }
 
   auto scheme = ta->rebind(unification.bindings)->generalize({});
-  assert(scheme->normalize()->repr() ==
-         tb->rebind(unification.bindings)->generalize({})->normalize()->repr());
+  assert(normalized_scheme_equality(
+      scheme, tb->rebind(unification.bindings)->generalize({})));
   return scheme;
 }
 
@@ -55,7 +70,7 @@ bool scheme_equality(types::Scheme::Ref a, types::Scheme::Ref b) {
   // log("checking %s == %s", a->str().c_str(), b->str().c_str());
   // log("normalized checking %s == %s", a->normalize()->str().c_str(),
   // b->normalize()->str().c_str());
-  if (a->normalize()->str() == b->normalize()->str()) {
+  if (normalized_scheme_equality(a, b)) {
     return true;
   }
 
@@ -77,50 +92,7 @@ bool type_equality(types::Ref a, types::Ref b) {
     return true;
   }
 
-  if (auto ti_a = dyncast<const TypeId>(a)) {
-    if (auto ti_b = dyncast<const TypeId>(b)) {
-      return ti_a->id.name == ti_b->id.name;
-    } else {
-      return false;
-    }
-  } else if (auto tv_a = dyncast<const TypeVariable>(a)) {
-    if (auto tv_b = dyncast<const TypeVariable>(b)) {
-      return tv_a->id.name == tv_b->id.name;
-    } else {
-      return false;
-    }
-  } else if (auto to_a = dyncast<const TypeOperator>(a)) {
-    if (auto to_b = dyncast<const TypeOperator>(b)) {
-      return (type_equality(to_a->oper, to_b->oper) &&
-              type_equality(to_a->operand, to_b->operand));
-    } else {
-      return false;
-    }
-  } else if (auto tpa_a = dyncast<const TypeParams>(a)) {
-    if (auto tpa_b = dyncast<const TypeParams>(b)) {
-      if (tpa_a->dimensions.size() != tpa_b->dimensions.size()) {
-        return false;
-      }
-      for (size_t i = 0; i < tpa_a->dimensions.size(); ++i) {
-        if (!type_equality(tpa_a->dimensions[i], tpa_b->dimensions[i])) {
-          return false;
-        }
-      }
-      return true;
-    }
-  } else if (auto tup_a = dyncast<const TypeTuple>(a)) {
-    if (auto tup_b = dyncast<const TypeTuple>(b)) {
-      if (tup_a->dimensions.size() != tup_b->dimensions.size()) {
-        return false;
-      }
-      for (size_t i = 0; i < tup_a->dimensions.size(); ++i) {
-        if (!type_equality(tup_a->dimensions[i], tup_b->dimensions[i])) {
-          return false;
-        }
-      }
-      return true;
-    }
-  } else {
+  if (dyncast<const TypeLambda>(a) != nullptr) {
     auto error = zion::user_error(
         a->get_location(),
         "type_equality is not implemented between these two types");
@@ -128,7 +100,10 @@ bool type_equality(types::Ref a, types::Ref b) {
                    b->str().c_str());
     throw error;
   }
-  return false;
+
+  /* a type's repr is a function of its structure, so structurally equal types
+   * share the same interned signature */
+  return a->get_signature() == b->get_signature();
 }
 
 inline bool occurs_check(std::string a, Ref type) {
@@ -160,9 +135,9 @@ Unification unify(Ref a, Ref b) {
   }
 
   if (auto tv_a = dyncast<const TypeVariable>(a)) {
-    return bind(tv_a->id.name, b);
+    return bind(tv_a->id.name.str(), b);
   } else if (auto tv_b = dyncast<const TypeVariable>(b)) {
-    return bind(tv_b->id.name, a);
+    return bind(tv_b->id.name.str(), a);
   } else if (auto to_a = dyncast<const TypeOperator>(a)) {
     if (auto to_b = dyncast<const TypeOperator>(b)) {
       return unify_many({to_a->oper, to_a->operand},
@@ -8,6 +8,7 @@
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "zion_assert.h"
@@ -51,6 +52,13 @@ template <typename T> std::set<T> without(const std::set<T> &s, T v) {
   return c;
 }
 
+template <typename T>
+std::unordered_set<T> without(const std::unordered_set<T> &s, T v) {
+  std::unordered_set<T> c = s;
+  c.erase(v);
+  return c;
+}
+
 template <typename T> void set_merge(T &as, const T &bs) {
   for (auto b : bs) {
     as.insert(b);
@@ -181,6 +189,18 @@ template <typename T> std::set<T> set_diff(std::set<T> a, std::vector<T> b) {
   return diff;
 }
 
+template <typename T>
+std::unordered_set<T> set_diff(const std::unordered_set<T> &a,
+                               const std::unordered_set<T> &b) {
+  std::unordered_set<T> diff;
+  for (auto &x : a) {
+    if (b.count(x) == 0) {
+      diff.insert(x);
+    }
+  }
+  return diff;
+}
+
 template <typename T>
 std::set<T> set_intersect(const std::set<T> &a, const std::set<T> &b) {
   std::set<T> intersection;
@@ -216,8 +236,12 @@ InputIt find_if(InputIt first, InputIt last, UnaryPredicate p) {
   return last;
 }
 
+/* the key parameters are not deduced, so that any type convertible to the
+ * map's key type may be used for the lookup */
 template <typename K, typename V, typename Comp>
-V get(const std::map<K, V, Comp> &t, K k, V default_) {
+V get(const std::map<K, V, Comp> &t,
+      const typename std::map<K, V, Comp>::key_type &k,
+      V default_) {
   auto iter = t.find(k);
   if (iter != t.end()) {
     return iter->second;
@@ -227,7 +251,9 @@ V get(const std::map<K, V, Comp> &t, K k, V default_) {
 }
 
 template <typename K, typename V>
-V get(const std::unordered_map<K, V> &t, K k, V default_) {
+V get(const std::unordered_map<K, V> &t,
+      const typename std::unordered_map<K, V>::key_type &k,
+      V default_) {
   auto iter = t.find(k);
   if (iter != t.end()) {
     return iter->second;
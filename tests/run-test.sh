@@ -28,6 +28,9 @@ mapfile -t expects < <(grep -E '^# expect: .+$' "${test_file}" | cut -c 11-)
 # Find all the reject directives in this file
 mapfile -t rejects < <(grep -E '^# reject: .+$' "${test_file}" | cut -c 11-)
 
+# Find all the environment variables (NAME=value) that this file asks for
+mapfile -t envs < <(grep -E '^# env: .+=.*$' "${test_file}" | cut -c 8-)
+
 containsElement () {
   local e match="$1"
   shift
@@ -56,6 +59,18 @@ if [[ "${test_flags[*]}" =~ "skip" ]]; then
 	exit 0
 fi
 
+if [[ "${test_flags[*]}" =~ "jit" ]]; then
+	command=jit
+else
+	command=run
+fi
+
+# The stats flag adds the compiler's --stats to the output
+opts=()
+if [[ "${test_flags[*]}" =~ "stats" ]]; then
+	opts+=(--stats)
+fi
+
 if [[ "${test_flags[*]}" =~ "noprelude" ]]; then
 	export NO_PRELUDE=1
 fi
@@ -74,7 +89,7 @@ trap 'rm -f $output' EXIT
 # test-run in their debugger.
 [ "$DEBUG_TESTS" != "" ] && $ECHO ZION_ROOT="\"${ZION_ROOT}\"" "'${bin_dir}/zion'" "'${test_file}'\\n"
 
-("${bin_dir}/zion" run "${test_file}" 2>&1) > "$output"
+(env "${envs[@]}" "${bin_dir}/zion" "${command}" "${opts[@]}" "${test_file}" 2>&1) > "$output"
 res=$?
 
 if [ $res -eq 0 ]; then